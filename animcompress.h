@@ -0,0 +1,351 @@
+/* animcompress - v0.1 - public domain keyframe reduction and quantization of animation tracks
+
+    Do this:
+        #define ANIMCOMPRESS_IMPLEMENTATION
+    before you include this file in *one* C or C++ file to create the implementation.
+
+    anim_reduce_keys drops the keys of a LINEAR track that interpolating
+    between the kept keys reproduces within a tolerance. It splits a span at
+    its worst key until every dropped key is close enough, like Douglas and
+    Peucker do for polylines. Rotations are compared by the angle between
+    the slerped and the original quaternion, everything else per component.
+
+    anim_quantize_rotation stores a unit quaternion in 48 bits as its three
+    smallest components, 15 bits each in [-1/sqrt(2), 1/sqrt(2)], and the 2
+    bit index of the largest, which is rebuilt from the unit length. The
+    quaternion is flipped so the largest is positive, q and -q are the same
+    rotation.
+
+    anim_quantize_range maps every component of a track to 16 bits between
+    its smallest and largest value: v = offset + q * scale.
+
+    anim_compress_model rewrites the LINEAR samplers of a tinygltf::Model
+    offline with their reduced keys, rotations and weights in [-1, 1] as
+    normalized shorts, which glTF allows for those paths. The new accessors
+    go on new bufferViews, the old ones are left unreferenced. The model part
+    calls into gltfaccessor, include gltfaccessor.h before this file.
+
+    Release notes:
+        v0.1    (2026-10-18)    initial version for compressed animations in sceneanimation
+
+LICENSE
+
+This software is in the public domain. Where that dedication is not
+recognized, you are granted a perpetual, irrevocable license to copy,
+distribute, and modify this file as you see fit.
+
+*/
+#ifndef ANIMCOMPRESS_H
+#define ANIMCOMPRESS_H
+
+#include "tiny_gltf.h"
+
+// Sets keep[i] for the keys to keep, always the first and the last, and returns their number.
+// tolerance is in radians for rotations and in the units of the values otherwise.
+int anim_reduce_keys(unsigned char *keep, const float *times, const float *values, int count, int components, bool rotation, float tolerance);
+
+// Spherical interpolation from a to b along the shorter arc, the result is normalized
+void anim_slerp(float out[4], const float a[4], const float b[4], float t);
+
+// 3 unsigned shorts per rotation
+void anim_quantize_rotation(unsigned short destination[3], const float q[4]);
+void anim_dequantize_rotation(float q[4], const unsigned short source[3]);
+
+// Per component offset and scale of count elements, scale is 0 for constant components
+void anim_quantize_range(float *offset, float *scale, const float *values, int count, int components);
+void anim_quantize_values(unsigned short *destination, const float *values, int count, int components, const float *offset, const float *scale);
+
+// Returns the number of samplers rewritten
+int anim_compress_model(tinygltf::Model& model, float tolerance, float angleTolerance);
+
+#endif // ANIMCOMPRESS_H
+
+#ifdef ANIMCOMPRESS_IMPLEMENTATION
+
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+// sceneanimation plays rotations with this too, so the error is measured against playback
+void anim_slerp(float out[4], const float a[4], const float b[4], float t)
+{
+    float d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+    float sign = d < 0.0f ? -1.0f : 1.0f;
+    d *= sign;
+
+    // Close quaternions fall back to a normalized lerp, sin() of the angle is too small
+    float wa = 1.0f - t, wb = t * sign;
+    if (d < 0.9995f)
+    {
+        float angle = acosf(d), s = 1.0f / sinf(angle);
+        wa = sinf((1.0f - t) * angle) * s;
+        wb = sinf(t * angle) * s * sign;
+    }
+
+    float length = 0.0f;
+    for (int k = 0; k < 4; k++)
+    {
+        out[k] = a[k] * wa + b[k] * wb;
+        length += out[k] * out[k];
+    }
+    length = length > 0.0f ? 1.0f / sqrtf(length) : 0.0f;
+    for (int k = 0; k < 4; k++) out[k] *= length;
+}
+
+static float anim_compress_error(const float *a, const float *b, const float *v, float t, int components, bool rotation)
+{
+    if (rotation)
+    {
+        float q[4];
+        anim_slerp(q, a, b, t);
+        float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2] + v[3] * v[3]);
+        if (length <= 0.0f) return 0.0f;
+
+        // acos() of the dot product is too coarse near 1, the angle between
+        // unit vectors is 2 atan2(|q - v|, |q + v|) and the rotation twice that
+        float sign = q[0] * v[0] + q[1] * v[1] + q[2] * v[2] + q[3] * v[3] < 0.0f ? -1.0f : 1.0f;
+        float difference = 0.0f, sum = 0.0f;
+        for (int k = 0; k < 4; k++)
+        {
+            float u = v[k] * sign / length;
+            difference += (q[k] - u) * (q[k] - u);
+            sum += (q[k] + u) * (q[k] + u);
+        }
+        return 4.0f * atan2f(sqrtf(difference), sqrtf(sum));
+    }
+
+    float error = 0.0f;
+    for (int k = 0; k < components; k++) error = fmaxf(error, fabsf(a[k] + (b[k] - a[k]) * t - v[k]));
+    return error;
+}
+
+int anim_reduce_keys(unsigned char *keep, const float *times, const float *values, int count, int components, bool rotation, float tolerance)
+{
+    if (count <= 0) return 0;
+
+    memset(keep, 0, count);
+    keep[0] = keep[count - 1] = 1;
+
+    std::vector<std::pair<int, int> > spans(1, std::make_pair(0, count - 1));
+    while (!spans.empty())
+    {
+        auto a = spans.back().first, b = spans.back().second;
+        spans.pop_back();
+        if (b - a < 2) continue;
+
+        auto dt = times[b] - times[a];
+        int worst = -1;
+        float worstError = tolerance;
+        for (int i = a + 1; i < b; i++)
+        {
+            auto t = dt > 0.0f ? (times[i] - times[a]) / dt : 0.0f;
+            auto error = anim_compress_error(&values[a * components], &values[b * components], &values[i * components], t, components, rotation);
+            if (error > worstError)
+            {
+                worst = i;
+                worstError = error;
+            }
+        }
+        if (worst < 0) continue;
+
+        keep[worst] = 1;
+        spans.push_back(std::make_pair(a, worst));
+        spans.push_back(std::make_pair(worst, b));
+    }
+
+    int kept = 0;
+    for (int i = 0; i < count; i++) kept += keep[i];
+    return kept;
+}
+
+static unsigned int anim_compress_round(float v, unsigned int high)
+{
+    auto q = floorf(v + 0.5f);
+    return q < 0.0f ? 0 : (q > (float)high ? high : (unsigned int)q);
+}
+
+void anim_quantize_rotation(unsigned short destination[3], const float q[4])
+{
+    int largest = 0;
+    for (int k = 1; k < 4; k++)
+    {
+        if (fabsf(q[k]) > fabsf(q[largest])) largest = k;
+    }
+
+    float length = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    float s = length > 0.0f ? (q[largest] < 0.0f ? -1.0f : 1.0f) / length : 0.0f;
+
+    unsigned long long bits = (unsigned long long)largest;
+    for (int k = 0; k < 4; k++)
+    {
+        if (k == largest) continue;
+
+        // [-1/sqrt(2), 1/sqrt(2)] to [0, 32767]
+        auto v = q[k] * s * 0.70710678f + 0.5f;
+        bits = (bits << 15) | anim_compress_round(v * 32767.0f, 32767);
+    }
+
+    destination[0] = (unsigned short)(bits >> 32);
+    destination[1] = (unsigned short)(bits >> 16);
+    destination[2] = (unsigned short)bits;
+}
+
+void anim_dequantize_rotation(float q[4], const unsigned short source[3])
+{
+    auto bits = ((unsigned long long)source[0] << 32) | ((unsigned long long)source[1] << 16) | source[2];
+    auto largest = (int)(bits >> 45) & 3;
+
+    float sum = 0.0f;
+    int shift = 30;
+    for (int k = 0; k < 4; k++, shift -= 15)
+    {
+        if (k == largest)
+        {
+            shift += 15;
+            continue;
+        }
+
+        auto v = (float)((bits >> shift) & 0x7fff) / 32767.0f;
+        q[k] = (v - 0.5f) * 1.41421356f;
+        sum += q[k] * q[k];
+    }
+    q[largest] = sqrtf(sum < 1.0f ? 1.0f - sum : 0.0f);
+}
+
+void anim_quantize_range(float *offset, float *scale, const float *values, int count, int components)
+{
+    for (int k = 0; k < components; k++)
+    {
+        float low = count > 0 ? values[k] : 0.0f, high = low;
+        for (int i = 1; i < count; i++)
+        {
+            low = fminf(low, values[i * components + k]);
+            high = fmaxf(high, values[i * components + k]);
+        }
+        offset[k] = low;
+        scale[k] = (high - low) / 65535.0f;
+    }
+}
+
+void anim_quantize_values(unsigned short *destination, const float *values, int count, int components, const float *offset, const float *scale)
+{
+    for (int i = 0; i < count; i++)
+    {
+        for (int k = 0; k < components; k++)
+        {
+            auto v = scale[k] > 0.0f ? (values[i * components + k] - offset[k]) / scale[k] : 0.0f;
+            destination[i * components + k] = (unsigned short)anim_compress_round(v, 65535);
+        }
+    }
+}
+
+static int anim_compress_add_accessor(tinygltf::Model& model, int buffer, const void *data, size_t byteLength, int componentType, bool normalized,
+                                      int count, int type, const float *values, int components)
+{
+    tinygltf::Accessor accessor;
+    accessor.bufferView = accessor_add_view(model, buffer, data, byteLength, 0, 0);
+    accessor.byteOffset = 0;
+    accessor.componentType = componentType;
+    accessor.normalized = normalized;
+    accessor.count = (size_t)count;
+    accessor.type = type;
+
+    // Weights are stored as scalars, min and max have one value
+    auto n = type == TINYGLTF_TYPE_SCALAR ? 1 : components;
+    accessor.minValues.assign(n, values[0]);
+    accessor.maxValues.assign(n, values[0]);
+    for (int i = 0; i < count * components; i++)
+    {
+        accessor.minValues[i % n] = fmin(accessor.minValues[i % n], values[i]);
+        accessor.maxValues[i % n] = fmax(accessor.maxValues[i % n], values[i]);
+    }
+
+    model.accessors.push_back(accessor);
+    return (int)model.accessors.size() - 1;
+}
+
+int anim_compress_model(tinygltf::Model& model, float tolerance, float angleTolerance)
+{
+    int rewritten = 0;
+    std::vector<float> times, values, keptTimes, keptValues;
+    std::vector<unsigned char> keep;
+    std::vector<short> shorts;
+    for (auto& animation : model.animations)
+    {
+        for (size_t s = 0; s < animation.samplers.size(); s++)
+        {
+            auto& sampler = animation.samplers[s];
+            if (!sampler.interpolation.empty() && sampler.interpolation != "LINEAR") continue;
+            if (sampler.input < 0 || sampler.input >= (int)model.accessors.size() || sampler.output < 0 || sampler.output >= (int)model.accessors.size()) continue;
+
+            // The path decides how values are compared and stored, channels sharing the sampler have to agree
+            std::string path;
+            bool agree = true;
+            for (auto& channel : animation.channels)
+            {
+                if (channel.sampler != (int)s) continue;
+                agree = agree && (path.empty() || path == channel.target_path);
+                path = channel.target_path;
+            }
+            if (!agree || path.empty()) continue;
+
+            auto& input = model.accessors[sampler.input];
+            auto& output = model.accessors[sampler.output];
+            if (input.count < 3 || output.count % input.count != 0) continue;
+            if (!accessor_read_floats(model, input, false, times) || !accessor_read_floats(model, output, output.normalized, values)) continue;
+
+            auto count = (int)input.count;
+            auto components = (int)(values.size() / input.count);
+            auto rotation = path == "rotation";
+            if (rotation ? components != 4 : path != "weights" && components != 3) continue;
+
+            keep.resize(count);
+            auto kept = anim_reduce_keys(keep.data(), times.data(), values.data(), count, components, rotation, rotation ? angleTolerance : tolerance);
+
+            keptTimes.clear();
+            keptValues.clear();
+            for (int i = 0; i < count; i++)
+            {
+                if (!keep[i]) continue;
+                keptTimes.push_back(times[i]);
+                keptValues.insert(keptValues.end(), &values[i * components], &values[(i + 1) * components]);
+            }
+
+            // Rotations and weights in [-1, 1] may be normalized shorts
+            auto normalized = rotation || path == "weights";
+            for (size_t i = 0; i < keptValues.size() && normalized; i++) normalized = keptValues[i] >= -1.0f && keptValues[i] <= 1.0f;
+
+            // Sparse accessors may have no bufferView, their substituted values always do
+            auto view = output.bufferView >= 0 ? output.bufferView : input.bufferView >= 0 ? input.bufferView : output.sparse.values.bufferView;
+            if (view < 0 || view >= (int)model.bufferViews.size()) continue;
+            auto buffer = model.bufferViews[view].buffer;
+            auto outputType = path == "weights" ? TINYGLTF_TYPE_SCALAR : rotation ? TINYGLTF_TYPE_VEC4 : TINYGLTF_TYPE_VEC3;
+            auto outputCount = (int)(outputType == TINYGLTF_TYPE_SCALAR ? keptValues.size() : kept);
+
+            sampler.input = anim_compress_add_accessor(model, buffer, keptTimes.data(), keptTimes.size() * sizeof(float), TINYGLTF_COMPONENT_TYPE_FLOAT, false,
+                                                       kept, TINYGLTF_TYPE_SCALAR, keptTimes.data(), 1);
+            if (normalized)
+            {
+                // min and max of normalized accessors are in integer units
+                shorts.resize(keptValues.size());
+                for (size_t i = 0; i < shorts.size(); i++)
+                {
+                    shorts[i] = (short)floorf(keptValues[i] * 32767.0f + 0.5f);
+                    keptValues[i] = shorts[i];
+                }
+                sampler.output = anim_compress_add_accessor(model, buffer, shorts.data(), shorts.size() * sizeof(short), TINYGLTF_COMPONENT_TYPE_SHORT, true,
+                                                            outputCount, outputType, keptValues.data(), components);
+            }
+            else
+            {
+                sampler.output = anim_compress_add_accessor(model, buffer, keptValues.data(), keptValues.size() * sizeof(float), TINYGLTF_COMPONENT_TYPE_FLOAT, false,
+                                                            outputCount, outputType, keptValues.data(), components);
+            }
+            rewritten++;
+        }
+    }
+    return rewritten;
+}
+
+#endif // ANIMCOMPRESS_IMPLEMENTATION
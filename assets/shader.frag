@@ -1,10 +1,17 @@
+#extension GL_EXT_texture_array : enable
+
 uniform sampler2D diffuseTex;
+uniform sampler2DArray diffuseArray;
 
 varying vec3 normal;
 varying vec2 texcoord;
+varying float layer;
 
 void main(void)
 {
-    gl_FragColor = texture2D(diffuseTex, texcoord);
+    if (layer >= 0.0)
+        gl_FragColor = texture2DArray(diffuseArray, vec3(texcoord, layer));
+    else
+        gl_FragColor = texture2D(diffuseTex, texcoord);
     //gl_FragColor = vec4(0.5 * normalize(normal) + 0.5, 1.0);
 }
@@ -1,16 +1,35 @@
 attribute vec3    in_vertex;
 attribute vec3    in_normal;
 attribute vec2    in_texcoord;
+attribute mat4    in_model;
+
+// EXT_mesh_gpu_instancing, constant identity values when not instanced
+attribute vec3    in_instance_translation;
+attribute vec4    in_instance_rotation;
+attribute vec3    in_instance_scale;
+
+// Layer of diffuseArray, -1 when the texture is in diffuseTex
+attribute float   in_layer;
 
 varying vec3      normal;
 varying vec2      texcoord;
+varying float     layer;
+
+vec3 rotate(vec4 q, vec3 v)
+{
+	return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
 
 void main(void)
 {
-	vec4 p = gl_ModelViewProjectionMatrix * vec4(in_vertex, 1);
+	vec3 v = in_instance_translation + rotate(in_instance_rotation, in_vertex * in_instance_scale);
+	vec3 n = rotate(in_instance_rotation, normalize(in_normal) / in_instance_scale);
+
+	vec4 p = gl_ModelViewProjectionMatrix * (in_model * vec4(v, 1));
 	gl_Position = p;
-	vec4 nn = gl_ModelViewMatrixInverseTranspose * vec4(normalize(in_normal), 0);
+	vec4 nn = gl_ModelViewMatrixInverseTranspose * (in_model * vec4(normalize(n), 0));
 	normal = nn.xyz;
 
 	texcoord = in_texcoord;
+	layer = in_layer;
 }
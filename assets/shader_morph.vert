@@ -0,0 +1,43 @@
+#extension GL_EXT_gpu_shader4 : require
+
+attribute vec3    in_vertex;
+attribute vec3    in_normal;
+attribute vec2    in_texcoord;
+attribute mat4    in_model;
+
+// Layer of diffuseArray, -1 when the texture is in diffuseTex
+attribute float   in_layer;
+
+// Deltas of every target, one texel per vertex, the normal deltas of a target
+// follow its position deltas after morphNormals texels, 0 without normals
+uniform samplerBuffer morphDeltas;
+uniform int       morphNormals;
+
+// Targets with a non-zero weight, by the first texel of their position deltas
+uniform int       morphCount;
+uniform int       morphOffsets[16];
+uniform float     morphWeights[16];
+
+varying vec3      normal;
+varying vec2      texcoord;
+varying float     layer;
+
+void main(void)
+{
+	vec3 v = in_vertex;
+	vec3 n = normalize(in_normal);
+	for (int i = 0; i < morphCount; i++)
+	{
+		int texel = morphOffsets[i] + gl_VertexID;
+		v += morphWeights[i] * texelFetchBuffer(morphDeltas, texel).xyz;
+		if (morphNormals > 0) n += morphWeights[i] * texelFetchBuffer(morphDeltas, texel + morphNormals).xyz;
+	}
+
+	vec4 p = gl_ModelViewProjectionMatrix * (in_model * vec4(v, 1));
+	gl_Position = p;
+	vec4 nn = gl_ModelViewMatrixInverseTranspose * (in_model * vec4(normalize(n), 0));
+	normal = nn.xyz;
+
+	texcoord = in_texcoord;
+	layer = in_layer;
+}
@@ -0,0 +1,39 @@
+#extension GL_ARB_uniform_buffer_object : enable
+
+attribute vec3    in_vertex;
+attribute vec3    in_normal;
+attribute vec2    in_texcoord;
+attribute mat4    in_model;
+
+// JOINTS_0 and WEIGHTS_0, joint indices arrive as floats
+attribute vec4    in_joints;
+attribute vec4    in_weights;
+
+// Layer of diffuseArray, -1 when the texture is in diffuseTex
+attribute float   in_layer;
+
+// Joint world matrix times inverse bind matrix, for every joint of the skin being drawn
+layout(std140) uniform JointPalette
+{
+	mat4 joints[256];
+};
+
+varying vec3      normal;
+varying vec2      texcoord;
+varying float     layer;
+
+void main(void)
+{
+	mat4 skin = in_weights.x * joints[int(in_joints.x)] +
+	            in_weights.y * joints[int(in_joints.y)] +
+	            in_weights.z * joints[int(in_joints.z)] +
+	            in_weights.w * joints[int(in_joints.w)];
+
+	vec4 p = gl_ModelViewProjectionMatrix * (in_model * (skin * vec4(in_vertex, 1)));
+	gl_Position = p;
+	vec4 nn = gl_ModelViewMatrixInverseTranspose * (in_model * (skin * vec4(normalize(in_normal), 0)));
+	normal = nn.xyz;
+
+	texcoord = in_texcoord;
+	layer = in_layer;
+}
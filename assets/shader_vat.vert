@@ -0,0 +1,47 @@
+#extension GL_EXT_gpu_shader4 : require
+
+attribute vec3    in_vertex;
+attribute vec3    in_normal;
+attribute vec2    in_texcoord;
+attribute mat4    in_model;
+
+// Layer of diffuseArray, -1 when the texture is in diffuseTex
+attribute float   in_layer;
+
+// Frames this instance is ahead of the others
+attribute float   in_frame_offset;
+
+// Baked frames of the primitive, from vatFirst on: per frame the offset of every vertex
+// from in_vertex and then its normal, so a frame is 2 * vatVertices texels. There is
+// one frame more than vatFrameCount, the end of the animation.
+uniform samplerBuffer vatFrames;
+uniform int       vatFirst;
+uniform int       vatVertices;
+uniform int       vatFrameCount;
+uniform float     vatFrame;
+
+varying vec3      normal;
+varying vec2      texcoord;
+varying float     layer;
+
+void main(void)
+{
+	// The animation loops
+	float frame = mod(vatFrame + in_frame_offset, float(vatFrameCount));
+	int f0 = min(int(frame), vatFrameCount - 1);
+	int f1 = f0 + 1;
+	float t = frame - float(f0);
+
+	int texel0 = vatFirst + f0 * vatVertices * 2 + gl_VertexID;
+	int texel1 = vatFirst + f1 * vatVertices * 2 + gl_VertexID;
+	vec3 v = in_vertex + mix(texelFetchBuffer(vatFrames, texel0).xyz, texelFetchBuffer(vatFrames, texel1).xyz, t);
+	vec3 n = mix(texelFetchBuffer(vatFrames, texel0 + vatVertices).xyz, texelFetchBuffer(vatFrames, texel1 + vatVertices).xyz, t);
+
+	vec4 p = gl_ModelViewProjectionMatrix * (in_model * vec4(v, 1));
+	gl_Position = p;
+	vec4 nn = gl_ModelViewMatrixInverseTranspose * (in_model * vec4(normalize(n), 0));
+	normal = nn.xyz;
+
+	texcoord = in_texcoord;
+	layer = in_layer;
+}
@@ -6,6 +6,8 @@
 
     Release notes:
         v0.1    (2017-07-13)    initial version based on tiny_gltf glview.cc
+        v0.2    (2026-10-18)    projection and view matrices are kept on the cpu for culling
+        v0.3    (2026-10-18)    SetLoadMatrices(false) for when another thread owns the GL context
 
 LICENSE
 
@@ -33,6 +35,9 @@ class GLFWCamera
     int width;
     int height;
     float scale;
+    float projection[16];
+    float view[16];
+    bool loadMatrices;
 
     static void mouseButtonCallback(GLFWwindow *window, int button, int action, int mods);
     static void cursorPosCallback(GLFWwindow *window, double mouse_x, double mouse_y);
@@ -42,14 +47,22 @@ public:
     virtual ~GLFWCamera();
 
     void SetScale(float scale);
+    // False when another thread draws, Build() and resizes then only update the matrices and size
+    void SetLoadMatrices(bool load);
     void Setup(GLFWwindow *window);
     void Build();
+
+    const float *Projection() const;
+    const float *View() const;
+    int Width() const;
+    int Height() const;
 };
 
 #endif // GLFWCAMERA_H
 
 #ifdef GLFWCAMERA_IMPLEMENTATION
 
+#include "glmath.h"
 #include "trackball.h"
 
 void GLFWCamera::mouseButtonCallback(GLFWwindow *window, int button, int action, int mods)
@@ -142,18 +155,22 @@ void GLFWCamera::setWindowSizeCallback(GLFWwindow *window, int w, int h)
     auto thiz = reinterpret_cast<GLFWCamera*>(glfwGetWindowUserPointer(window));
 
     glfwGetFramebufferSize(window, &thiz->width, &thiz->height);
+    mat4_perspective(thiz->projection, 45.0f, (float)thiz->width / (float)thiz->height, 0.1f, 1000.0f);
+    if (!thiz->loadMatrices) return;
+
     glViewport(0, 0, thiz->width, thiz->height);
     glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(45.0, (float)thiz->width / (float)thiz->height, 0.1f, 1000.0f);
+    glLoadMatrixf(thiz->projection);
 }
 
-GLFWCamera::GLFWCamera() { }
+GLFWCamera::GLFWCamera() : loadMatrices(true) { }
 
 GLFWCamera::~GLFWCamera() { }
 
 void GLFWCamera::SetScale(float scale) { this->scale = scale; }
 
+void GLFWCamera::SetLoadMatrices(bool load) { this->loadMatrices = load; }
+
 void GLFWCamera::Setup(GLFWwindow *window)
 {
     glfwGetFramebufferSize(window, &width, &height);
@@ -186,15 +203,28 @@ void GLFWCamera::Setup(GLFWwindow *window)
 
 void GLFWCamera::Build()
 {
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    gluLookAt(eye[0], eye[1], eye[2], lookat[0], lookat[1], lookat[2], up[0], up[1], up[2]);
+    mat4_lookat(view, eye, lookat, up);
 
     GLfloat mat[4][4];
     build_rotmatrix(mat, curr_quat);
-    glMultMatrixf(&mat[0][0]);
+    mat4_mul(view, view, &mat[0][0]);
+
+    GLfloat scaling[16];
+    mat4_identity(scaling);
+    scaling[0] = scaling[5] = scaling[10] = scale;
+    mat4_mul(view, view, scaling);
+    if (!loadMatrices) return;
 
-    glScalef(scale, scale, scale);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadMatrixf(view);
 }
 
+const float *GLFWCamera::Projection() const { return projection; }
+
+const float *GLFWCamera::View() const { return view; }
+
+int GLFWCamera::Width() const { return width; }
+
+int GLFWCamera::Height() const { return height; }
+
 #endif // GLFWCAMERA_IMPLEMENTATION
@@ -0,0 +1,313 @@
+/* glmath - v0.3 - public domain matrix, bounding box and frustum helpers for opengl
+
+    All functions are inline, there is no implementation section.
+
+    Matrices are 4x4 float arrays in column-major order, the same layout as
+    glLoadMatrixf and glTF's node.matrix. Bounding boxes are float[6] arrays
+    laid out as { minx, miny, minz, maxx, maxy, maxz }.
+
+    mat4_mul uses SSE when the compiler targets it, with the same order of
+    operations as the scalar code so both give the same result.
+
+    Release notes:
+        v0.1    (2026-10-18)    initial version for frustum culling in gltfscene
+        v0.2    (2026-10-18)    SSE mat4_mul for joint matrices
+        v0.3    (2026-10-18)    mat4_inverse_affine for baking vertex animations
+
+LICENSE
+
+This software is in the public domain. Where that dedication is not
+recognized, you are granted a perpetual, irrevocable license to copy,
+distribute, and modify this file as you see fit.
+
+*/
+#ifndef GLMATH_H
+#define GLMATH_H
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define GLMATH_SSE
+#include <xmmintrin.h>
+#endif
+
+inline void mat4_identity(float m[16])
+{
+    memset(m, 0, sizeof(float) * 16);
+    m[0] = m[5] = m[10] = m[15] = 1.0f;
+}
+
+inline void mat4_copy(float out[16], const float m[16])
+{
+    memcpy(out, m, sizeof(float) * 16);
+}
+
+// out = a * b, out may alias a or b
+inline void mat4_mul(float out[16], const float a[16], const float b[16])
+{
+#ifdef GLMATH_SSE
+    // Every column of out is the columns of a weighted by a column of b
+    __m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4), a2 = _mm_loadu_ps(a + 8), a3 = _mm_loadu_ps(a + 12);
+    __m128 columns[4];
+    for (int c = 0; c < 4; c++)
+    {
+        auto sum = _mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(b[c * 4 + 0])), _mm_mul_ps(a1, _mm_set1_ps(b[c * 4 + 1])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(b[c * 4 + 2])));
+        columns[c] = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(b[c * 4 + 3])));
+    }
+    for (int c = 0; c < 4; c++) _mm_storeu_ps(out + c * 4, columns[c]);
+#else
+    float r[16];
+    for (int c = 0; c < 4; c++)
+    {
+        for (int row = 0; row < 4; row++)
+        {
+            r[c * 4 + row] = a[0 * 4 + row] * b[c * 4 + 0] +
+                             a[1 * 4 + row] * b[c * 4 + 1] +
+                             a[2 * 4 + row] * b[c * 4 + 2] +
+                             a[3 * 4 + row] * b[c * 4 + 3];
+        }
+    }
+    memcpy(out, r, sizeof(r));
+#endif
+}
+
+// Inverse of an affine matrix, the last row is taken as 0, 0, 0, 1. A singular matrix gives zeros.
+inline void mat4_inverse_affine(float out[16], const float m[16])
+{
+    float a = m[0], b = m[4], c = m[8];
+    float d = m[1], e = m[5], f = m[9];
+    float g = m[2], h = m[6], i = m[10];
+
+    float det = a * (e * i - f * h) - b * (d * i - f * g) + c * (d * h - e * g);
+    float s = det != 0.0f ? 1.0f / det : 0.0f;
+
+    float r[16];
+    r[0] = (e * i - f * h) * s;
+    r[1] = (f * g - d * i) * s;
+    r[2] = (d * h - e * g) * s;
+    r[3] = 0.0f;
+    r[4] = (c * h - b * i) * s;
+    r[5] = (a * i - c * g) * s;
+    r[6] = (b * g - a * h) * s;
+    r[7] = 0.0f;
+    r[8] = (b * f - c * e) * s;
+    r[9] = (c * d - a * f) * s;
+    r[10] = (a * e - b * d) * s;
+    r[11] = 0.0f;
+    for (int row = 0; row < 3; row++) r[12 + row] = -(r[row] * m[12] + r[4 + row] * m[13] + r[8 + row] * m[14]);
+    r[15] = 1.0f;
+    memcpy(out, r, sizeof(r));
+}
+
+// Builds T * R * S from a translation, a unit quaternion (x, y, z, w) and a scale
+inline void mat4_from_trs(float m[16], const float t[3], const float q[4], const float s[3])
+{
+    float x = q[0], y = q[1], z = q[2], w = q[3];
+    float xx = x * x, yy = y * y, zz = z * z;
+    float xy = x * y, xz = x * z, yz = y * z;
+    float wx = w * x, wy = w * y, wz = w * z;
+
+    m[0] = (1.0f - 2.0f * (yy + zz)) * s[0];
+    m[1] = (2.0f * (xy + wz)) * s[0];
+    m[2] = (2.0f * (xz - wy)) * s[0];
+    m[3] = 0.0f;
+
+    m[4] = (2.0f * (xy - wz)) * s[1];
+    m[5] = (1.0f - 2.0f * (xx + zz)) * s[1];
+    m[6] = (2.0f * (yz + wx)) * s[1];
+    m[7] = 0.0f;
+
+    m[8] = (2.0f * (xz + wy)) * s[2];
+    m[9] = (2.0f * (yz - wx)) * s[2];
+    m[10] = (1.0f - 2.0f * (xx + yy)) * s[2];
+    m[11] = 0.0f;
+
+    m[12] = t[0];
+    m[13] = t[1];
+    m[14] = t[2];
+    m[15] = 1.0f;
+}
+
+// Splits an affine matrix without shear into translation, unit quaternion (x, y, z, w) and scale
+inline void mat4_decompose(const float m[16], float t[3], float q[4], float s[3])
+{
+    t[0] = m[12]; t[1] = m[13]; t[2] = m[14];
+
+    for (int c = 0; c < 3; c++)
+        s[c] = sqrtf(m[c * 4 + 0] * m[c * 4 + 0] + m[c * 4 + 1] * m[c * 4 + 1] + m[c * 4 + 2] * m[c * 4 + 2]);
+
+    float det = m[0] * (m[5] * m[10] - m[9] * m[6]) - m[4] * (m[1] * m[10] - m[9] * m[2]) + m[8] * (m[1] * m[6] - m[5] * m[2]);
+    if (det < 0.0f) s[0] = -s[0];
+
+    float r[9];
+    for (int c = 0; c < 3; c++)
+        for (int row = 0; row < 3; row++)
+            r[c * 3 + row] = s[c] != 0.0f ? m[c * 4 + row] / s[c] : 0.0f;
+
+    float trace = r[0] + r[4] + r[8];
+    if (trace > 0.0f)
+    {
+        float k = 0.5f / sqrtf(trace + 1.0f);
+        q[3] = 0.25f / k;
+        q[0] = (r[5] - r[7]) * k;
+        q[1] = (r[6] - r[2]) * k;
+        q[2] = (r[1] - r[3]) * k;
+    }
+    else if (r[0] > r[4] && r[0] > r[8])
+    {
+        float k = 2.0f * sqrtf(1.0f + r[0] - r[4] - r[8]);
+        q[3] = (r[5] - r[7]) / k;
+        q[0] = 0.25f * k;
+        q[1] = (r[3] + r[1]) / k;
+        q[2] = (r[6] + r[2]) / k;
+    }
+    else if (r[4] > r[8])
+    {
+        float k = 2.0f * sqrtf(1.0f + r[4] - r[0] - r[8]);
+        q[3] = (r[6] - r[2]) / k;
+        q[0] = (r[3] + r[1]) / k;
+        q[1] = 0.25f * k;
+        q[2] = (r[7] + r[5]) / k;
+    }
+    else
+    {
+        float k = 2.0f * sqrtf(1.0f + r[8] - r[0] - r[4]);
+        q[3] = (r[1] - r[3]) / k;
+        q[0] = (r[6] + r[2]) / k;
+        q[1] = (r[7] + r[5]) / k;
+        q[2] = 0.25f * k;
+    }
+}
+
+// Same as gluPerspective, fovy in degrees
+inline void mat4_perspective(float m[16], float fovy, float aspect, float znear, float zfar)
+{
+    float f = 1.0f / tanf(fovy * 0.5f * 3.14159265358979f / 180.0f);
+    memset(m, 0, sizeof(float) * 16);
+    m[0] = f / aspect;
+    m[5] = f;
+    m[10] = (zfar + znear) / (znear - zfar);
+    m[11] = -1.0f;
+    m[14] = (2.0f * zfar * znear) / (znear - zfar);
+}
+
+// Same as gluLookAt
+inline void mat4_lookat(float m[16], const float eye[3], const float center[3], const float up[3])
+{
+    float f[3] = { center[0] - eye[0], center[1] - eye[1], center[2] - eye[2] };
+    float fl = sqrtf(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+    f[0] /= fl; f[1] /= fl; f[2] /= fl;
+
+    float s[3] = { f[1] * up[2] - f[2] * up[1], f[2] * up[0] - f[0] * up[2], f[0] * up[1] - f[1] * up[0] };
+    float sl = sqrtf(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+    s[0] /= sl; s[1] /= sl; s[2] /= sl;
+
+    float u[3] = { s[1] * f[2] - s[2] * f[1], s[2] * f[0] - s[0] * f[2], s[0] * f[1] - s[1] * f[0] };
+
+    m[0] = s[0]; m[4] = s[1]; m[8] = s[2];
+    m[1] = u[0]; m[5] = u[1]; m[9] = u[2];
+    m[2] = -f[0]; m[6] = -f[1]; m[10] = -f[2];
+    m[3] = m[7] = m[11] = 0.0f;
+    m[12] = -(s[0] * eye[0] + s[1] * eye[1] + s[2] * eye[2]);
+    m[13] = -(u[0] * eye[0] + u[1] * eye[1] + u[2] * eye[2]);
+    m[14] = (f[0] * eye[0] + f[1] * eye[1] + f[2] * eye[2]);
+    m[15] = 1.0f;
+}
+
+inline void aabb_empty(float b[6])
+{
+    b[0] = b[1] = b[2] = FLT_MAX;
+    b[3] = b[4] = b[5] = -FLT_MAX;
+}
+
+inline void aabb_merge(float out[6], const float b[6])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        if (b[i] < out[i]) out[i] = b[i];
+        if (b[i + 3] > out[i + 3]) out[i + 3] = b[i + 3];
+    }
+}
+
+// Transforms a box by an affine matrix and returns the box enclosing the result (Arvo)
+inline void aabb_transform(float out[6], const float b[6], const float m[16])
+{
+    float r[6] = { m[12], m[13], m[14], m[12], m[13], m[14] };
+    for (int row = 0; row < 3; row++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            float e = m[c * 4 + row] * b[c];
+            float f = m[c * 4 + row] * b[c + 3];
+            r[row] += e < f ? e : f;
+            r[row + 3] += e < f ? f : e;
+        }
+    }
+    memcpy(out, r, sizeof(r));
+}
+
+typedef struct
+{
+    float planes[6][4];  // left, right, bottom, top, near, far; normals point inwards
+} Frustum;
+
+enum FrustumResult
+{
+    FRUSTUM_OUTSIDE = 0,
+    FRUSTUM_INTERSECT = 1,
+    FRUSTUM_INSIDE = 2
+};
+
+// Extracts the clip planes from a projection * view matrix (Gribb/Hartmann)
+inline void frustum_from_matrix(Frustum *frustum, const float m[16])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            frustum->planes[i * 2 + 0][k] = m[k * 4 + 3] + m[k * 4 + i];
+            frustum->planes[i * 2 + 1][k] = m[k * 4 + 3] - m[k * 4 + i];
+        }
+    }
+
+    for (int i = 0; i < 6; i++)
+    {
+        float *p = frustum->planes[i];
+        float l = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        if (l > 0.0f)
+        {
+            p[0] /= l; p[1] /= l; p[2] /= l; p[3] /= l;
+        }
+    }
+}
+
+// Tests a box against the planes that are still set in `mask'. Planes the box is
+// completely inside of are cleared from the mask so children can skip them.
+inline FrustumResult frustum_test_aabb(const Frustum &frustum, const float b[6], unsigned int *mask)
+{
+    FrustumResult result = FRUSTUM_INSIDE;
+    for (int i = 0; i < 6; i++)
+    {
+        if ((*mask & (1u << i)) == 0) continue;
+
+        const float *p = frustum.planes[i];
+        float px = p[0] >= 0.0f ? b[3] : b[0];
+        float py = p[1] >= 0.0f ? b[4] : b[1];
+        float pz = p[2] >= 0.0f ? b[5] : b[2];
+        if (p[0] * px + p[1] * py + p[2] * pz + p[3] < 0.0f) return FRUSTUM_OUTSIDE;
+
+        float nx = p[0] >= 0.0f ? b[0] : b[3];
+        float ny = p[1] >= 0.0f ? b[1] : b[4];
+        float nz = p[2] >= 0.0f ? b[2] : b[5];
+        if (p[0] * nx + p[1] * ny + p[2] * nz + p[3] < 0.0f)
+            result = FRUSTUM_INTERSECT;
+        else
+            *mask &= ~(1u << i);
+    }
+    return result;
+}
+
+#endif // GLMATH_H
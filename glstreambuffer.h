@@ -0,0 +1,217 @@
+/* glstreambuffer - v0.1 - public domain ring buffer for per frame gpu data
+
+    Do this:
+        #define GLSTREAMBUFFER_IMPLEMENTATION
+    before you include this file in *one* C or C++ file to create the implementation.
+
+    Data that changes every frame is written straight into a persistently
+    mapped buffer, split in regions that are used round robin, one per frame.
+    A fence after each frame tells when the gpu is done reading a region, so
+    it is only waited on when the cpu runs a whole ring ahead.
+
+    Without OpenGL 4.4 the buffer is one region that is orphaned every frame.
+    Allocations then go to a cpu copy and Flush() uploads what was written.
+
+        stream.BeginFrame();
+        GLintptr offset;
+        auto p = stream.Allocate(size, 16, &offset);
+        if (p != NULL) memcpy(p, data, size);
+        stream.Flush();
+        ... draw from stream.Buffer() at offset ...
+        stream.EndFrame();
+
+    Release notes:
+        v0.1    (2026-10-18)    initial version for instance and indirect data in gltfscene
+
+LICENSE
+
+This software is in the public domain. Where that dedication is not
+recognized, you are granted a perpetual, irrevocable license to copy,
+distribute, and modify this file as you see fit.
+
+*/
+#ifndef GLSTREAMBUFFER_H
+#define GLSTREAMBUFFER_H
+
+#include <GL/gl.h>
+#include <vector>
+
+class GLStreamBuffer
+{
+    GLuint _buffer;
+    unsigned char *_mapped;               // persistent mapping, NULL when orphaning
+    std::vector<unsigned char> _staging;  // this frame's data when orphaning
+    std::vector<GLsync> _fences;          // one per region
+    size_t _regionSize;
+    int _region;                          // region handed out this frame
+    size_t _used;                         // bytes handed out in the region
+    size_t _flushed;                      // bytes uploaded when orphaning
+public:
+    GLStreamBuffer();
+    virtual ~GLStreamBuffer();
+
+    // Persistent mapping needs OpenGL 4.4, older versions get one orphaned region
+    bool Setup(size_t regionSize, int regions = 3);
+    void Cleanup();
+
+    // Waits until the gpu is done with the next region and starts handing it out
+    void BeginFrame();
+
+    // Room for size bytes in this frame's region, offset is where it starts in
+    // Buffer(). Returns NULL when the region is full.
+    void *Allocate(size_t size, size_t alignment, GLintptr *offset);
+
+    // Makes the allocations written so far visible to the gpu, does nothing when mapped
+    void Flush();
+
+    // Fences the region so it is not handed out again before the gpu read it
+    void EndFrame();
+
+    GLuint Buffer() const;
+    bool Persistent() const;
+    size_t RegionSize() const;
+};
+
+#endif // GLSTREAMBUFFER_H
+
+#ifdef GLSTREAMBUFFER_IMPLEMENTATION
+
+#include <cstring>
+
+GLStreamBuffer::GLStreamBuffer() : _buffer(0), _mapped(NULL), _regionSize(0), _region(0), _used(0), _flushed(0) { }
+
+GLStreamBuffer::~GLStreamBuffer() { }
+
+bool GLStreamBuffer::Setup(size_t regionSize, int regions)
+{
+    Cleanup();
+
+    // Allocations are aligned within a region, so regions start aligned as well
+    this->_regionSize = (regionSize + 255) & ~(size_t)255;
+
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+    glGenBuffers(1, &this->_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->_buffer);
+    if (major * 10 + minor >= 44 && regions > 1)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, this->_regionSize * regions, NULL, flags);
+        this->_mapped = (unsigned char *)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, this->_regionSize * regions, flags);
+    }
+    if (this->_mapped != NULL)
+    {
+        this->_fences.assign(regions, (GLsync)NULL);
+    }
+    else
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, this->_regionSize, NULL, GL_STREAM_DRAW);
+        this->_staging.resize(this->_regionSize);
+        this->_fences.assign(1, (GLsync)NULL);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    this->_region = 0;
+    this->_used = this->_flushed = 0;
+    return this->_buffer != 0;
+}
+
+void GLStreamBuffer::Cleanup()
+{
+    for (auto fence : this->_fences)
+    {
+        if (fence != NULL) glDeleteSync(fence);
+    }
+    this->_fences.clear();
+
+    if (this->_buffer != 0)
+    {
+        if (this->_mapped != NULL)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, this->_buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &this->_buffer);
+    }
+    this->_buffer = 0;
+    this->_mapped = NULL;
+    std::vector<unsigned char>().swap(this->_staging);
+}
+
+void GLStreamBuffer::BeginFrame()
+{
+    this->_used = this->_flushed = 0;
+    if (this->_mapped == NULL) return;
+
+    this->_region = (this->_region + 1) % (int)this->_fences.size();
+    auto& fence = this->_fences[this->_region];
+    if (fence == NULL) return;
+
+    // The first wait flushes, so the fence is sure to be submitted
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    for (;;)
+    {
+        auto result = glClientWaitSync(fence, flags, 1000000);
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) break;
+        flags = 0;
+    }
+    glDeleteSync(fence);
+    fence = NULL;
+}
+
+void *GLStreamBuffer::Allocate(size_t size, size_t alignment, GLintptr *offset)
+{
+    if (this->_buffer == 0) return NULL;
+
+    auto start = alignment > 1 ? (this->_used + alignment - 1) / alignment * alignment : this->_used;
+    if (start + size > this->_regionSize) return NULL;
+
+    this->_used = start + size;
+    if (this->_mapped == NULL)
+    {
+        *offset = (GLintptr)start;
+        return &this->_staging[start];
+    }
+
+    *offset = (GLintptr)(this->_region * this->_regionSize + start);
+    return this->_mapped + *offset;
+}
+
+void GLStreamBuffer::Flush()
+{
+    if (this->_mapped != NULL || this->_used == this->_flushed) return;
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->_buffer);
+
+    // A new store for the first upload of the frame, the driver keeps the old
+    // one alive for draws that still read it
+    if (this->_flushed == 0) glBufferData(GL_COPY_WRITE_BUFFER, this->_regionSize, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, this->_flushed, this->_used - this->_flushed, &this->_staging[this->_flushed]);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    this->_flushed = this->_used;
+}
+
+void GLStreamBuffer::EndFrame()
+{
+    if (this->_mapped == NULL)
+    {
+        Flush();
+        return;
+    }
+
+    auto& fence = this->_fences[this->_region];
+    if (fence != NULL) glDeleteSync(fence);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+GLuint GLStreamBuffer::Buffer() const { return this->_buffer; }
+
+bool GLStreamBuffer::Persistent() const { return this->_mapped != NULL; }
+
+size_t GLStreamBuffer::RegionSize() const { return this->_regionSize; }
+
+#endif // GLSTREAMBUFFER_IMPLEMENTATION
@@ -0,0 +1,450 @@
+/* gltfaccessor - v0.5 - public domain helpers to read tinygltf accessor data on the cpu
+
+    Do this:
+        #define GLTFACCESSOR_IMPLEMENTATION
+    before you include this file in *one* C or C++ file to create the implementation.
+
+    Sparse accessors are read as their base bufferView, or zeros without one,
+    with the substituted elements written over it. The readers below apply the
+    substitution to what they return, accessor_data() is only the base.
+
+    Release notes:
+        v0.1    (2026-10-18)    initial version for EXT_mesh_gpu_instancing bounds
+        v0.2    (2026-10-18)    raw element copies and index reads for merged buffers
+        v0.3    (2026-10-18)    index writes and element permutes for mesh optimization
+        v0.4    (2026-10-18)    bufferViews appended to a buffer for re-encoded attributes
+        v0.5    (2026-10-18)    sparse accessors, read in place or materialized on request
+
+LICENSE
+
+This software is in the public domain. Where that dedication is not
+recognized, you are granted a perpetual, irrevocable license to copy,
+distribute, and modify this file as you see fit.
+
+*/
+#ifndef GLTFACCESSOR_H
+#define GLTFACCESSOR_H
+
+#include <vector>
+
+#include "tiny_gltf.h"
+
+// Number of components per element, 16 for MAT4
+int accessor_component_count(int type);
+
+// Size in bytes of one component
+size_t accessor_component_size(int componentType);
+
+// Distance in bytes between two elements, honoring bufferView.byteStride
+size_t accessor_stride(const tinygltf::Model& model, const tinygltf::Accessor& accessor);
+
+// First byte of element 0, NULL when the accessor has no data. For sparse accessors
+// this is the base before the substitution.
+const unsigned char *accessor_data(const tinygltf::Model& model, const tinygltf::Accessor& accessor);
+
+// True when the readers below can return the elements, dense or sparse
+bool accessor_readable(const tinygltf::Model& model, const tinygltf::Accessor& accessor);
+
+// Indices of the substituted elements of a sparse accessor, and their tightly packed
+// values in the buffer. Returns false for dense or unreadable accessors.
+bool accessor_sparse_elements(const tinygltf::Model& model, const tinygltf::Accessor& accessor, std::vector<unsigned int>& indices, const unsigned char **values);
+
+// Converts all elements to floats, integer components are mapped to [0, 1] or
+// [-1, 1] when `normalized' is set. Returns false for unreadable accessors.
+bool accessor_read_floats(const tinygltf::Model& model, const tinygltf::Accessor& accessor, bool normalized, std::vector<float>& out);
+
+// Copies the elements without conversion into `out', tightly packed
+bool accessor_copy_elements(const tinygltf::Model& model, const tinygltf::Accessor& accessor, unsigned char *out);
+
+// Reads an unsigned byte, short or int index accessor
+bool accessor_read_indices(const tinygltf::Model& model, const tinygltf::Accessor& accessor, std::vector<unsigned int>& out);
+
+// Writes accessor.count indices back in the component type of a dense accessor
+bool accessor_write_indices(tinygltf::Model& model, const tinygltf::Accessor& accessor, const unsigned int *indices);
+
+// Moves element i to remap[i] in place, remap must be a permutation of [0, count).
+// Sparse accessors get their substituted indices remapped.
+bool accessor_permute_elements(tinygltf::Model& model, const tinygltf::Accessor& accessor, const unsigned int *remap);
+
+// Appends `data' 4 byte aligned to the buffer and returns the index of a new bufferView on it
+int accessor_add_view(tinygltf::Model& model, int buffer, const void *data, size_t byteLength, size_t byteStride, int target);
+
+// Turns a sparse accessor into a dense one on a new bufferView, for consumers that
+// need all elements in a buffer. Dense accessors are left alone.
+bool accessor_materialize(tinygltf::Model& model, tinygltf::Accessor& accessor);
+
+#endif // GLTFACCESSOR_H
+
+#ifdef GLTFACCESSOR_IMPLEMENTATION
+
+#include <algorithm>
+#include <cstring>
+
+int accessor_component_count(int type)
+{
+    if (type == TINYGLTF_TYPE_SCALAR) return 1;
+    else if (type == TINYGLTF_TYPE_VEC2) return 2;
+    else if (type == TINYGLTF_TYPE_VEC3) return 3;
+    else if (type == TINYGLTF_TYPE_VEC4) return 4;
+    else if (type == TINYGLTF_TYPE_MAT2) return 4;
+    else if (type == TINYGLTF_TYPE_MAT3) return 9;
+    else if (type == TINYGLTF_TYPE_MAT4) return 16;
+    return 0;
+}
+
+size_t accessor_component_size(int componentType)
+{
+    if (componentType == TINYGLTF_COMPONENT_TYPE_BYTE || componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) return 1;
+    else if (componentType == TINYGLTF_COMPONENT_TYPE_SHORT || componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) return 2;
+    else if (componentType == TINYGLTF_COMPONENT_TYPE_DOUBLE) return 8;
+    return 4;
+}
+
+size_t accessor_stride(const tinygltf::Model& model, const tinygltf::Accessor& accessor)
+{
+    auto elementSize = accessor_component_count(accessor.type) * accessor_component_size(accessor.componentType);
+    if (accessor.bufferView < 0) return elementSize;
+
+    auto byteStride = model.bufferViews[accessor.bufferView].byteStride;
+    return byteStride >= elementSize ? byteStride : elementSize;
+}
+
+const unsigned char *accessor_data(const tinygltf::Model& model, const tinygltf::Accessor& accessor)
+{
+    if (accessor.bufferView < 0 || accessor.bufferView >= (int)model.bufferViews.size()) return NULL;
+
+    auto& view = model.bufferViews[accessor.bufferView];
+    if (view.buffer < 0 || view.buffer >= (int)model.buffers.size()) return NULL;
+
+    auto& buffer = model.buffers[view.buffer];
+    auto offset = view.byteOffset + accessor.byteOffset;
+    if (accessor.count == 0 || offset >= buffer.data.size()) return NULL;
+
+    auto last = offset + accessor_stride(model, accessor) * (accessor.count - 1) +
+                accessor_component_count(accessor.type) * accessor_component_size(accessor.componentType);
+    if (last > buffer.data.size()) return NULL;
+
+    return &buffer.data[offset];
+}
+
+// `size' bytes at `byteOffset' in a bufferView, NULL when they are out of its buffer
+static const unsigned char *accessor_view_data(const tinygltf::Model& model, int bufferView, size_t byteOffset, size_t size)
+{
+    if (bufferView < 0 || bufferView >= (int)model.bufferViews.size()) return NULL;
+
+    auto& view = model.bufferViews[bufferView];
+    if (view.buffer < 0 || view.buffer >= (int)model.buffers.size()) return NULL;
+
+    auto& buffer = model.buffers[view.buffer];
+    auto offset = view.byteOffset + byteOffset;
+    if (offset >= buffer.data.size() || size > buffer.data.size() - offset) return NULL;
+
+    return &buffer.data[offset];
+}
+
+bool accessor_sparse_elements(const tinygltf::Model& model, const tinygltf::Accessor& accessor, std::vector<unsigned int>& indices, const unsigned char **values)
+{
+    auto& sparse = accessor.sparse;
+    if (!sparse.isSparse || sparse.count <= 0) return false;
+
+    auto indexSize = accessor_component_size(sparse.indices.componentType);
+    auto elementSize = accessor_component_count(accessor.type) * accessor_component_size(accessor.componentType);
+    auto p = accessor_view_data(model, sparse.indices.bufferView, sparse.indices.byteOffset, indexSize * sparse.count);
+    *values = accessor_view_data(model, sparse.values.bufferView, sparse.values.byteOffset, elementSize * sparse.count);
+    if (p == NULL || *values == NULL) return false;
+
+    indices.resize(sparse.count);
+    for (int k = 0; k < sparse.count; k++, p += indexSize)
+    {
+        if (indexSize == 1)
+        {
+            indices[k] = *p;
+        }
+        else if (indexSize == 2)
+        {
+            unsigned short v; memcpy(&v, p, 2);
+            indices[k] = v;
+        }
+        else
+        {
+            memcpy(&indices[k], p, 4);
+        }
+        if (indices[k] >= accessor.count) return false;
+    }
+    return true;
+}
+
+// The base of an accessor and its substituted elements, `data' is NULL for zeros
+static bool accessor_sources(const tinygltf::Model& model, const tinygltf::Accessor& accessor, const unsigned char **data,
+                             std::vector<unsigned int>& sparseIndices, const unsigned char **sparseValues)
+{
+    *data = accessor_data(model, accessor);
+    sparseIndices.clear();
+    *sparseValues = NULL;
+    if (!accessor.sparse.isSparse) return *data != NULL;
+
+    if (!accessor_sparse_elements(model, accessor, sparseIndices, sparseValues)) return false;
+    return *data != NULL || accessor.bufferView < 0;
+}
+
+bool accessor_readable(const tinygltf::Model& model, const tinygltf::Accessor& accessor)
+{
+    const unsigned char *data, *sparseValues;
+    std::vector<unsigned int> sparseIndices;
+    return accessor.count > 0 && accessor_sources(model, accessor, &data, sparseIndices, &sparseValues);
+}
+
+static float accessor_read_component(const unsigned char *p, int componentType, bool normalized)
+{
+    switch (componentType)
+    {
+        case TINYGLTF_COMPONENT_TYPE_BYTE:
+        {
+            signed char v; memcpy(&v, p, 1);
+            return normalized ? (v < -127 ? -1.0f : v / 127.0f) : (float)v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        {
+            unsigned char v = *p;
+            return normalized ? v / 255.0f : (float)v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_SHORT:
+        {
+            short v; memcpy(&v, p, 2);
+            return normalized ? (v < -32767 ? -1.0f : v / 32767.0f) : (float)v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        {
+            unsigned short v; memcpy(&v, p, 2);
+            return normalized ? v / 65535.0f : (float)v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_INT:
+        {
+            int v; memcpy(&v, p, 4);
+            return (float)v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        {
+            unsigned int v; memcpy(&v, p, 4);
+            return (float)v;
+        }
+        case TINYGLTF_COMPONENT_TYPE_DOUBLE:
+        {
+            double v; memcpy(&v, p, 8);
+            return (float)v;
+        }
+    }
+
+    float v; memcpy(&v, p, 4);
+    return v;
+}
+
+bool accessor_read_floats(const tinygltf::Model& model, const tinygltf::Accessor& accessor, bool normalized, std::vector<float>& out)
+{
+    const unsigned char *data, *sparseValues;
+    std::vector<unsigned int> sparseIndices;
+    if (!accessor_sources(model, accessor, &data, sparseIndices, &sparseValues)) return false;
+
+    auto components = accessor_component_count(accessor.type);
+    auto componentSize = accessor_component_size(accessor.componentType);
+    auto stride = accessor_stride(model, accessor);
+
+    out.resize(accessor.count * components);
+    if (data == NULL)
+    {
+        std::fill(out.begin(), out.end(), 0.0f);
+    }
+    else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && stride == components * sizeof(float))
+    {
+        memcpy(out.data(), data, out.size() * sizeof(float));
+    }
+    else
+    {
+        for (size_t i = 0; i < accessor.count; i++)
+        {
+            for (int c = 0; c < components; c++)
+            {
+                out[i * components + c] = accessor_read_component(data + i * stride + c * componentSize, accessor.componentType, normalized);
+            }
+        }
+    }
+
+    for (size_t k = 0; k < sparseIndices.size(); k++)
+    {
+        for (int c = 0; c < components; c++)
+        {
+            out[sparseIndices[k] * components + c] = accessor_read_component(sparseValues + (k * components + c) * componentSize, accessor.componentType, normalized);
+        }
+    }
+    return true;
+}
+
+bool accessor_copy_elements(const tinygltf::Model& model, const tinygltf::Accessor& accessor, unsigned char *out)
+{
+    const unsigned char *data, *sparseValues;
+    std::vector<unsigned int> sparseIndices;
+    if (!accessor_sources(model, accessor, &data, sparseIndices, &sparseValues)) return false;
+
+    auto elementSize = accessor_component_count(accessor.type) * accessor_component_size(accessor.componentType);
+    auto stride = accessor_stride(model, accessor);
+    if (data == NULL)
+        memset(out, 0, elementSize * accessor.count);
+    else if (stride == elementSize)
+        memcpy(out, data, elementSize * accessor.count);
+    else
+        for (size_t i = 0; i < accessor.count; i++) memcpy(out + i * elementSize, data + i * stride, elementSize);
+
+    for (size_t k = 0; k < sparseIndices.size(); k++) memcpy(out + sparseIndices[k] * elementSize, sparseValues + k * elementSize, elementSize);
+    return true;
+}
+
+static bool accessor_read_index(const unsigned char *p, int componentType, unsigned int *index)
+{
+    if (componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
+    {
+        *index = *p;
+    }
+    else if (componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+    {
+        unsigned short v; memcpy(&v, p, 2);
+        *index = v;
+    }
+    else if (componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+    {
+        memcpy(index, p, 4);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+static bool accessor_write_index(unsigned char *p, int componentType, unsigned int index)
+{
+    if (componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
+    {
+        *p = (unsigned char)index;
+    }
+    else if (componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+    {
+        unsigned short v = (unsigned short)index;
+        memcpy(p, &v, 2);
+    }
+    else if (componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+    {
+        memcpy(p, &index, 4);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+bool accessor_read_indices(const tinygltf::Model& model, const tinygltf::Accessor& accessor, std::vector<unsigned int>& out)
+{
+    const unsigned char *data, *sparseValues;
+    std::vector<unsigned int> sparseIndices;
+    if (!accessor_sources(model, accessor, &data, sparseIndices, &sparseValues) || accessor.type != TINYGLTF_TYPE_SCALAR) return false;
+
+    auto stride = accessor_stride(model, accessor);
+    out.assign(accessor.count, 0);
+    for (size_t i = 0; i < accessor.count && data != NULL; i++)
+    {
+        if (!accessor_read_index(data + i * stride, accessor.componentType, &out[i])) return false;
+    }
+
+    auto indexSize = accessor_component_size(accessor.componentType);
+    for (size_t k = 0; k < sparseIndices.size(); k++)
+    {
+        if (!accessor_read_index(sparseValues + k * indexSize, accessor.componentType, &out[sparseIndices[k]])) return false;
+    }
+    return true;
+}
+
+bool accessor_write_indices(tinygltf::Model& model, const tinygltf::Accessor& accessor, const unsigned int *indices)
+{
+    auto data = const_cast<unsigned char *>(accessor_data(model, accessor));
+    if (data == NULL || accessor.sparse.isSparse || accessor.type != TINYGLTF_TYPE_SCALAR) return false;
+
+    auto stride = accessor_stride(model, accessor);
+    for (size_t i = 0; i < accessor.count; i++)
+    {
+        if (!accessor_write_index(data + i * stride, accessor.componentType, indices[i])) return false;
+    }
+    return true;
+}
+
+bool accessor_permute_elements(tinygltf::Model& model, const tinygltf::Accessor& accessor, const unsigned int *remap)
+{
+    const unsigned char *base, *sparseValues;
+    std::vector<unsigned int> sparseIndices;
+    if (!accessor_sources(model, accessor, &base, sparseIndices, &sparseValues)) return false;
+
+    auto elementSize = accessor_component_count(accessor.type) * accessor_component_size(accessor.componentType);
+    if (base != NULL)
+    {
+        auto data = const_cast<unsigned char *>(base);
+        auto stride = accessor_stride(model, accessor);
+
+        std::vector<unsigned char> copy(elementSize * accessor.count);
+        for (size_t i = 0; i < accessor.count; i++) memcpy(&copy[i * elementSize], data + i * stride, elementSize);
+        for (size_t i = 0; i < accessor.count; i++) memcpy(data + remap[i] * stride, &copy[i * elementSize], elementSize);
+    }
+    if (sparseIndices.empty()) return true;
+
+    // The substituted elements follow their index, sorted again as the spec wants them
+    std::vector<std::pair<unsigned int, size_t> > order(sparseIndices.size());
+    for (size_t k = 0; k < order.size(); k++) order[k] = std::make_pair(remap[sparseIndices[k]], k);
+    std::sort(order.begin(), order.end());
+
+    auto& sparse = accessor.sparse;
+    auto indexSize = accessor_component_size(sparse.indices.componentType);
+    auto indices = const_cast<unsigned char *>(accessor_view_data(model, sparse.indices.bufferView, sparse.indices.byteOffset, indexSize * order.size()));
+    auto values = const_cast<unsigned char *>(sparseValues);
+
+    std::vector<unsigned char> copy(values, values + elementSize * order.size());
+    for (size_t k = 0; k < order.size(); k++)
+    {
+        accessor_write_index(indices + k * indexSize, sparse.indices.componentType, order[k].first);
+        memcpy(values + k * elementSize, &copy[order[k].second * elementSize], elementSize);
+    }
+    return true;
+}
+
+int accessor_add_view(tinygltf::Model& model, int buffer, const void *data, size_t byteLength, size_t byteStride, int target)
+{
+    auto& bytes = model.buffers[buffer].data;
+    bytes.resize((bytes.size() + 3) & ~(size_t)3);
+
+    tinygltf::BufferView view;
+    view.buffer = buffer;
+    view.byteOffset = bytes.size();
+    view.byteLength = byteLength;
+    view.byteStride = byteStride;
+    view.target = target;
+
+    bytes.insert(bytes.end(), (const unsigned char *)data, (const unsigned char *)data + byteLength);
+    model.bufferViews.push_back(view);
+    return (int)model.bufferViews.size() - 1;
+}
+
+bool accessor_materialize(tinygltf::Model& model, tinygltf::Accessor& accessor)
+{
+    if (!accessor.sparse.isSparse) return true;
+
+    auto elementSize = accessor_component_count(accessor.type) * accessor_component_size(accessor.componentType);
+    std::vector<unsigned char> dense(elementSize * accessor.count);
+    if (!accessor_copy_elements(model, accessor, dense.data())) return false;
+
+    // The dense copy goes in the buffer of the substituted values, with the target of the base
+    auto target = accessor.bufferView >= 0 ? model.bufferViews[accessor.bufferView].target : 0;
+    auto buffer = model.bufferViews[accessor.sparse.values.bufferView].buffer;
+    accessor.bufferView = accessor_add_view(model, buffer, dense.data(), dense.size(), 0, target);
+    accessor.byteOffset = 0;
+    accessor.sparse.isSparse = false;
+    return true;
+}
+
+#endif // GLTFACCESSOR_IMPLEMENTATION
@@ -1,4 +1,4 @@
-/* gltfscene - v0.1 - public domain gltf 2.0 model renderer for opengl
+/* gltfscene - v0.27 - public domain gltf 2.0 model renderer for opengl
 
     Do this:
         #define GLSCENE_IMPLEMENTATION
@@ -6,6 +6,32 @@
 
     Release notes:
         v0.1    (2017-07-13)    initial version based on tiny_gltf glview.cc
+        v0.2    (2026-10-18)    draw items with world bounds, frustum culling through a BVH
+        v0.3    (2026-10-18)    draw items sharing a primitive are drawn instanced
+        v0.4    (2026-10-18)    EXT_mesh_gpu_instancing nodes drawn from their instance accessors
+        v0.5    (2026-10-18)    GLSCENE_MERGED_BUFFERS, vertex arenas and glMultiDrawElementsIndirect
+        v0.6    (2026-10-18)    GLSCENE_GENERATE_LODS, simplified index lists picked by projected size
+        v0.7    (2026-10-18)    GLSCENE_OCCLUSION_CULLING, the largest items occlude others on the cpu
+        v0.8    (2026-10-18)    GLSCENE_OPTIMIZE_MESHES, vertex cache, overdraw and fetch order at setup
+        v0.9    (2026-10-18)    normalized accessors, KHR_mesh_quantization and GLSCENE_QUANTIZE_VERTICES
+        v0.10   (2026-10-18)    GLSCENE_INTERLEAVED_BUFFERS, one interleaved vertex buffer per attribute set
+        v0.11   (2026-10-18)    only the bufferView ranges that drawing reads are uploaded, targets come from usage
+        v0.12   (2026-10-18)    instance updates and indirect commands stream through a persistently mapped ring
+        v0.13   (2026-10-18)    textures shared per glTF texture with mip chains, glTF samplers as cached sampler objects
+        v0.14   (2026-10-18)    GLSCENE_COMPRESS_TEXTURES, BC1/BC3 encoding on the worker threads with a disk cache
+        v0.15   (2026-10-18)    KTX2 images with RGB8, RGBA8 or BC levels, uploaded as stored or decoded to RGBA8 on the workers
+        v0.16   (2026-10-18)    GLSCENE_TEXTURE_ARRAYS, same sized textures as array layers, merged buckets span materials
+        v0.17   (2026-10-18)    Animate() plays glTF animations onto the scene graph through sceneanimation
+        v0.18   (2026-10-18)    skinned primitives drawn with SetSkinningProgram, joint palettes streamed as uniform blocks
+        v0.19   (2026-10-18)    morph targets blended on the cpu from their non-zero deltas, or by SetMorphProgram from a texture buffer
+        v0.20   (2026-10-18)    sparse accessors, materialized only for attributes and indices that are uploaded
+        v0.21   (2026-10-18)    animation channel groups, scene graph subtrees and joint palettes updated on the worker threads
+        v0.22   (2026-10-18)    GLSCENE_COMPRESS_ANIMATIONS, reduced and quantized keys through animcompress, see SetAnimationTolerance
+        v0.23   (2026-10-18)    SetVertexAnimation bakes deformed primitives into frames drawn instanced with per-instance time offsets
+        v0.24   (2026-10-18)    GLSCENE_ANIMATION_LOD, distant subtrees sampled less often and without leaf joints, hidden ones frozen
+        v0.25   (2026-10-18)    the workers are ThreadPool::Shared(), images decode on them, skins and morphs update as tasks
+        v0.26   (2026-10-18)    Publish() hands a frame to Draw() as a GLFramePacket, so culling and drawing can run on separate threads
+        v0.27   (2026-10-18)    GLScene(ThreadPool&) and Load(tinygltf::Model), Animate() and Cull() run without a gl context, draw items update on the workers
 
 LICENSE
 
@@ -18,6 +44,7 @@ distribute, and modify this file as you see fit.
 #define GLSCENE_H
 
 #include <iostream>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -25,38 +52,475 @@ distribute, and modify this file as you see fit.
 #include <GL/gl.h>
 
 #include "tiny_gltf.h"
+#include "gltfaccessor.h"
+#include "glstreambuffer.h"
+#include "occlusion.h"
+#include "scenebvh.h"
+#include "scenegraph.h"
+#include "animcompress.h"
+#include "sceneanimation.h"  // after gltfaccessor.h, scenegraph.h and animcompress.h
+#include "threadpool.h"
 
 #define BUFFER_OFFSET(i) ((char *)NULL + (i))
 
+// Setup flags
+#define GLSCENE_MERGED_BUFFERS 0x1  // pack primitives into arenas and draw with glMultiDrawElementsIndirect, needs OpenGL 4.3
+#define GLSCENE_GENERATE_LODS 0x2   // simplify triangle primitives into a chain of index lists, see SetLodChain
+#define GLSCENE_OCCLUSION_CULLING 0x4  // rasterize the largest visible items on the cpu and skip what they hide, see SetOcclusion
+#define GLSCENE_OPTIMIZE_MESHES 0x8    // reorder indices and vertices of triangle primitives in place for the vertex cache and fetch
+#define GLSCENE_OPTIMIZE_OVERDRAW 0x10 // with GLSCENE_OPTIMIZE_MESHES, also sort triangle clusters to reduce overdraw
+#define GLSCENE_QUANTIZE_VERTICES 0x20 // re-encode float positions, normals and texture coordinates as KHR_mesh_quantization integers
+#define GLSCENE_INTERLEAVED_BUFFERS 0x40  // pack the attributes of a vertex next to each other, also inside merged arenas
+#define GLSCENE_COMPRESS_TEXTURES 0x80    // encode textures as BC1/BC3 at setup, needs EXT_texture_compression_s3tc, see SetTextureCache
+#define GLSCENE_TEXTURE_ARRAYS 0x100      // pack same sized textures into GL_TEXTURE_2D_ARRAY layers, needs in_layer and diffuseArray in the shader
+#define GLSCENE_COMPRESS_ANIMATIONS 0x200 // drop animation keys within a tolerance and quantize the rest, see SetAnimationTolerance
+#define GLSCENE_ANIMATION_LOD 0x400       // animate subtrees by their distance to the camera of the last Cull(), see SetAnimationLod
+
+typedef struct {
+    int tested;   // bounding boxes tested against the frustum
+    int visible;  // draw items that passed
+    int culled;   // draw items that were rejected
+    int occluded; // draw items in the frustum hidden behind occluders
+    int drawCalls;  // of the last Draw(), counted on the thread that draws
+    int triangles;  // index count / 3 of everything submitted
+    int textureBinds;
+    int animated[3];  // subtrees sampled by Animate() at each GLSCENE_ANIMATION_LOD tier
+    int blended;      // subtrees moved between two samples
+    int frozen;       // subtrees with nothing visible in the last Cull(), left as they are
+    int deferred;     // subtrees due for a sample that did not fit the budget
+} GLSceneStats;
+
+// What Draw() reads of a frame. Publish() fills it after Cull(), so one thread can draw
+// a frame while another animates and culls the next one. Moved instance slots, morphs and
+// vertex animation instances are passed on once, so every packet has to be drawn in order.
+typedef struct {
+    float projection[16];  // of the Cull()
+    float view[16];
+    std::vector<int> visible;
+    std::vector<float> worlds;          // 16 per visible item, for items drawn with their node transform
+    std::vector<unsigned char> itemLods;
+    std::vector<unsigned char> slotLods;
+    std::vector<int> dirtySlots;        // instance slots moved since the previous packet
+    std::vector<float> slotMatrices;    // 16 per dirty slot
+    std::vector<float> jointMatrices;
+    std::vector<std::vector<std::pair<int, float> > > morphs;  // active targets of every morph
+    std::vector<unsigned char> morphsChanged;                  // since the previous packet
+    std::vector<float> vatInstances;    // empty when they did not move
+    float vatFrame;
+} GLFramePacket;
+
+typedef struct {
+    int minFilter;
+    int magFilter;
+    int wrapS;
+    int wrapT;
+} GLSamplerKey;
+
 class GLScene
 {
-    typedef struct { GLuint vb; } GLBufferState;
+    typedef struct {
+        GLuint vb;
+        size_t first;  // byte of the bufferView at the start of the buffer
+    } GLBufferState;
 
     typedef struct {
-        std::map<int, GLuint> diffuseTex;  // for each primitive in mesh
+        std::map<int, GLuint> diffuseTex;      // for each primitive in mesh
+        std::map<int, GLuint> diffuseSampler;  // same, 0 without sampler objects
+        std::map<int, int> diffuseLayer;       // layer when diffuseTex is an array, else -1
     } GLMeshState;
 
+    // One primitive of a mesh instanced by a node. For EXT_mesh_gpu_instancing
+    // nodes the item covers all instances and the bounds enclose all of them.
+    typedef struct {
+        int node;
+        int mesh;
+        int primitive;
+        int instanceCount;  // 0 for plain nodes
+        int skin;           // -1 when the primitive is not skinned
+        int morph;          // in _morphs, -1 without morph targets
+        int vat;            // in _vertexAnimations, -1 when not baked
+        float localBounds[6];
+    } GLDrawItem;
+
+    // The joint matrices of a glTF skin are next to each other in _jointMatrices.
+    // Meshes sharing a skin share its matrices, they are computed once per update.
+    typedef struct {
+        int firstJoint;
+        int jointCount;
+        bool changed;       // a joint moved in the last update
+        int paletteOffset;  // in the uniform data of a frame, -1 when not drawn skinned
+        bool baked;         // every item of the skin plays a vertex animation, its joints are not needed
+    } GLSkin;
+
+    // Morph targets of a primitive, shared by every node drawing it. The cpu path keeps
+    // the vertices each target moves, the gpu path all deltas in a texture buffer.
+    // Both store positions and then normals as 4 floats per vertex.
+    typedef struct {
+        int mesh;
+        int primitive;
+        int targetCount;
+        size_t vertexCount;
+        bool normals;                      // NORMAL is morphed too
+        bool cpu;                          // some node blends these on the cpu
+        float baseBounds[6];
+        std::vector<float> bounds;         // 6 per target, of its position deltas
+        std::vector<float> base;           // vertices without targets applied
+        std::vector<size_t> firstMoved;    // per target and one past the last, in moved
+        std::vector<unsigned int> moved;   // vertices a target moves
+        std::vector<float> deltas;         // of the moved vertices, 4 floats or 8 with normals
+        GLint firstTexel;                  // in _morphTexture, -1 when not on the gpu
+    } GLMorphTargets;
+
+    // Morph state of a draw item, the weights themselves are in the scene graph
+    typedef struct {
+        int targets;        // in _morphTargets
+        int node;
+        bool changed;       // weights changed in the last update
+        bool dirty;         // weights changed since the last Publish()
+        int bufferOffset;   // bytes in _morphBuffer, -1 when always blended on the gpu
+        float bounds[6];    // local bounds with the current weights
+        std::vector<std::pair<int, float> > active;  // targets with a non-zero weight
+    } GLMorph;
+
+    // A deformed primitive baked by SetVertexAnimation: the position and normal of every
+    // vertex at every frame, evaluated for one of its items. All items of the primitive
+    // play these frames, each placed where its skeleton root or its node is.
+    typedef struct {
+        int mesh;
+        int primitive;
+        int source;         // draw item the frames are evaluated for
+        bool skinned;
+        int firstTexel;     // in _vatTexture, 2 * vertexCount texels per frame, normals after position offsets
+        int vertexCount;
+        int firstSlot;      // in _vatInstances
+        int count;
+        float bounds[6];    // of all frames, relative to the skeleton root or the node
+    } GLVertexAnimation;
+
+    // Throttled playback of a scene graph subtree, between a sample and the next one
+    // the graph is blended from the pose it showed to the pose at the next sample
+    typedef struct {
+        float from;     // animation time of the last sample
+        float to;       // time of the next one
+        bool all;       // with optional channels
+        bool blending;  // the poses are valid
+    } GLSubtreeAnimation;
+
+    // What Animate() does with a group of the played animation
+    typedef struct {
+        int action;     // 0 nothing, 1 apply, 2 blend or apply and then sample the next pose, 3 blend
+        float time;     // of the next pose
+        float blend;    // -1 to apply instead
+        bool all;
+    } GLGroupPlan;
+
+    // Draw items with the same vertex data, indices and material, their world
+    // matrices are stored next to each other in the instance buffer
+    typedef struct {
+        int mesh;       // representative primitive used for binding
+        int primitive;
+        int firstSlot;
+        int count;
+    } GLBatch;
+
+    // All primitives with the same vertex attribute layout share one buffer. Each
+    // attribute is a tightly packed stream in it, or all attributes of a vertex
+    // are interleaved, so a primitive is addressed by one base vertex for all
+    // attributes. Without merged buffers an arena holds the vertices of the
+    // primitives sharing one set of attribute accessors.
+    typedef struct {
+        std::string name;
+        int componentType;
+        int components;
+        GLboolean normalized;
+        size_t offset;  // start of the stream in the buffer, or in the vertex when interleaved
+    } GLArenaStream;
+
+    typedef struct {
+        std::vector<GLArenaStream> streams;
+        size_t vertexCount;
+        GLsizei stride;  // 0 for separate streams
+        GLuint vb;
+    } GLArena;
+
+    typedef struct {
+        int arena;
+        GLuint firstIndex;  // in the index arena, all indices are stored as unsigned int
+        GLint baseVertex;
+        GLsizei count;
+    } GLArenaRange;
+
+    // Layout expected by glMultiDrawElementsIndirect
+    typedef struct {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    } GLDrawCommand;
+
+    // Batches that can be drawn with the same bindings and mode. Materials whose
+    // textures are layers of one array share a bucket.
+    typedef struct {
+        int arena;
+        GLuint texture;  // 0 without material
+        GLuint sampler;
+        bool array;
+        int mode;
+    } GLDrawBucket;
+
+    // A coarser index list for the vertices of a primitive. Level 0 is the
+    // primitive itself, a chain holds levels 1 and up.
+    typedef struct {
+        std::vector<unsigned int> indices;  // released after upload
+        GLsizei count;
+        float error;        // relative to the size of the primitive
+        GLuint ib;          // unsigned int element buffer, when not merged
+        GLuint firstIndex;  // in the index arena, when merged
+    } GLLod;
+
+    // Cpu copy of a primitive for the occlusion buffer, empty when it can not occlude
+    typedef struct {
+        std::vector<float> positions;
+        std::vector<unsigned int> indices;
+    } GLOccluderMesh;
+
     tinygltf::Model _model;
+    unsigned int _flags;
     std::map<int, GLBufferState> _buffers;
     std::map<std::string, GLMeshState> _meshStates;
+    std::map<int, GLuint> _textures;              // by glTF texture index
+    std::map<GLSamplerKey, GLuint> _samplers;
+    std::string _textureCache;                    // directory for compressed levels, empty to always encode
+    int _compressedTextures[2];                   // encoded, read from the cache
+    bool _s3tc;                                   // driver samples BC1/BC3
+    bool _bptc;                                   // driver samples BC7
+    bool _samplerObjects;                         // OpenGL 3.3, otherwise textures carry the sampler state
+    bool _uniformBuffers;                         // for joint palettes
+    bool _textureBuffers;                         // for morph deltas and vertex animation frames
+    std::map<int, int> _textureLayers;            // by glTF texture index, for textures in an array
+    GLuint _boundTextures[2];                     // unit 0 2D, unit 1 array, ~0 when unknown
+    GLuint _boundSamplers[2];
     std::map<std::string, GLint> _attribs;
 
+    SceneGraph _graph;
+    SceneAnimation _animation;
+    float _animationTolerance;       // in the units of translation, scale and weights
+    float _animationAngleTolerance;  // in radians
+    SceneBVH _bvh;
+    std::vector<GLDrawItem> _drawItems;
+    std::vector<float> _worldBounds;  // 6 per draw item
+    std::vector<int> _visible;        // draw items to submit in Draw()
+    float _cullProjection[16];        // of the last Cull()
+    float _cullView[16];
+    GLFramePacket _frame;             // for Draw() without a packet
+    GLSceneStats _stats;
+
+    std::vector<GLBatch> _batches;
+    std::vector<int> _itemSlots;           // instance slot of each draw item
+    std::vector<int> _slotBatches;         // batch of each instance slot
+    std::vector<float> _instanceMatrices;  // 16 per slot
+    std::vector<int> _dirtySlots;          // slots to hand to the next Publish()
+    std::vector<int> _visibleSlots;
+    GLuint _instanceBuffer;
+    GLStreamBuffer _stream;  // per frame instance updates and indirect commands
+    GLint _modelAttrib;
+    GLint _layerAttrib;
+    GLuint _layerBuffer;  // texture array layer of every slot, for merged draws
+    std::map<std::string, GLint> _instanceAttribs;  // EXT_mesh_gpu_instancing attribute name to location
+
+    GLuint _program;
+    GLuint _skinProgram;  // 0 when skinned primitives are drawn in their bind pose
+    std::vector<GLSkin> _skins;
+    std::vector<float> _inverseBindMatrices;  // 16 per joint
+    std::vector<float> _jointMatrices;        // 16 per joint, joint world matrix times inverse bind matrix
+    GLint _paletteBlockSize;                  // bytes of the JointPalette uniform block
+    GLint _paletteAlignment;
+    size_t _paletteSize;                      // bytes of all palettes of a frame
+    GLuint _paletteBuffer;                    // uniform buffer for when the stream is full
+    std::vector<unsigned char> _palettes;
+
+    GLuint _morphProgram;  // 0 when all morph targets are blended on the cpu
+    std::map<std::string, GLint> _morphUniforms;
+    GLint _morphSlots;     // active targets one draw of the morph program takes
+    std::vector<GLMorphTargets> _morphTargets;
+    std::map<std::pair<int, int>, int> _primitiveMorphs;  // targets of each mesh and primitive, -1 when unusable
+    std::vector<GLMorph> _morphs;
+    GLuint _morphDeltaBuffer;
+    GLuint _morphTexture;  // GL_TEXTURE_BUFFER of _morphDeltaBuffer
+    GLuint _morphBuffer;   // vertices blended on the cpu
+    size_t _morphBufferSize;
+    std::vector<float> _morphScratch;
+    std::vector<unsigned char> _morphStale;  // blended vertices older than the weights drawn
+    std::vector<int> _visibleDeformed;  // skinned or morphed, drawn one by one, by position in the visible items
+
+    GLuint _vatProgram;    // 0 when deformed items are skinned and morphed every frame
+    int _vatAnimation;
+    float _vatFrameRate;
+    int _vatFrameCount;
+    float _vatFrame;       // of the last Animate() of _vatAnimation
+    std::map<std::string, GLint> _vatUniforms;
+    GLint _vatOffsetAttrib;
+    std::vector<GLVertexAnimation> _vertexAnimations;
+    std::vector<int> _vatSlots;         // instance slot of each draw item, -1 when not baked
+    std::vector<int> _vatAnchors;       // node placing each slot, -1 when it stays where it is
+    std::vector<float> _vatPlacements;  // 16 per slot, the skeleton root or node relative to its anchor
+    std::vector<float> _vatInstances;   // 17 per slot, world matrix and frame offset
+    std::map<int, float> _timeOffsets;  // seconds by node
+    bool _vatDirty;                     // _vatInstances changed since the last Publish()
+    GLuint _vatBuffer;
+    GLuint _vatTexture;                 // GL_TEXTURE_BUFFER of _vatBuffer
+    GLuint _vatInstanceBuffer;
+    std::vector<int> _visibleVat;       // slots
+
+    float _animationLodDistance;        // tier 1 starts here and tier 2 at twice the distance
+    int _animationLodInterval;          // frames between samples in tier 1, twice as many in tier 2
+    int _animationBudget;               // samples in tiers 1 and 2 per Animate(), 0 for no limit
+    bool _hasCamera;
+    float _cameraPosition[3];           // of the last Cull()
+    int _lodAnimation;                  // the subtree states are of this animation
+    float _animationTime;               // of the last Animate()
+    float _animationStep;               // between the last two Animate() calls
+    std::vector<int> _itemSubtrees;     // subtree animating each draw item, -1 for none
+    std::vector<GLSubtreeAnimation> _subtreeAnimations;
+    std::vector<float> _subtreeBounds;  // 6 per subtree, of its items in the last Cull()
+    std::vector<unsigned char> _subtreeVisible;
+    std::vector<GLGroupPlan> _groupPlans;
+    std::vector<std::pair<float, int> > _dueGroups;  // how long overdue and group
+
+    std::vector<GLArena> _arenas;
+    std::map<std::pair<int, int>, GLArenaRange> _arenaRanges;  // by mesh and primitive index
+    GLuint _indexArena;
+    GLuint _indirectBuffer;
+    std::vector<GLDrawBucket> _buckets;
+    std::vector<int> _batchBuckets;              // -1 when the batch is not in an arena
+    std::vector<GLDrawCommand> _batchCommands;   // count, firstIndex and baseVertex of each batch
+    std::vector<GLDrawCommand> _commands;        // built in Draw(), in run order
+    std::vector<int> _commandBuckets;
+    std::vector<GLDrawCommand> _bucketCommands;  // _commands sorted by bucket
+    std::vector<int> _bucketOffsets;
+
+    int _lodLevels;
+    float _lodReduction;
+    float _lodThreshold;
+    std::vector<std::vector<GLLod> > _lodChains;
+    std::map<std::pair<int, int>, int> _primitiveLods;  // chain of each mesh and primitive
+    std::vector<int> _itemLodChains;                    // -1 without a chain
+    std::vector<int> _batchLodChains;
+    std::vector<unsigned char> _itemLods;               // current level of each draw item
+    std::vector<unsigned char> _slotLods;               // same, for each instance slot
+
+    OcclusionBuffer _occlusion;
+    int _occlusionWidth;
+    int _occlusionHeight;
+    int _maxOccluders;
+    std::map<std::pair<int, int>, GLOccluderMesh> _occluderMeshes;  // by mesh and primitive, filled on first use
+    std::vector<std::pair<float, int> > _occluders;                 // projected size and draw item
+
+    ThreadPool& _workers;  // ThreadPool::Shared() unless the scene was given a pool
+    std::vector<int> _pendingSubtrees;
+    std::vector<unsigned char> _subtreeChanges;
+    std::vector<unsigned char> _itemChanges;  // 1 for a moved baked item, 2 for a moved instance slot
+
+    void buildDrawItems();
+    void buildBatches();
+    void buildArenas();
+    void buildInterleaved();
+    void packArena(int arena, const std::vector<std::vector<unsigned char> >& streams);
+    void buildBuckets();
+    void prepareModel();
+    void materializeAccessors();
+    void buildScene();
+    void buildSkins();
+    bool updateGraph();
+    bool setupSkinning(GLuint prog);
+    void buildMorphs();
+    bool setupMorphing(GLuint prog);
+    void packMorphs();
+    void uploadMorphTargets();
+    bool setupVertexAnimation(GLuint prog);
+    void buildVertexAnimations();
+    void bakeVertexAnimations();
+    void buildAnimationLod();
+    void planAnimation(int animation, float time);
+    void buildLods();
+    void optimizeMeshes();
+    void quantizeMeshes();
+    void uploadBufferViews();
+    void buildTextures();
+    void buildTextureArrays();
+    GLuint getTexture(int texture, GLuint *sampler);
+    void compressLevels(const tinygltf::Image& image, int format, std::vector<std::vector<unsigned char> >& levels);
+    bool uploadImage(const tinygltf::Image& image);
+    bool uploadKtx2(const tinygltf::Image& image);
+    void selectLods(const float projection[16], const float view[16]);
+    const GLOccluderMesh& occluderMesh(int meshIndex, int primitiveIndex);
+    void cullOccluded(const float viewProjection[16], const float projection[16], const float view[16]);
+    void updateSkins(bool all);
+    void updateMorphs(bool all);
+    void updateDrawItems(bool all);
+    void uploadDirtySlots(const GLFramePacket& frame);
+    void bindArena(int arena);
+    void resetBindings();
+    void bindDiffuse(GLuint texture, GLuint sampler, bool array);
+    void bindPrimitive(int meshIndex, int primitiveIndex);
+    void unbindPrimitive(const tinygltf::Primitive& primitive);
+    void drawElements(int meshIndex, int primitiveIndex, GLsizei instanceCount, int lod);
+    void drawPrimitive(int meshIndex, int primitiveIndex, int lod);
+    void drawRuns(const GLFramePacket& frame, bool unmerged);
+    void drawIndirect(const GLFramePacket& frame);
+    void setConstantInstance(const float *model);
+    void drawInstancingExtension(const GLDrawItem& item, const float *world);
+    bool morphOnGpu(const GLFramePacket& frame, const GLDrawItem& item) const;
+    void blendMorphs(const GLFramePacket& frame);
+    void bindMorph(const GLMorph& morph, const std::vector<std::pair<int, float> >& active, bool gpu);
+    void drawDeformed(const GLFramePacket& frame);
+    void drawVertexAnimations(const GLFramePacket& frame);
 public:
     GLScene();
+    GLScene(ThreadPool& workers);
     virtual ~GLScene();
 
     bool Load(const std::string& filename);
-    void Setup(GLuint prog);
+    bool Load(const tinygltf::Model& model);  // built in memory
+    void SetLodChain(int levels, float reduction, float threshold);
+    void SetOcclusion(int width, int height, int maxOccluders);
+    void SetTextureCache(const std::string& directory);
+    void SetAnimationTolerance(float tolerance, float angleTolerance);
+    void SetAnimationLod(float distance, int interval, int budget);
+    void SetSkinningProgram(GLuint prog);  // shader_skinned.vert, before Setup()
+    void SetMorphProgram(GLuint prog);     // shader_morph.vert, before Setup()
+    void SetVertexAnimation(GLuint prog, int animation, float frameRate = 30.0f);  // shader_vat.vert, before Setup()
+    void SetTimeOffset(int node, float seconds);  // of the vertex animation of the items of node
+    void Setup(GLuint prog, unsigned int flags = 0);
+    void Animate(int animation, float time);  // before Cull(), time in seconds of the animation
+    void Cull(const float projection[16], const float view[16]);
+    void Publish(GLFramePacket& frame);  // after Cull(), on the same thread
+    void DrawPrimitive(int mesh, int primitive, int lod = 0);
     void DrawMesh(int index);
-    void DrawNode(int index);
-    void Draw();
+    void Draw();                             // Publish() and Draw() the packet, in one go
+    void Draw(const GLFramePacket& frame);   // on the thread with the GL context
     void Cleanup();
+
+    SceneGraph& Graph();
+    SceneAnimation& Animation();
+    const GLSceneStats& Stats() const;
 };
 
 #endif // GLSCENE_H
 
 #ifdef GLSCENE_IMPLEMENTATION
 
+#include <algorithm>
+
+#include "glmath.h"
+#include "imagemip.h"
+#include "ktx2.h"
+#include "meshoptimize.h"
+#include "meshquantize.h"
+#include "meshsimplify.h"
+#include "texcompress.h"
+
 std::string GetFilePathExtension(const std::string &FileName)
 {
     if (FileName.find_last_of(".") != std::string::npos)
@@ -64,200 +528,4098 @@ std::string GetFilePathExtension(const std::string &FileName)
     return "";
 }
 
-GLScene::GLScene() { }
+GLScene::GLScene() : GLScene(ThreadPool::Shared()) { }
+
+GLScene::GLScene(ThreadPool& workers) : _flags(0), _s3tc(false), _bptc(false), _samplerObjects(false), _uniformBuffers(false),
+    _textureBuffers(false), _animationTolerance(0.0001f), _animationAngleTolerance(0.001f), _instanceBuffer(0),
+    _modelAttrib(-1), _layerAttrib(-1), _layerBuffer(0), _program(0), _skinProgram(0), _paletteBlockSize(0), _paletteAlignment(1), _paletteSize(0),
+    _paletteBuffer(0), _morphProgram(0), _morphSlots(0), _morphDeltaBuffer(0), _morphTexture(0), _morphBuffer(0), _morphBufferSize(0),
+    _vatProgram(0), _vatAnimation(-1), _vatFrameRate(30.0f), _vatFrameCount(0), _vatFrame(0.0f), _vatOffsetAttrib(-1), _vatDirty(false),
+    _vatBuffer(0), _vatTexture(0), _vatInstanceBuffer(0), _animationLodDistance(20.0f), _animationLodInterval(2), _animationBudget(0),
+    _hasCamera(false), _lodAnimation(-1), _animationTime(0.0f), _animationStep(1.0f / 60.0f), _indexArena(0), _indirectBuffer(0),
+    _lodLevels(4), _lodReduction(0.5f), _lodThreshold(0.003f), _occlusionWidth(256), _occlusionHeight(128), _maxOccluders(16),
+    _workers(workers)
+{
+    memset(&_stats, 0, sizeof(_stats));
+    memset(_compressedTextures, 0, sizeof(_compressedTextures));
+    memset(_cameraPosition, 0, sizeof(_cameraPosition));
+    mat4_identity(_cullProjection);
+    mat4_identity(_cullView);
+    resetBindings();
+}
 
 GLScene::~GLScene() { }
 
-bool GLScene::Load(const std::string& filename)
+static bool GetPositionBounds(const tinygltf::Model& model, const tinygltf::Accessor& accessor, float bounds[6])
 {
-    std::string err;
-    std::string ext = GetFilePathExtension(filename);
-    bool ret = false;
-    if (ext.compare("glb") == 0) // assume binary glTF.
+    // min/max of normalized accessors are in integer units
+    if (!accessor.normalized && accessor.minValues.size() >= 3 && accessor.maxValues.size() >= 3)
     {
-        ret = tinygltf::TinyGLTF().LoadBinaryFromFile(&this->_model, &err, filename.c_str());
-    }
-    else // assume ascii glTF.
-    {
-        ret = tinygltf::TinyGLTF().LoadASCIIFromFile(&this->_model, &err, filename.c_str());
+        for (int k = 0; k < 3; k++)
+        {
+            bounds[k] = (float)accessor.minValues[k];
+            bounds[k + 3] = (float)accessor.maxValues[k];
+        }
+        return true;
     }
 
-    if (!err.empty()) std::cerr << "ERR: " << err << std::endl;
+    // min/max is required for POSITION, but older exporters leave it out
+    std::vector<float> positions;
+    if (accessor.type != TINYGLTF_TYPE_VEC3 || !accessor_read_floats(model, accessor, accessor.normalized, positions)) return false;
 
-    return ret;
+    aabb_empty(bounds);
+    for (size_t i = 0; i < accessor.count; i++)
+    {
+        float p[6] = { positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2], positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2] };
+        aabb_merge(bounds, p);
+    }
+    return accessor.count > 0;
 }
 
-void GLScene::Setup(GLuint prog)
+// Bounds of all EXT_mesh_gpu_instancing instances of a box, in the space of the node
+static int GetInstancedBounds(const tinygltf::Model& model, const tinygltf::Node& node, float bounds[6])
 {
-    glUseProgram(prog);
-
-    this->_attribs["POSITION"] = glGetAttribLocation(prog, "in_vertex");
-    this->_attribs["NORMAL"] = glGetAttribLocation(prog, "in_normal");
-    this->_attribs["TEXCOORD_0"] = glGetAttribLocation(prog, "in_texcoord");
-
-    for (size_t i = 0; i < this->_model.bufferViews.size(); i++)
+    std::vector<float> translations, rotations, scales;
+    int count = -1;
+    for (auto it : node.instanceAttributes)
     {
-        auto bufferView = this->_model.bufferViews[i];
-        if (bufferView.target == 0)
-        {
-            std::cout << "WARN: bufferView.target is zero" << std::endl;
-            continue;  // Unsupported bufferView.
-        }
+        if (it.second < 0 || it.second >= (int)model.accessors.size()) return 0;
 
-        auto buffer = this->_model.buffers[bufferView.buffer];
-        GLBufferState state;
+        auto& accessor = model.accessors[it.second];
+        std::vector<float> *out = NULL;
+        if (it.first == "TRANSLATION" && accessor.type == TINYGLTF_TYPE_VEC3) out = &translations;
+        else if (it.first == "ROTATION" && accessor.type == TINYGLTF_TYPE_VEC4) out = &rotations;
+        else if (it.first == "SCALE" && accessor.type == TINYGLTF_TYPE_VEC3) out = &scales;
+        else continue;
 
-        glGenBuffers(1, &state.vb);
-        glBindBuffer(bufferView.target, state.vb);
-        glBufferData(bufferView.target, bufferView.byteLength, &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
-        glBindBuffer(bufferView.target, 0);
+        // Integer rotations are always normalized in this extension
+        if (!accessor_read_floats(model, accessor, true, *out)) return 0;
+        if (count < 0 || (int)accessor.count < count) count = (int)accessor.count;
+    }
+    if (count <= 0) return 0;
+
+    float local[6];
+    memcpy(local, bounds, sizeof(local));
+    aabb_empty(bounds);
+    for (int i = 0; i < count; i++)
+    {
+        float t[3] = { 0.0f, 0.0f, 0.0f }, q[4] = { 0.0f, 0.0f, 0.0f, 1.0f }, s[3] = { 1.0f, 1.0f, 1.0f };
+        if (!translations.empty()) memcpy(t, &translations[i * 3], sizeof(t));
+        if (!rotations.empty()) memcpy(q, &rotations[i * 4], sizeof(q));
+        if (!scales.empty()) memcpy(s, &scales[i * 3], sizeof(s));
 
-        this->_buffers[i] = state;
+        float m[16], b[6];
+        mat4_from_trs(m, t, q, s);
+        aabb_transform(b, local, m);
+        aabb_merge(bounds, b);
     }
+    return count;
+}
+
+void GLScene::buildDrawItems()
+{
+    this->_drawItems.clear();
+    this->_itemSlots.clear();
 
-    // Texture
+    for (auto index : this->_graph.Order())
     {
-        for (auto mesh : this->_model.meshes) {
-            for (auto primitive : mesh.primitives) {
-                if (primitive.material < 0) {
-                    continue;
-                }
-                auto mat = this->_model.materials[primitive.material];
-                auto baseColorTexture = mat.values["baseColorTexture"];
-                auto imageIndex = baseColorTexture.json_double_value["index"];
-                auto image = this->_model.images[imageIndex];
+        auto& node = this->_model.nodes[index];
+        if (node.mesh < 0) continue;
+
+        auto& mesh = this->_model.meshes[node.mesh];
+        for (size_t i = 0; i < mesh.primitives.size(); i++)
+        {
+            auto& primitive = mesh.primitives[i];
+            if (primitive.indices < 0) continue;
 
-                GLuint texId;
-                glGenTextures(1, &texId);
-                _meshStates[mesh.name].diffuseTex[primitive.material] = texId;
-                glBindTexture(GL_TEXTURE_2D, texId);
-                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-                glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            auto position = primitive.attributes.find("POSITION");
+            if (position == primitive.attributes.end() || position->second < 0) continue;
 
-                // Ignore Texture.fomat.
-                GLenum format = GL_RGBA;
-                if (image.component == 3) format = GL_RGB;
-                glTexImage2D(GL_TEXTURE_2D, 0, format, image.width,
-                             image.height, 0, format, GL_UNSIGNED_BYTE,
-                             &image.image.at(0));
+            GLDrawItem item;
+            item.node = index;
+            item.mesh = node.mesh;
+            item.primitive = (int)i;
+            item.instanceCount = 0;
+            item.skin = -1;
+            item.morph = -1;
+            item.vat = -1;
+            if (!GetPositionBounds(this->_model, this->_model.accessors[position->second], item.localBounds)) continue;
 
-                glBindTexture(GL_TEXTURE_2D, 0);
+            if (!node.instanceAttributes.empty())
+            {
+                item.instanceCount = GetInstancedBounds(this->_model, node, item.localBounds);
+                if (item.instanceCount == 0) continue;
+            }
+            else if (node.skin >= 0 && node.skin < (int)this->_skins.size() &&
+                     primitive.attributes.count("JOINTS_0") != 0 && primitive.attributes.count("WEIGHTS_0") != 0)
+            {
+                item.skin = node.skin;
             }
+
+            this->_drawItems.push_back(item);
         }
     }
+
+    this->_worldBounds.resize(this->_drawItems.size() * 6);
 }
 
-void GLScene::DrawMesh(int index)
+typedef struct {
+    std::map<std::string, int> attributes;
+    int indices;
+    int material;
+    int mode;
+} GLPrimitiveKey;
+
+static bool operator < (const GLPrimitiveKey& a, const GLPrimitiveKey& b)
+{
+    if (a.indices != b.indices) return a.indices < b.indices;
+    if (a.material != b.material) return a.material < b.material;
+    if (a.mode != b.mode) return a.mode < b.mode;
+    return a.attributes < b.attributes;
+}
+
+void GLScene::buildBatches()
 {
-    auto mesh = this->_model.meshes[index];
-    for (auto primitive : mesh.primitives)
+    // Exporters often write one mesh per node even when the geometry is the same,
+    // so batches are keyed on the accessors rather than on the mesh index.
+    std::map<GLPrimitiveKey, int> batchIndices;
+    std::vector<std::vector<int> > batchItems;
+
+    this->_batches.clear();
+    this->_itemSlots.assign(this->_drawItems.size(), -1);
+    for (auto index : this->_bvh.Items())
     {
-        if (primitive.indices < 0) return;
+        auto& item = this->_drawItems[index];
+        if (item.instanceCount > 0) continue;  // carries its own instance data
+        if (item.skin >= 0) continue;           // and its own joint palette
+        if (item.morph >= 0) continue;          // or its own weights
 
-        if (primitive.material >= 0)
+        auto& primitive = this->_model.meshes[item.mesh].primitives[item.primitive];
+
+        GLPrimitiveKey key;
+        key.attributes = primitive.attributes;
+        key.indices = primitive.indices;
+        key.material = primitive.material;
+        key.mode = primitive.mode;
+
+        auto found = batchIndices.find(key);
+        if (found == batchIndices.end())
+        {
+            GLBatch batch;
+            batch.mesh = item.mesh;
+            batch.primitive = item.primitive;
+            batch.firstSlot = 0;
+            batch.count = 0;
+            found = batchIndices.insert(std::make_pair(key, (int)this->_batches.size())).first;
+            this->_batches.push_back(batch);
+            batchItems.push_back(std::vector<int>());
+        }
+        batchItems[found->second].push_back(index);
+    }
+
+    // Items are added in BVH order, so neighbours in a batch are close in space
+    // and the visible slots of a batch mostly form a few long runs
+    int slot = 0;
+    this->_slotBatches.resize(this->_drawItems.size());
+    for (size_t b = 0; b < this->_batches.size(); b++)
+    {
+        this->_batches[b].firstSlot = slot;
+        this->_batches[b].count = (int)batchItems[b].size();
+        for (auto index : batchItems[b])
         {
-            glBindTexture(GL_TEXTURE_2D, this->_meshStates[mesh.name].diffuseTex[primitive.material]);
+            this->_itemSlots[index] = slot;
+            this->_slotBatches[slot] = (int)b;
+            slot++;
         }
+    }
 
-        for (auto it : primitive.attributes)
+    this->_slotBatches.resize(slot);
+    this->_instanceMatrices.resize(slot * 16);
+}
+
+void GLScene::buildArenas()
+{
+    static const char *names[] = { "POSITION", "NORMAL", "TEXCOORD_0", "JOINTS_0", "WEIGHTS_0" };
+
+    // Primitives referencing the same accessors are stored once
+    std::map<std::pair<std::map<std::string, int>, int>, GLArenaRange> shared;
+    std::map<std::string, int> arenaIndices;
+    std::vector<std::vector<std::vector<unsigned char> > > streamData;  // per arena, per stream
+    std::vector<unsigned int> indices, primitiveIndices;
+
+    for (size_t m = 0; m < this->_model.meshes.size(); m++)
+    {
+        auto& mesh = this->_model.meshes[m];
+        for (size_t p = 0; p < mesh.primitives.size(); p++)
         {
-            if (it.second < 0) continue;
+            auto& primitive = mesh.primitives[p];
+            auto position = primitive.attributes.find("POSITION");
+            if (primitive.indices < 0 || position == primitive.attributes.end() || position->second < 0) continue;
+
+            // Morphed vertices are addressed by their index in the primitive, a base vertex
+            // would shift them, so these primitives are drawn from their bufferViews
+            if (!primitive.targets.empty()) continue;
+
+            auto key = std::make_pair(primitive.attributes, primitive.indices);
+            auto found = shared.find(key);
+            if (found != shared.end())
+            {
+                this->_arenaRanges[std::make_pair((int)m, (int)p)] = found->second;
+                continue;
+            }
+
+            auto vertexCount = this->_model.accessors[position->second].count;
+            GLArena format;
+            std::vector<int> accessors;
+            std::stringstream formatKey;
+            bool valid = true;
+            for (auto name : names)
+            {
+                auto it = primitive.attributes.find(name);
+                if (it == primitive.attributes.end() || it->second < 0) continue;
+
+                auto& accessor = this->_model.accessors[it->second];
+                if (accessor.count != vertexCount || accessor_data(this->_model, accessor) == NULL)
+                {
+                    valid = false;
+                    break;
+                }
+
+                GLArenaStream stream;
+                stream.name = name;
+                stream.componentType = accessor.componentType;
+                stream.components = accessor_component_count(accessor.type);
+                stream.normalized = accessor.normalized ? GL_TRUE : GL_FALSE;
+                stream.offset = 0;
+                format.streams.push_back(stream);
+                accessors.push_back(it->second);
+                formatKey << name << ":" << stream.componentType << ":" << stream.components << ":" << (int)stream.normalized << ";";
+            }
+
+            if (!valid || !accessor_read_indices(this->_model, this->_model.accessors[primitive.indices], primitiveIndices))
+            {
+                std::cout << "WARN: primitive " << p << " of mesh " << m << " can not be merged, it is drawn from its bufferViews" << std::endl;
+                continue;
+            }
 
-            auto accessor = this->_model.accessors[it.second];
-            glBindBuffer(GL_ARRAY_BUFFER, this->_buffers[accessor.bufferView].vb);
+            auto arenaIndex = arenaIndices.find(formatKey.str());
+            if (arenaIndex == arenaIndices.end())
+            {
+                format.vertexCount = 0;
+                format.stride = 0;
+                format.vb = 0;
+                arenaIndex = arenaIndices.insert(std::make_pair(formatKey.str(), (int)this->_arenas.size())).first;
+                this->_arenas.push_back(format);
+                streamData.push_back(std::vector<std::vector<unsigned char> >(format.streams.size()));
+            }
 
-            int count = 1;
-            if (accessor.type == TINYGLTF_TYPE_SCALAR) count = 1;
-            else if (accessor.type == TINYGLTF_TYPE_VEC2) count = 2;
-            else if (accessor.type == TINYGLTF_TYPE_VEC3) count = 3;
-            else if (accessor.type == TINYGLTF_TYPE_VEC4) count = 4;
-            else assert(0);
+            auto& arena = this->_arenas[arenaIndex->second];
+            GLArenaRange range;
+            range.arena = arenaIndex->second;
+            range.firstIndex = (GLuint)indices.size();
+            range.baseVertex = (GLint)arena.vertexCount;
+            range.count = (GLsizei)primitiveIndices.size();
+
+            for (size_t k = 0; k < arena.streams.size(); k++)
+            {
+                auto& bytes = streamData[range.arena][k];
+                auto at = bytes.size();
+                bytes.resize(at + arena.streams[k].components * accessor_component_size(arena.streams[k].componentType) * vertexCount);
+                accessor_copy_elements(this->_model, this->_model.accessors[accessors[k]], &bytes[at]);
+            }
+            arena.vertexCount += vertexCount;
+            indices.insert(indices.end(), primitiveIndices.begin(), primitiveIndices.end());
 
-            if ((it.first.compare("POSITION") == 0) || (it.first.compare("NORMAL") == 0) || (it.first.compare("TEXCOORD_0") == 0))
+            // Levels of detail share the vertices, so only their indices are added
+            auto chain = this->_primitiveLods.find(std::make_pair((int)m, (int)p));
+            if (chain != this->_primitiveLods.end())
             {
-                auto attr = this->_attribs[it.first];
-                if (attr >= 0)
+                for (auto& lod : this->_lodChains[chain->second])
                 {
-                    glVertexAttribPointer(attr, count, accessor.componentType, GL_FALSE, 0, BUFFER_OFFSET(accessor.byteOffset));
-                    glEnableVertexAttribArray(attr);
+                    lod.firstIndex = (GLuint)indices.size();
+                    indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+                    std::vector<unsigned int>().swap(lod.indices);
                 }
             }
+
+            shared[key] = range;
+            this->_arenaRanges[std::make_pair((int)m, (int)p)] = range;
         }
+    }
 
-        auto indexAccessor = this->_model.accessors[primitive.indices];
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->_buffers[indexAccessor.bufferView].vb);
+    for (size_t a = 0; a < this->_arenas.size(); a++) packArena((int)a, streamData[a]);
 
-        int mode = -1;
-        if (primitive.mode == TINYGLTF_MODE_TRIANGLES) mode = GL_TRIANGLES;
-        else if (primitive.mode == TINYGLTF_MODE_TRIANGLE_STRIP) mode = GL_TRIANGLE_STRIP;
-        else if (primitive.mode == TINYGLTF_MODE_TRIANGLE_FAN) mode = GL_TRIANGLE_FAN;
-        else if (primitive.mode == TINYGLTF_MODE_POINTS) mode = GL_POINTS;
-        else if (primitive.mode == TINYGLTF_MODE_LINE) mode = GL_LINES;
-        else if (primitive.mode == TINYGLTF_MODE_LINE_LOOP)  mode = GL_LINE_LOOP;
+    glGenBuffers(1, &this->_indexArena);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->_indexArena);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
 
-        glDrawElements(mode, indexAccessor.count, indexAccessor.componentType, BUFFER_OFFSET(indexAccessor.byteOffset));
+void GLScene::buildInterleaved()
+{
+    static const char *names[] = { "POSITION", "NORMAL", "TEXCOORD_0", "JOINTS_0", "WEIGHTS_0" };
 
-        for (auto it : primitive.attributes)
+    // Primitives referencing the same attribute accessors share one arena, -1
+    // when the attributes are used as they are
+    std::map<std::map<std::string, int>, int> shared;
+    for (size_t m = 0; m < this->_model.meshes.size(); m++)
+    {
+        auto& mesh = this->_model.meshes[m];
+        for (size_t p = 0; p < mesh.primitives.size(); p++)
         {
-            if ((it.first.compare("POSITION") == 0) || (it.first.compare("NORMAL") == 0) || (it.first.compare("TEXCOORD_0") == 0))
+            auto& primitive = mesh.primitives[p];
+            auto position = primitive.attributes.find("POSITION");
+            if (primitive.indices < 0 || position == primitive.attributes.end() || position->second < 0) continue;
+
+            GLArenaRange range;
+            range.firstIndex = 0;
+            range.baseVertex = 0;
+            range.count = (GLsizei)this->_model.accessors[primitive.indices].count;
+
+            auto found = shared.find(primitive.attributes);
+            if (found != shared.end())
+            {
+                range.arena = found->second;
+                if (range.arena >= 0) this->_arenaRanges[std::make_pair((int)m, (int)p)] = range;
+                continue;
+            }
+            shared[primitive.attributes] = -1;
+
+            auto vertexCount = this->_model.accessors[position->second].count;
+            GLArena arena;
+            std::vector<int> accessors;
+            std::set<int> views;
+            bool valid = true, strided = true;
+            for (auto name : names)
+            {
+                auto it = primitive.attributes.find(name);
+                if (it == primitive.attributes.end() || it->second < 0) continue;
+
+                auto& accessor = this->_model.accessors[it->second];
+                if (accessor.count != vertexCount || accessor_data(this->_model, accessor) == NULL)
+                {
+                    valid = false;
+                    break;
+                }
+
+                GLArenaStream stream;
+                stream.name = name;
+                stream.componentType = accessor.componentType;
+                stream.components = accessor_component_count(accessor.type);
+                stream.normalized = accessor.normalized ? GL_TRUE : GL_FALSE;
+                stream.offset = 0;
+                arena.streams.push_back(stream);
+                accessors.push_back(it->second);
+                views.insert(accessor.bufferView);
+                strided = strided && this->_model.bufferViews[accessor.bufferView].byteStride > 0;
+            }
+
+            // Data that comes interleaved already is drawn from its bufferView
+            if (!valid || (accessors.size() > 1 && views.size() == 1 && strided)) continue;
+
+            std::vector<std::vector<unsigned char> > streamData(accessors.size());
+            for (size_t k = 0; k < accessors.size(); k++)
             {
-                auto attr = this->_attribs[it.first];
-                if (attr >= 0) glDisableVertexAttribArray(attr);
+                auto& accessor = this->_model.accessors[accessors[k]];
+                streamData[k].resize(accessor.count * accessor_component_count(accessor.type) * accessor_component_size(accessor.componentType));
+                accessor_copy_elements(this->_model, accessor, streamData[k].data());
             }
+
+            arena.vertexCount = vertexCount;
+            arena.stride = 0;
+            arena.vb = 0;
+            range.arena = (int)this->_arenas.size();
+            this->_arenas.push_back(arena);
+            packArena(range.arena, streamData);
+
+            shared[primitive.attributes] = range.arena;
+            this->_arenaRanges[std::make_pair((int)m, (int)p)] = range;
         }
     }
 }
 
-void GLScene::DrawNode(int index)
+void GLScene::packArena(int arena, const std::vector<std::vector<unsigned char> >& streams)
 {
-    auto node = this->_model.nodes[index];
-    glPushMatrix();
-    if (node.matrix.size() == 16)
+    auto& a = this->_arenas[arena];
+    std::vector<unsigned char> bytes;
+    if (this->_flags & GLSCENE_INTERLEAVED_BUFFERS)
     {
-        // Use `matrix' attribute
-        glMultMatrixd(node.matrix.data());
+        // Every attribute starts 4 byte aligned inside the vertex
+        std::vector<size_t> sizes(a.streams.size());
+        a.stride = 0;
+        for (size_t k = 0; k < a.streams.size(); k++)
+        {
+            sizes[k] = a.streams[k].components * accessor_component_size(a.streams[k].componentType);
+            a.streams[k].offset = a.stride;
+            a.stride += (GLsizei)((sizes[k] + 3) & ~(size_t)3);
+        }
+
+        bytes.assign(a.stride * a.vertexCount, 0);
+        for (size_t v = 0; v < a.vertexCount; v++)
+        {
+            for (size_t k = 0; k < a.streams.size(); k++) memcpy(&bytes[v * a.stride + a.streams[k].offset], &streams[k][v * sizes[k]], sizes[k]);
+        }
     }
     else
     {
-        if (node.translation.size() == 3)
+        for (size_t k = 0; k < a.streams.size(); k++)
+        {
+            bytes.resize((bytes.size() + 3) & ~(size_t)3);  // keep every stream 4 byte aligned
+            a.streams[k].offset = bytes.size();
+            bytes.insert(bytes.end(), streams[k].begin(), streams[k].end());
+        }
+    }
+
+    glGenBuffers(1, &a.vb);
+    glBindBuffer(GL_ARRAY_BUFFER, a.vb);
+    glBufferData(GL_ARRAY_BUFFER, bytes.size(), bytes.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GLScene::buildBuckets()
+{
+    this->_buckets.clear();
+    this->_batchBuckets.assign(this->_batches.size(), -1);
+    this->_batchCommands.resize(this->_batches.size());
+
+    for (size_t b = 0; b < this->_batches.size(); b++)
+    {
+        auto& batch = this->_batches[b];
+        auto found = this->_arenaRanges.find(std::make_pair(batch.mesh, batch.primitive));
+        if (found == this->_arenaRanges.end()) continue;
+
+        auto& range = found->second;
+        auto& primitive = this->_model.meshes[batch.mesh].primitives[batch.primitive];
+
+        GLDrawCommand command;
+        command.count = (GLuint)range.count;
+        command.instanceCount = 0;
+        command.firstIndex = range.firstIndex;
+        command.baseVertex = range.baseVertex;
+        command.baseInstance = 0;
+        this->_batchCommands[b] = command;
+
+        GLDrawBucket bucket = { range.arena, 0, 0, false, primitive.mode };
+        if (primitive.material >= 0)
         {
-            glTranslated(node.translation[0], node.translation[1], node.translation[2]);
+            auto& state = this->_meshStates[this->_model.meshes[batch.mesh].name];
+            auto layer = state.diffuseLayer.find(primitive.material);
+            bucket.texture = state.diffuseTex[primitive.material];
+            bucket.sampler = state.diffuseSampler[primitive.material];
+            bucket.array = layer != state.diffuseLayer.end() && layer->second >= 0;
         }
 
-        if (node.rotation.size() == 4)
+        for (size_t k = 0; k < this->_buckets.size() && this->_batchBuckets[b] < 0; k++)
         {
-            glRotated(node.rotation[0], node.rotation[1], node.rotation[2], node.rotation[3]);
+            auto& other = this->_buckets[k];
+            if (other.arena == bucket.arena && other.texture == bucket.texture && other.sampler == bucket.sampler && other.array == bucket.array &&
+                other.mode == bucket.mode) this->_batchBuckets[b] = (int)k;
         }
 
-        if (node.scale.size() == 3)
+        if (this->_batchBuckets[b] < 0)
         {
-            glScaled(node.scale[0], node.scale[1], node.scale[2]);
+            this->_batchBuckets[b] = (int)this->_buckets.size();
+            this->_buckets.push_back(bucket);
         }
     }
 
-    if (node.mesh >= 0) DrawMesh(node.mesh);
+    // A bucket can hold several layers, so the layer is read per instance like in_model
+    if ((this->_flags & GLSCENE_TEXTURE_ARRAYS) && this->_instanceBuffer != 0)
+    {
+        std::vector<float> layers(this->_slotBatches.size(), -1.0f);
+        for (size_t slot = 0; slot < layers.size(); slot++)
+        {
+            auto& batch = this->_batches[this->_slotBatches[slot]];
+            auto material = this->_model.meshes[batch.mesh].primitives[batch.primitive].material;
+            if (material < 0) continue;
 
-    // Draw child nodes.
-    for (auto child : node.children) DrawNode(child);
+            auto& state = this->_meshStates[this->_model.meshes[batch.mesh].name];
+            auto layer = state.diffuseLayer.find(material);
+            if (layer != state.diffuseLayer.end()) layers[slot] = (float)layer->second;
+        }
 
-    glPopMatrix();
+        glGenBuffers(1, &this->_layerBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, this->_layerBuffer);
+        glBufferData(GL_ARRAY_BUFFER, layers.size() * sizeof(float), layers.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
 }
 
-void GLScene::Draw()
+void GLScene::buildLods()
 {
-    if (this->_model.defaultScene < 0) return;
+    // Primitives referencing the same accessors share one chain
+    std::map<std::pair<std::map<std::string, int>, int>, int> shared;
+    std::vector<float> positions, normals, texcoords, attributes;
+    std::vector<unsigned int> indices, simplified;
+
+    for (size_t m = 0; m < this->_model.meshes.size(); m++)
+    {
+        auto& mesh = this->_model.meshes[m];
+        for (size_t p = 0; p < mesh.primitives.size(); p++)
+        {
+            auto& primitive = mesh.primitives[p];
+            auto position = primitive.attributes.find("POSITION");
+            if (primitive.mode != TINYGLTF_MODE_TRIANGLES || primitive.indices < 0 || position == primitive.attributes.end() || position->second < 0) continue;
+
+            // Simplification errors would only hold for the shape without targets
+            if (!primitive.targets.empty()) continue;
+
+            auto key = std::make_pair(primitive.attributes, primitive.indices);
+            auto found = shared.find(key);
+            if (found != shared.end())
+            {
+                if (found->second >= 0) this->_primitiveLods[std::make_pair((int)m, (int)p)] = found->second;
+                continue;
+            }
+            shared[key] = -1;
+
+            auto& positionAccessor = this->_model.accessors[position->second];
+            if (positionAccessor.type != TINYGLTF_TYPE_VEC3 || !accessor_read_floats(this->_model, positionAccessor, positionAccessor.normalized, positions)) continue;
+            if (!accessor_read_indices(this->_model, this->_model.accessors[primitive.indices], indices)) continue;
+
+            auto vertexCount = positionAccessor.count;
+            normals.assign(vertexCount * 3, 0.0f);
+            texcoords.assign(vertexCount * 2, 0.0f);
+            auto normal = primitive.attributes.find("NORMAL");
+            if (normal != primitive.attributes.end() && normal->second >= 0 && this->_model.accessors[normal->second].count == vertexCount)
+            {
+                auto& accessor = this->_model.accessors[normal->second];
+                if (!accessor_read_floats(this->_model, accessor, accessor.normalized, normals)) normals.assign(vertexCount * 3, 0.0f);
+            }
+            auto texcoord = primitive.attributes.find("TEXCOORD_0");
+            if (texcoord != primitive.attributes.end() && texcoord->second >= 0 && this->_model.accessors[texcoord->second].count == vertexCount)
+            {
+                auto& accessor = this->_model.accessors[texcoord->second];
+                if (!accessor_read_floats(this->_model, accessor, accessor.normalized, texcoords)) texcoords.assign(vertexCount * 2, 0.0f);
+            }
+
+            attributes.resize(vertexCount * 5);
+            for (size_t v = 0; v < vertexCount; v++)
+            {
+                memcpy(&attributes[v * 5], &normals[v * 3], sizeof(float) * 3);
+                memcpy(&attributes[v * 5 + 3], &texcoords[v * 2], sizeof(float) * 2);
+            }
+
+            // Every level is simplified from the one before it
+            std::vector<GLLod> chain;
+            float error = 0.0f;
+            for (int level = 1; level <= this->_lodLevels; level++)
+            {
+                auto& source = chain.empty() ? indices : chain.back().indices;
+                auto target = (size_t)(indices.size() * powf(this->_lodReduction, (float)level)) / 3 * 3;
+                simplified.resize(source.size());
+
+                float levelError = 0.0f;
+                auto count = mesh_simplify(simplified.data(), source.data(), source.size(), positions.data(), vertexCount,
+                                           attributes.data(), 5, 0.1f, target, 1.0f, &levelError);
+
+                // Stop when the mesh does not get meaningfully smaller anymore
+                if (count == 0 || count > source.size() * 9 / 10) break;
 
-    auto scene = this->_model.scenes[this->_model.defaultScene];
-    for (auto node : scene.nodes)
+                GLLod lod;
+                lod.indices.resize(count);
+                if (this->_flags & GLSCENE_OPTIMIZE_MESHES)
+                    mesh_optimize_vertex_cache(lod.indices.data(), simplified.data(), count, vertexCount);
+                else
+                    lod.indices.assign(simplified.begin(), simplified.begin() + count);
+                lod.count = (GLsizei)count;
+                error = std::max(error, levelError);
+                lod.error = error;
+                lod.ib = 0;
+                lod.firstIndex = 0;
+                chain.push_back(lod);
+            }
+            if (chain.empty()) continue;
+
+            shared[key] = (int)this->_lodChains.size();
+            this->_primitiveLods[std::make_pair((int)m, (int)p)] = (int)this->_lodChains.size();
+            this->_lodChains.push_back(chain);
+        }
+    }
+
+    // Merged buffers append the levels to the index arena instead
+    if (!(this->_flags & GLSCENE_MERGED_BUFFERS))
+    {
+        for (auto& chain : this->_lodChains)
+        {
+            for (auto& lod : chain)
+            {
+                glGenBuffers(1, &lod.ib);
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lod.ib);
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, lod.indices.size() * sizeof(unsigned int), lod.indices.data(), GL_STATIC_DRAW);
+                std::vector<unsigned int>().swap(lod.indices);
+            }
+        }
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+
+    this->_itemLodChains.assign(this->_drawItems.size(), -1);
+    for (size_t i = 0; i < this->_drawItems.size(); i++)
     {
-        DrawNode(node);
+        // EXT_mesh_gpu_instancing bounds cover all instances, they say nothing about the size of one.
+        // Simplification errors of skinned primitives hold for the bind pose only.
+        auto& item = this->_drawItems[i];
+        auto found = this->_primitiveLods.find(std::make_pair(item.mesh, item.primitive));
+        if (item.instanceCount == 0 && item.skin < 0 && found != this->_primitiveLods.end()) this->_itemLodChains[i] = found->second;
+    }
+
+    this->_batchLodChains.assign(this->_batches.size(), -1);
+    for (size_t b = 0; b < this->_batches.size(); b++)
+    {
+        auto found = this->_primitiveLods.find(std::make_pair(this->_batches[b].mesh, this->_batches[b].primitive));
+        if (found != this->_primitiveLods.end()) this->_batchLodChains[b] = found->second;
     }
 }
 
-void GLScene::Cleanup()
+void GLScene::optimizeMeshes()
 {
+    typedef struct {
+        int mesh;
+        int primitive;
+        bool vertices;  // false when the vertex data is shared with other index lists
+        size_t triangles;
+        float acmr[2];  // before, after
+        float atvr[2];
+    } Job;
+
+    // Primitives referencing the same accessors are one job, accessors used by
+    // more than one job can not be reordered for either of them
+    std::map<std::pair<std::map<std::string, int>, int>, int> shared;
+    std::map<int, std::set<int> > vertexUsers, indexUsers;
+    std::vector<Job> jobs;
+    for (size_t m = 0; m < this->_model.meshes.size(); m++)
+    {
+        auto& mesh = this->_model.meshes[m];
+        for (size_t p = 0; p < mesh.primitives.size(); p++)
+        {
+            auto& primitive = mesh.primitives[p];
+            auto position = primitive.attributes.find("POSITION");
+            if (primitive.mode != TINYGLTF_MODE_TRIANGLES || primitive.indices < 0 || position == primitive.attributes.end() || position->second < 0) continue;
+
+            auto key = std::make_pair(primitive.attributes, primitive.indices);
+            if (shared.find(key) != shared.end()) continue;
+
+            auto job = (int)jobs.size();
+            shared[key] = job;
+            for (auto& it : primitive.attributes) vertexUsers[it.second].insert(job);
+            for (auto& target : primitive.targets)
+            {
+                for (auto& it : target) vertexUsers[it.second].insert(job);
+            }
+            indexUsers[primitive.indices].insert(job);
+
+            Job j;
+            memset(&j, 0, sizeof(j));
+            j.mesh = (int)m;
+            j.primitive = (int)p;
+            jobs.push_back(j);
+        }
+    }
+
+    for (auto& node : this->_model.nodes)
+    {
+        for (auto& it : node.instanceAttributes) vertexUsers[it.second].insert(-1);
+    }
+
+    for (size_t j = 0; j < jobs.size(); j++)
+    {
+        auto& primitive = this->_model.meshes[jobs[j].mesh].primitives[jobs[j].primitive];
+        auto vertexCount = this->_model.accessors[primitive.attributes.find("POSITION")->second].count;
 
+        jobs[j].vertices = indexUsers[primitive.indices].size() == 1 && vertexUsers.find(primitive.indices) == vertexUsers.end();
+        auto check = [&] (int accessor)
+        {
+            if (vertexUsers[accessor].size() != 1 || indexUsers.find(accessor) != indexUsers.end() ||
+                this->_model.accessors[accessor].count != vertexCount) jobs[j].vertices = false;
+        };
+        for (auto& it : primitive.attributes) check(it.second);
+        for (auto& target : primitive.targets)
+        {
+            for (auto& it : target) check(it.second);
+        }
+    }
+
+    this->_workers.ParallelFor((int)jobs.size(), [this, &jobs, &indexUsers] (int j)
+    {
+        auto& job = jobs[j];
+        auto& primitive = this->_model.meshes[job.mesh].primitives[job.primitive];
+        auto& indexAccessor = this->_model.accessors[primitive.indices];
+        auto& positionAccessor = this->_model.accessors[primitive.attributes.find("POSITION")->second];
+        auto vertexCount = positionAccessor.count;
+
+        // An index list shared by primitives with other vertices is left alone
+        if (indexUsers.at(primitive.indices).size() != 1) return;
+
+        std::vector<unsigned int> indices, optimized;
+        if (!accessor_read_indices(this->_model, indexAccessor, indices)) return;
+        for (auto index : indices)
+        {
+            if (index >= vertexCount) return;
+        }
+        indices.resize(indices.size() / 3 * 3);
+
+        job.triangles = indices.size() / 3;
+        mesh_analyze_vertex_cache(indices.data(), indices.size(), vertexCount, &job.acmr[0], &job.atvr[0]);
+
+        optimized.resize(indices.size());
+        mesh_optimize_vertex_cache(optimized.data(), indices.data(), indices.size(), vertexCount);
+
+        std::vector<float> positions;
+        if ((this->_flags & GLSCENE_OPTIMIZE_OVERDRAW) && positionAccessor.type == TINYGLTF_TYPE_VEC3 &&
+            accessor_read_floats(this->_model, positionAccessor, positionAccessor.normalized, positions))
+        {
+            mesh_optimize_overdraw(indices.data(), optimized.data(), optimized.size(), positions.data(), vertexCount);
+            optimized.swap(indices);
+        }
+
+        if (job.vertices)
+        {
+            std::vector<unsigned int> remap(vertexCount);
+            mesh_optimize_vertex_fetch(remap.data(), optimized.data(), optimized.size(), vertexCount);
+            for (auto& it : primitive.attributes) accessor_permute_elements(this->_model, this->_model.accessors[it.second], remap.data());
+            for (auto& target : primitive.targets)
+            {
+                for (auto& it : target) accessor_permute_elements(this->_model, this->_model.accessors[it.second], remap.data());
+            }
+        }
+
+        mesh_analyze_vertex_cache(optimized.data(), optimized.size(), vertexCount, &job.acmr[1], &job.atvr[1]);
+
+        // Dropped trailing indices of a malformed list stay where they were
+        optimized.resize(indexAccessor.count, optimized.empty() ? 0 : optimized.back());
+        accessor_write_indices(this->_model, indexAccessor, optimized.data());
+    });
+
+    size_t triangles = 0;
+    double acmr[2] = { 0.0, 0.0 }, atvr[2] = { 0.0, 0.0 };
+    for (auto& job : jobs)
+    {
+        triangles += job.triangles;
+        for (int k = 0; k < 2; k++)
+        {
+            acmr[k] += job.acmr[k] * job.triangles;
+            atvr[k] += job.atvr[k] * job.triangles;
+        }
+    }
+    if (triangles == 0) return;
+
+    std::cout << "Optimized " << jobs.size() << " primitives on " << this->_workers.ThreadCount() << " threads, ACMR "
+              << acmr[0] / triangles << " -> " << acmr[1] / triangles << ", ATVR "
+              << atvr[0] / triangles << " -> " << atvr[1] / triangles << std::endl;
 }
 
+void GLScene::quantizeMeshes()
+{
+    static const char *names[] = { "POSITION", "NORMAL", "TEXCOORD_0" };
+
+    // An accessor is only re-encoded when it is used for one attribute and nothing else
+    std::map<int, std::set<std::string> > uses;
+    std::map<int, std::set<int> > positionMeshes;
+    std::set<int> fixedMeshes;  // positions can not move into a node transform
+    for (size_t m = 0; m < this->_model.meshes.size(); m++)
+    {
+        for (auto& primitive : this->_model.meshes[m].primitives)
+        {
+            for (auto& it : primitive.attributes) uses[it.second].insert(it.first);
+            if (primitive.indices >= 0) uses[primitive.indices].insert("indices");
+            for (auto& target : primitive.targets)
+            {
+                for (auto& it : target) uses[it.second].insert("target");
+            }
+
+            // Morph target position offsets would need the same scale
+            if (!primitive.targets.empty()) fixedMeshes.insert((int)m);
+
+            auto position = primitive.attributes.find("POSITION");
+            if (position != primitive.attributes.end()) positionMeshes[position->second].insert((int)m);
+        }
+    }
+    for (auto& node : this->_model.nodes)
+    {
+        for (auto& it : node.instanceAttributes) uses[it.second].insert("instance");
+
+        // Instance transforms apply before the node transform, skins ignore it
+        if (node.mesh >= 0 && (!node.instanceAttributes.empty() || node.skin >= 0)) fixedMeshes.insert(node.mesh);
+    }
+
+    auto quantizable = [this, &uses] (int index, const char *name, int type)
+    {
+        if (index < 0 || index >= (int)this->_model.accessors.size()) return false;
+
+        auto& accessor = this->_model.accessors[index];
+        return uses[index].size() == 1 && *uses[index].begin() == name && accessor.type == type &&
+               accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && accessor_data(this->_model, accessor) != NULL;
+    };
+
+    // One dequantization transform per mesh, it has to fit all its primitives
+    std::map<int, std::vector<float> > meshBounds;
+    for (auto& it : positionMeshes)
+    {
+        auto m = *it.second.begin();
+        if (it.second.size() != 1 || !quantizable(it.first, "POSITION", TINYGLTF_TYPE_VEC3)) fixedMeshes.insert(m);
+        if (fixedMeshes.count(m) != 0) continue;
+
+        std::vector<float> positions;
+        accessor_read_floats(this->_model, this->_model.accessors[it.first], false, positions);
+        auto& bounds = meshBounds[m];
+        if (bounds.empty())
+        {
+            bounds.resize(6);
+            aabb_empty(bounds.data());
+        }
+        for (size_t i = 0; i < positions.size(); i += 3)
+        {
+            float p[6] = { positions[i], positions[i + 1], positions[i + 2], positions[i], positions[i + 1], positions[i + 2] };
+            aabb_merge(bounds.data(), p);
+        }
+    }
+    for (auto m : fixedMeshes) meshBounds.erase(m);
+
+    tinygltf::Buffer buffer;
+    buffer.name = "quantized";
+    this->_model.buffers.push_back(buffer);
+    auto bufferIndex = (int)this->_model.buffers.size() - 1;
+
+    std::set<int> done;
+    size_t before = 0, after = 0;
+    for (size_t m = 0; m < this->_model.meshes.size(); m++)
+    {
+        for (auto& primitive : this->_model.meshes[m].primitives)
+        {
+            for (auto name : names)
+            {
+                auto it = primitive.attributes.find(name);
+                if (it == primitive.attributes.end() || done.count(it->second) != 0) continue;
+
+                auto index = it->second;
+                auto& accessor = this->_model.accessors[index];
+                std::vector<float> values;
+                std::vector<unsigned char> data;
+                std::vector<double> low, high;
+                int componentType = 0, elementSize = 0, stride = 0, components = 0;
+                bool normalized = true;
+
+                if (it->first == "POSITION" && meshBounds.count((int)m) != 0)
+                {
+                    auto& bounds = meshBounds[(int)m];
+                    accessor_read_floats(this->_model, accessor, false, values);
+                    data.resize(accessor.count * 8);
+                    mesh_quantize_positions((unsigned short *)data.data(), values.data(), accessor.count, bounds.data(), mesh_quantize_scale(bounds.data()));
+                    componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+                    components = 3;
+                    elementSize = 2;
+                    stride = 8;
+                    normalized = false;
+                }
+                else if (it->first == "NORMAL" && quantizable(index, "NORMAL", TINYGLTF_TYPE_VEC3))
+                {
+                    accessor_read_floats(this->_model, accessor, false, values);
+                    data.resize(accessor.count * 4);
+                    mesh_quantize_normals((signed char *)data.data(), values.data(), accessor.count);
+                    componentType = TINYGLTF_COMPONENT_TYPE_BYTE;
+                    components = 3;
+                    elementSize = 1;
+                    stride = 4;
+                }
+                else if (it->first == "TEXCOORD_0" && quantizable(index, "TEXCOORD_0", TINYGLTF_TYPE_VEC2))
+                {
+                    // Wrapping coordinates would need KHR_texture_transform
+                    accessor_read_floats(this->_model, accessor, false, values);
+                    bool inside = true;
+                    for (auto v : values) inside = inside && v >= 0.0f && v <= 1.0f;
+                    if (!inside) continue;
+
+                    data.resize(accessor.count * 4);
+                    mesh_quantize_texcoords((unsigned short *)data.data(), values.data(), accessor.count);
+                    componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+                    components = 2;
+                    elementSize = 2;
+                    stride = 0;
+                }
+                else
+                {
+                    continue;
+                }
+
+                // min/max of the integer values
+                low.assign(components, 0.0);
+                high.assign(components, 0.0);
+                for (size_t i = 0; i < accessor.count; i++)
+                {
+                    for (int k = 0; k < components; k++)
+                    {
+                        auto p = &data[i * (stride > 0 ? stride : components * elementSize) + k * elementSize];
+                        double v = 0.0;
+                        if (componentType == TINYGLTF_COMPONENT_TYPE_BYTE) v = *(const signed char *)p;
+                        else v = *(const unsigned short *)p;
+                        if (i == 0 || v < low[k]) low[k] = v;
+                        if (i == 0 || v > high[k]) high[k] = v;
+                    }
+                }
+
+                before += accessor.count * components * sizeof(float);
+                after += data.size();
+                done.insert(index);
+
+                accessor.bufferView = accessor_add_view(this->_model, bufferIndex, data.data(), data.size(), stride, TINYGLTF_TARGET_ARRAY_BUFFER);
+                accessor.byteOffset = 0;
+                accessor.componentType = componentType;
+                accessor.normalized = normalized;
+                accessor.minValues = low;
+                accessor.maxValues = high;
+            }
+        }
+    }
+
+    // The mesh moves to a new child node that turns the integers back into positions,
+    // so the node keeps its own transform and children
+    for (size_t n = 0, count = this->_model.nodes.size(); n < count; n++)
+    {
+        auto found = meshBounds.find(this->_model.nodes[n].mesh);
+        if (found == meshBounds.end()) continue;
+
+        auto scale = (double)mesh_quantize_scale(found->second.data());
+        tinygltf::Node child;
+        child.mesh = this->_model.nodes[n].mesh;
+        child.name = this->_model.nodes[n].name;
+        child.translation.assign(found->second.begin(), found->second.begin() + 3);
+        child.scale.assign(3, scale);
+
+        this->_model.nodes.push_back(child);
+        this->_model.nodes[n].mesh = -1;
+        this->_model.nodes[n].children.push_back((int)this->_model.nodes.size() - 1);
+    }
+
+    if (!meshBounds.empty()) buildScene();
+
+    if (done.empty())
+    {
+        this->_model.buffers.pop_back();
+        return;
+    }
+
+    this->_model.extensionsUsed.push_back("KHR_mesh_quantization");
+    std::cout << "Quantized " << done.size() << " accessors, vertex data " << before << " -> " << after << " bytes" << std::endl;
+}
+
+void GLScene::uploadBufferViews()
+{
+    static const char *names[] = { "POSITION", "NORMAL", "TEXCOORD_0", "JOINTS_0", "WEIGHTS_0" };
+
+    // Byte range and target of each view, from the accessors that drawing reads. The
+    // target hint of the bufferView is optional and often missing, so it is ignored.
+    typedef struct {
+        size_t begin;
+        size_t end;
+        GLenum target;
+    } Range;
+    std::map<int, Range> ranges;
+    auto use = [this, &ranges] (int index, GLenum target)
+    {
+        if (index < 0 || index >= (int)this->_model.accessors.size()) return;
+
+        auto& accessor = this->_model.accessors[index];
+        if (accessor.count == 0 || accessor_data(this->_model, accessor) == NULL) return;
+
+        auto end = accessor.byteOffset + accessor_stride(this->_model, accessor) * (accessor.count - 1) +
+                   accessor_component_count(accessor.type) * accessor_component_size(accessor.componentType);
+        auto found = ranges.find(accessor.bufferView);
+        if (found == ranges.end())
+        {
+            Range range = { accessor.byteOffset, end, target };
+            ranges[accessor.bufferView] = range;
+            return;
+        }
+
+        // A view used for vertices and indices at once works as an array buffer on desktop GL
+        auto& range = found->second;
+        range.begin = std::min(range.begin, accessor.byteOffset);
+        range.end = std::max(range.end, end);
+        if (range.target != target) range.target = GL_ARRAY_BUFFER;
+    };
+
+    for (size_t m = 0; m < this->_model.meshes.size(); m++)
+    {
+        auto& mesh = this->_model.meshes[m];
+        for (size_t p = 0; p < mesh.primitives.size(); p++)
+        {
+            auto& primitive = mesh.primitives[p];
+            auto position = primitive.attributes.find("POSITION");
+            if (primitive.indices < 0 || position == primitive.attributes.end() || position->second < 0) continue;
+
+            // Merged primitives read everything from the arenas, interleaved ones only their indices
+            auto arena = this->_arenaRanges.count(std::make_pair((int)m, (int)p)) != 0;
+            if (arena && (this->_flags & GLSCENE_MERGED_BUFFERS)) continue;
+
+            use(primitive.indices, GL_ELEMENT_ARRAY_BUFFER);
+            if (arena) continue;
+
+            for (auto name : names)
+            {
+                auto it = primitive.attributes.find(name);
+                if (it != primitive.attributes.end()) use(it->second, GL_ARRAY_BUFFER);
+            }
+        }
+    }
+    for (auto& node : this->_model.nodes)
+    {
+        for (auto& it : node.instanceAttributes) use(it.second, GL_ARRAY_BUFFER);
+    }
+
+    size_t total = 0, uploaded = 0;
+    for (auto& view : this->_model.bufferViews) total += view.byteLength;
+    for (auto& it : ranges)
+    {
+        auto& view = this->_model.bufferViews[it.first];
+        auto& buffer = this->_model.buffers[view.buffer];
+
+        // Keeps the offsets of the accessors in the buffer aligned
+        GLBufferState state;
+        state.first = it.second.begin & ~(size_t)3;
+
+        glGenBuffers(1, &state.vb);
+        glBindBuffer(it.second.target, state.vb);
+        glBufferData(it.second.target, it.second.end - state.first, &buffer.data[view.byteOffset + state.first], GL_STATIC_DRAW);
+        glBindBuffer(it.second.target, 0);
+
+        this->_buffers[it.first] = state;
+        uploaded += it.second.end - state.first;
+    }
+
+    std::cout << "Uploaded " << uploaded << " of " << total << " bytes in " << this->_model.bufferViews.size() << " bufferViews, "
+              << total - uploaded << " bytes are not drawn from" << std::endl;
+}
+
+// Subtrees below different roots share no nodes, the pending ones update on the workers
+bool GLScene::updateGraph()
+{
+    this->_pendingSubtrees.clear();
+    for (int s = 0; s < this->_graph.SubtreeCount(); s++)
+    {
+        if (this->_graph.SubtreePending(s)) this->_pendingSubtrees.push_back(s);
+    }
+
+    this->_subtreeChanges.assign(this->_pendingSubtrees.size(), 0);
+    this->_workers.ParallelFor((int)this->_pendingSubtrees.size(), [this] (int i)
+    {
+        this->_subtreeChanges[i] = this->_graph.UpdateSubtree(this->_pendingSubtrees[i]) ? 1 : 0;
+    }, 8, "transforms");
+    return std::find(this->_subtreeChanges.begin(), this->_subtreeChanges.end(), 1) != this->_subtreeChanges.end();
+}
+
+// Every skin writes its own range of _jointMatrices, so skins update on the workers
+void GLScene::updateSkins(bool all)
+{
+    this->_workers.ParallelFor((int)this->_skins.size(), [this, all] (int s)
+    {
+        auto& skin = this->_skins[s];
+        auto& joints = this->_model.skins[s].joints;
+        if (skin.baked) return;
+
+        skin.changed = all;
+        for (size_t j = 0; j < joints.size() && !skin.changed; j++)
+        {
+            skin.changed = joints[j] >= 0 && joints[j] < this->_graph.NodeCount() && this->_graph.Changed(joints[j]);
+        }
+        if (!skin.changed) return;
+
+        for (size_t j = 0; j < joints.size(); j++)
+        {
+            auto matrix = &this->_jointMatrices[(skin.firstJoint + j) * 16];
+            auto inverseBind = &this->_inverseBindMatrices[(skin.firstJoint + j) * 16];
+            if (joints[j] >= 0 && joints[j] < this->_graph.NodeCount())
+                mat4_mul(matrix, this->_graph.World(joints[j]), inverseBind);
+            else
+                mat4_copy(matrix, inverseBind);
+        }
+    }, 4, "skins");
+}
+
+void GLScene::updateMorphs(bool all)
+{
+    for (auto& morph : this->_morphs)
+    {
+        morph.changed = all || this->_graph.WeightsChanged(morph.node);
+        if (!morph.changed) continue;
+
+        // Each target moves the vertices at most by its weight times its delta bounds
+        auto& targets = this->_morphTargets[morph.targets];
+        auto weights = this->_graph.Weights(morph.node);
+        auto count = std::min(targets.targetCount, this->_graph.WeightCount(morph.node));
+        morph.dirty = true;
+        morph.active.clear();
+        memcpy(morph.bounds, targets.baseBounds, sizeof(morph.bounds));
+        for (int t = 0; t < count; t++)
+        {
+            auto weight = weights[t];
+            if (weight == 0.0f) continue;
+
+            morph.active.push_back(std::make_pair(t, weight));
+            auto delta = &targets.bounds[t * 6];
+            for (int k = 0; k < 3; k++)
+            {
+                morph.bounds[k] += std::min(weight * delta[k], weight * delta[k + 3]);
+                morph.bounds[k + 3] += std::max(weight * delta[k], weight * delta[k + 3]);
+            }
+        }
+    }
+}
+
+// Every draw item writes its own bounds and slot, so items update on the workers and
+// only mark what moved. The shared dirty state is gathered afterwards in order.
+void GLScene::updateDrawItems(bool all)
+{
+    this->_itemChanges.assign(this->_drawItems.size(), 0);
+    this->_workers.ParallelFor((int)this->_drawItems.size(), [this, all] (int i)
+    {
+        auto& item = this->_drawItems[i];
+        auto morphed = item.morph >= 0 && this->_morphs[item.morph].changed;
+        auto local = item.morph >= 0 ? this->_morphs[item.morph].bounds : item.localBounds;
+        if (item.vat >= 0)
+        {
+            // Baked items only move with their anchor, their bounds hold every frame
+            auto slot = this->_vatSlots[i];
+            auto anchor = this->_vatAnchors[slot];
+            if (!all && (anchor < 0 || !this->_graph.Changed(anchor))) return;
+
+            auto model = &this->_vatInstances[slot * 17];
+            if (anchor >= 0)
+                mat4_mul(model, this->_graph.World(anchor), &this->_vatPlacements[slot * 16]);
+            else
+                mat4_copy(model, &this->_vatPlacements[slot * 16]);
+            aabb_transform(&this->_worldBounds[i * 6], this->_vertexAnimations[item.vat].bounds, model);
+            this->_itemChanges[i] = 1;
+            return;
+        }
+        if (item.skin >= 0)
+        {
+            // A skinned vertex is a weighted sum of the vertex moved by each of its joints,
+            // so the boxes of all joints together enclose it. The node transform is not used,
+            // without skinning the vertices stay where they are in the bind pose.
+            auto& skin = this->_skins[item.skin];
+            if (!all && !skin.changed && !morphed) return;
+
+            auto bounds = &this->_worldBounds[i * 6];
+            memcpy(bounds, local, sizeof(item.localBounds));
+            if (this->_skinProgram == 0 || skin.paletteOffset < 0) return;
+
+            aabb_empty(bounds);
+            for (int j = 0; j < skin.jointCount; j++)
+            {
+                float jointBounds[6];
+                aabb_transform(jointBounds, local, &this->_jointMatrices[(skin.firstJoint + j) * 16]);
+                aabb_merge(bounds, jointBounds);
+            }
+            return;
+        }
+
+        if (all || morphed || this->_graph.Changed(item.node))
+        {
+            auto world = this->_graph.World(item.node);
+            aabb_transform(&this->_worldBounds[i * 6], local, world);
+
+            if (!this->_itemSlots.empty() && this->_itemSlots[i] >= 0)
+            {
+                auto slot = this->_itemSlots[i];
+                mat4_copy(&this->_instanceMatrices[slot * 16], world);
+                this->_itemChanges[i] = 2;
+            }
+        }
+    }, 64, "draw items");
+
+    for (size_t i = 0; i < this->_itemChanges.size(); i++)
+    {
+        if (this->_itemChanges[i] == 1)
+            this->_vatDirty = true;
+        else if (this->_itemChanges[i] == 2 && !all)
+            this->_dirtySlots.push_back(this->_itemSlots[i]);
+    }
+}
+
+void GLScene::uploadDirtySlots(const GLFramePacket& frame)
+{
+    auto& slots = frame.dirtySlots;
+    if (slots.empty() || this->_instanceBuffer == 0) return;
+
+    // Runs are written to the stream and copied on the gpu, so the cpu never waits
+    // for draws of the previous frame that still read the instance buffer
+    glBindBuffer(GL_ARRAY_BUFFER, this->_instanceBuffer);
+    glBindBuffer(GL_COPY_READ_BUFFER, this->_stream.Buffer());
+    for (size_t i = 0; i < slots.size();)
+    {
+        size_t end = i + 1;
+        while (end < slots.size() && slots[end] == slots[end - 1] + 1) end++;
+
+        auto first = slots[i];
+        auto size = (end - i) * sizeof(float) * 16;
+        GLintptr offset = 0;
+        auto data = this->_stream.Allocate(size, 16, &offset);
+        if (data != NULL)
+        {
+            memcpy(data, &frame.slotMatrices[i * 16], size);
+            this->_stream.Flush();
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER, offset, first * sizeof(float) * 16, size);
+        }
+        else
+        {
+            glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(float) * 16, size, &frame.slotMatrices[i * 16]);
+        }
+        i = end;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+static void ParallelForWorkers(int count, void (*body)(int, void *), void *data, void *user)
+{
+    static_cast<ThreadPool*>(user)->ParallelFor(count, [body, data] (int i) { body(i, data); }, 1, "images");
+}
+
+bool GLScene::Load(const std::string& filename)
+{
+    std::string err;
+    std::string ext = GetFilePathExtension(filename);
+    bool ret = false;
+
+    // Images decode on the workers
+    tinygltf::TinyGLTF loader;
+    loader.SetParallelFor(ParallelForWorkers, &this->_workers);
+    if (ext.compare("glb") == 0) // assume binary glTF.
+    {
+        ret = loader.LoadBinaryFromFile(&this->_model, &err, filename.c_str());
+    }
+    else // assume ascii glTF.
+    {
+        ret = loader.LoadASCIIFromFile(&this->_model, &err, filename.c_str());
+    }
+
+    if (!err.empty()) std::cerr << "ERR: " << err << std::endl;
+
+    if (!ret) return false;
+
+    prepareModel();
+    return true;
+}
+
+bool GLScene::Load(const tinygltf::Model& model)
+{
+    this->_model = model;
+    prepareModel();
+    return true;
+}
+
+// Everything Load() does after parsing, none of it needs a gl context
+void GLScene::prepareModel()
+{
+    materializeAccessors();
+    buildScene();
+    this->_animation.Build(this->_model);
+    this->_animation.Partition(this->_graph);
+}
+
+// Attributes, indices and instance attributes are uploaded from their bufferViews, sparse
+// ones get a dense bufferView first. Everything else reads the substituted elements in place.
+void GLScene::materializeAccessors()
+{
+    std::set<int> uploaded;
+    for (auto& mesh : this->_model.meshes)
+    {
+        for (auto& primitive : mesh.primitives)
+        {
+            for (auto& it : primitive.attributes) uploaded.insert(it.second);
+            uploaded.insert(primitive.indices);
+        }
+    }
+    for (auto& node : this->_model.nodes)
+    {
+        for (auto& it : node.instanceAttributes) uploaded.insert(it.second);
+    }
+
+    int count = 0;
+    for (auto index : uploaded)
+    {
+        if (index < 0 || index >= (int)this->_model.accessors.size() || !this->_model.accessors[index].sparse.isSparse) continue;
+
+        if (accessor_materialize(this->_model, this->_model.accessors[index]))
+            count++;
+        else
+            std::cout << "WARN: sparse accessor " << index << " can not be read" << std::endl;
+    }
+    if (count > 0) std::cout << "Materialized " << count << " sparse accessors for upload" << std::endl;
+}
+
+void GLScene::buildScene()
+{
+    this->_graph.Build(this->_model, this->_model.defaultScene);
+    this->_graph.Update();
+
+    buildSkins();
+    updateSkins(true);
+    buildDrawItems();
+    buildMorphs();
+    updateMorphs(true);
+    updateDrawItems(true);
+    this->_bvh.Build(this->_worldBounds.data(), (int)this->_drawItems.size());
+
+    buildBatches();
+    updateDrawItems(true);
+
+    // Until the first Cull() everything is visible
+    this->_visible.resize(this->_drawItems.size());
+    for (size_t i = 0; i < this->_visible.size(); i++) this->_visible[i] = (int)i;
+}
+
+void GLScene::buildSkins()
+{
+    this->_skins.clear();
+    this->_inverseBindMatrices.clear();
+
+    std::vector<float> matrices;
+    for (auto& skin : this->_model.skins)
+    {
+        GLSkin s = { (int)(this->_inverseBindMatrices.size() / 16), (int)skin.joints.size(), true, -1, false };
+
+        // Without inverse bind matrices they are identities
+        matrices.clear();
+        if (skin.inverseBindMatrices >= 0 && skin.inverseBindMatrices < (int)this->_model.accessors.size())
+        {
+            auto& accessor = this->_model.accessors[skin.inverseBindMatrices];
+            if (accessor.type == TINYGLTF_TYPE_MAT4) accessor_read_floats(this->_model, accessor, false, matrices);
+        }
+        for (size_t j = 0; j < skin.joints.size(); j++)
+        {
+            float m[16];
+            if (matrices.size() >= (j + 1) * 16)
+                mat4_copy(m, &matrices[j * 16]);
+            else
+                mat4_identity(m);
+            this->_inverseBindMatrices.insert(this->_inverseBindMatrices.end(), m, m + 16);
+        }
+        this->_skins.push_back(s);
+    }
+    this->_jointMatrices.resize(this->_inverseBindMatrices.size());
+}
+
+void GLScene::buildMorphs()
+{
+    this->_morphs.clear();
+    this->_morphTargets.clear();
+    this->_primitiveMorphs.clear();
+
+    // EXT_mesh_gpu_instancing items keep the shape without targets
+    for (auto& item : this->_drawItems)
+    {
+        auto& primitive = this->_model.meshes[item.mesh].primitives[item.primitive];
+        if (item.instanceCount > 0 || primitive.targets.empty()) continue;
+
+        auto key = std::make_pair(item.mesh, item.primitive);
+        auto found = this->_primitiveMorphs.find(key);
+        if (found == this->_primitiveMorphs.end())
+        {
+            found = this->_primitiveMorphs.insert(std::make_pair(key, -1)).first;
+
+            GLMorphTargets targets;
+            targets.mesh = item.mesh;
+            targets.primitive = item.primitive;
+            targets.targetCount = (int)primitive.targets.size();
+            targets.vertexCount = this->_model.accessors[primitive.attributes.find("POSITION")->second].count;
+            targets.normals = false;
+            targets.cpu = false;
+            targets.firstTexel = -1;
+            memcpy(targets.baseBounds, item.localBounds, sizeof(targets.baseBounds));
+            targets.bounds.assign(targets.targetCount * 6, 0.0f);
+
+            auto valid = [this, &targets] (const std::map<std::string, int>& attributes, const char *name)
+            {
+                auto it = attributes.find(name);
+                if (it == attributes.end()) return true;
+                if (it->second < 0 || it->second >= (int)this->_model.accessors.size()) return false;
+
+                auto& accessor = this->_model.accessors[it->second];
+                return accessor.type == TINYGLTF_TYPE_VEC3 && accessor.count == targets.vertexCount && accessor_readable(this->_model, accessor);
+            };
+
+            auto baseNormals = primitive.attributes.count("NORMAL") != 0 && valid(primitive.attributes, "NORMAL");
+            bool usable = true;
+            for (int t = 0; t < targets.targetCount && usable; t++)
+            {
+                auto& target = primitive.targets[t];
+                usable = valid(target, "POSITION") && valid(target, "NORMAL");
+                targets.normals = targets.normals || (baseNormals && target.count("NORMAL") != 0);
+
+                auto position = target.find("POSITION");
+                if (usable && position != target.end())
+                    usable = GetPositionBounds(this->_model, this->_model.accessors[position->second], &targets.bounds[t * 6]);
+            }
+            if (!usable)
+            {
+                std::cout << "WARN: morph targets of primitive " << item.primitive << " of mesh " << item.mesh << " do not match its vertices, it is drawn without them" << std::endl;
+                continue;
+            }
+
+            found->second = (int)this->_morphTargets.size();
+            this->_morphTargets.push_back(targets);
+        }
+        if (found->second < 0) continue;
+
+        GLMorph morph;
+        morph.targets = found->second;
+        morph.node = item.node;
+        morph.changed = true;
+        morph.dirty = true;
+        morph.bufferOffset = -1;
+        memcpy(morph.bounds, item.localBounds, sizeof(morph.bounds));
+
+        item.morph = (int)this->_morphs.size();
+        this->_morphs.push_back(morph);
+    }
+}
+
+void GLScene::SetLodChain(int levels, float reduction, float threshold)
+{
+    this->_lodLevels = levels;
+    this->_lodReduction = reduction;
+    this->_lodThreshold = threshold;
+}
+
+void GLScene::SetOcclusion(int width, int height, int maxOccluders)
+{
+    this->_occlusionWidth = width;
+    this->_occlusionHeight = height;
+    this->_maxOccluders = maxOccluders;
+}
+
+void GLScene::SetSkinningProgram(GLuint prog)
+{
+    this->_skinProgram = prog;
+}
+
+void GLScene::SetMorphProgram(GLuint prog)
+{
+    this->_morphProgram = prog;
+}
+
+void GLScene::SetVertexAnimation(GLuint prog, int animation, float frameRate)
+{
+    this->_vatProgram = prog;
+    this->_vatAnimation = animation;
+    this->_vatFrameRate = frameRate;
+}
+
+void GLScene::SetTimeOffset(int node, float seconds)
+{
+    this->_timeOffsets[node] = seconds;
+
+    // After Setup() the slots of the node take it right away
+    for (size_t i = 0; i < this->_vatSlots.size(); i++)
+    {
+        if (this->_vatSlots[i] < 0 || this->_drawItems[i].node != node) continue;
+
+        this->_vatInstances[this->_vatSlots[i] * 17 + 16] = seconds * this->_vatFrameRate;
+        this->_vatDirty = true;
+    }
+}
+
+void GLScene::SetTextureCache(const std::string& directory)
+{
+    this->_textureCache = directory;
+}
+
+void GLScene::SetAnimationTolerance(float tolerance, float angleTolerance)
+{
+    this->_animationTolerance = tolerance;
+    this->_animationAngleTolerance = angleTolerance;
+}
+
+void GLScene::SetAnimationLod(float distance, int interval, int budget)
+{
+    this->_animationLodDistance = distance;
+    this->_animationLodInterval = std::max(1, interval);
+    this->_animationBudget = budget;
+}
+
+static bool HasExtension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        auto extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (extension != NULL && strcmp(extension, name) == 0) return true;
+    }
+    return false;
+}
+
+void GLScene::Setup(GLuint prog, unsigned int flags)
+{
+    this->_program = prog;
+    glUseProgram(prog);
+
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if ((flags & GLSCENE_MERGED_BUFFERS) && major * 10 + minor < 43)
+    {
+        std::cout << "WARN: merged buffers need OpenGL 4.3, using a buffer per bufferView" << std::endl;
+        flags &= ~GLSCENE_MERGED_BUFFERS;
+    }
+    this->_s3tc = HasExtension("GL_EXT_texture_compression_s3tc");
+    this->_bptc = major * 10 + minor >= 42 || HasExtension("GL_ARB_texture_compression_bptc");
+    this->_samplerObjects = major * 10 + minor >= 33;
+    this->_uniformBuffers = major * 10 + minor >= 31 || HasExtension("GL_ARB_uniform_buffer_object");
+    this->_textureBuffers = major * 10 + minor >= 31 || HasExtension("GL_ARB_texture_buffer_object");
+    if ((flags & GLSCENE_COMPRESS_TEXTURES) && !this->_s3tc)
+    {
+        std::cout << "WARN: compressed textures need EXT_texture_compression_s3tc, uploading them uncompressed" << std::endl;
+        flags &= ~GLSCENE_COMPRESS_TEXTURES;
+    }
+    this->_flags = flags;
+
+    if (this->_flags & GLSCENE_COMPRESS_ANIMATIONS)
+    {
+        auto size = this->_animation.ByteSize();
+        auto keys = this->_animation.Compress(this->_animationTolerance, this->_animationAngleTolerance);
+        std::cout << "Compressed animations to " << keys << " keys, " << size << " -> " << this->_animation.ByteSize() << " bytes" << std::endl;
+    }
+
+    // Changes the node hierarchy, so it goes before anything uses the draw items
+    if (this->_flags & GLSCENE_QUANTIZE_VERTICES) quantizeMeshes();
+
+    this->_attribs["POSITION"] = glGetAttribLocation(prog, "in_vertex");
+    this->_attribs["NORMAL"] = glGetAttribLocation(prog, "in_normal");
+    this->_attribs["TEXCOORD_0"] = glGetAttribLocation(prog, "in_texcoord");
+    this->_modelAttrib = glGetAttribLocation(prog, "in_model");
+    this->_instanceAttribs["TRANSLATION"] = glGetAttribLocation(prog, "in_instance_translation");
+    this->_instanceAttribs["ROTATION"] = glGetAttribLocation(prog, "in_instance_rotation");
+    this->_instanceAttribs["SCALE"] = glGetAttribLocation(prog, "in_instance_scale");
+    setConstantInstance(NULL);
+
+    this->_layerAttrib = glGetAttribLocation(prog, "in_layer");
+    auto arrayLocation = glGetUniformLocation(prog, "diffuseArray");
+    if (arrayLocation >= 0) glUniform1i(arrayLocation, 1);
+    if ((this->_flags & GLSCENE_TEXTURE_ARRAYS) && (this->_layerAttrib < 0 || arrayLocation < 0))
+    {
+        std::cout << "WARN: texture arrays need in_layer and diffuseArray in the shader" << std::endl;
+        this->_flags &= ~GLSCENE_TEXTURE_ARRAYS;
+    }
+
+    this->_attribs["JOINTS_0"] = -1;
+    this->_attribs["WEIGHTS_0"] = -1;
+    if (!setupVertexAnimation(prog)) this->_vatProgram = 0;
+    buildVertexAnimations();  // before skins get palettes and morphs get blend buffers
+    if (!setupSkinning(prog)) this->_skinProgram = 0;
+    if (!setupMorphing(prog)) this->_morphProgram = 0;
+    packMorphs();
+
+    // Skinned items are bounded by their joints from here on, or by their bind pose without skinning
+    if (!this->_skins.empty() || !this->_vertexAnimations.empty())
+    {
+        updateDrawItems(true);
+        this->_bvh.Refit(this->_worldBounds.data());
+    }
+
+    size_t streamSize = 0;
+    if (this->_modelAttrib >= 0 && !this->_instanceMatrices.empty())
+    {
+        glGenBuffers(1, &this->_instanceBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, this->_instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, this->_instanceMatrices.size() * sizeof(float), this->_instanceMatrices.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // Room for every slot to change and one indirect command per slot, in the same frame
+        auto slots = this->_slotBatches.size();
+        streamSize += slots * (sizeof(float) * 16 + 16 + sizeof(GLDrawCommand)) + 256;
+    }
+    if (this->_skinProgram != 0)
+    {
+        // Regions start aligned too, so palette offsets are aligned in the whole buffer
+        auto alignment = (size_t)this->_paletteAlignment;
+        streamSize = (streamSize + this->_paletteSize + alignment * 2 - 1) / alignment * alignment;
+    }
+    if (this->_morphBufferSize > 0) streamSize += this->_morphBufferSize + 16;
+    if (streamSize > 0) this->_stream.Setup(streamSize);
+
+    this->_itemLods.assign(this->_drawItems.size(), 0);
+    this->_slotLods.assign(this->_slotBatches.size(), 0);
+    if (this->_flags & GLSCENE_OPTIMIZE_MESHES) optimizeMeshes();
+    if (!this->_morphs.empty()) uploadMorphTargets();  // after the vertices are reordered
+    if (!this->_vertexAnimations.empty()) bakeVertexAnimations();  // same
+    if (this->_flags & GLSCENE_ANIMATION_LOD) buildAnimationLod();   // after the baked skins are known
+    if (this->_flags & GLSCENE_GENERATE_LODS) buildLods();
+    if (this->_flags & GLSCENE_OCCLUSION_CULLING) this->_occlusion.Setup(this->_occlusionWidth, this->_occlusionHeight);
+
+    // Buckets group by texture, so textures come first
+    buildTextures();
+
+    if (this->_flags & GLSCENE_MERGED_BUFFERS)
+    {
+        buildArenas();
+        buildBuckets();
+        glGenBuffers(1, &this->_indirectBuffer);
+    }
+    else if (this->_flags & GLSCENE_INTERLEAVED_BUFFERS)
+    {
+        buildInterleaved();
+    }
+
+    uploadBufferViews();
+}
+
+// Binds the attributes of other to the locations they have in prog, so bindPrimitive()
+// works for both, and marks the locations prog uses. Takes effect when other is linked.
+static void ShareAttribLocations(GLuint prog, GLuint other, std::vector<bool>& used)
+{
+    GLint maxAttribs = 0, count = 0;
+    glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &maxAttribs);
+    glGetProgramiv(prog, GL_ACTIVE_ATTRIBUTES, &count);
+    used.assign(maxAttribs, false);
+    for (GLint i = 0; i < count; i++)
+    {
+        char name[256];
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveAttrib(prog, (GLuint)i, sizeof(name), NULL, &size, &type, name);
+        auto location = glGetAttribLocation(prog, name);
+        if (location < 0) continue;  // built-in gl_ attributes
+
+        auto columns = type == GL_FLOAT_MAT4 ? 4 : type == GL_FLOAT_MAT3 ? 3 : type == GL_FLOAT_MAT2 ? 2 : 1;
+        for (int k = 0; k < columns * size && location + k < maxAttribs; k++) used[location + k] = true;
+        glBindAttribLocation(other, location, name);
+    }
+}
+
+// The skinned program gets the attribute locations of prog, and in_joints and
+// in_weights go where prog has nothing
+bool GLScene::setupSkinning(GLuint prog)
+{
+    if (this->_skinProgram == 0 || this->_skins.empty()) return false;
+    if (std::find_if(this->_skins.begin(), this->_skins.end(), [] (const GLSkin& skin) { return !skin.baked; }) == this->_skins.end()) return false;
+
+    if (!this->_uniformBuffers)
+    {
+        std::cout << "WARN: skinning needs uniform buffers, skinned meshes are drawn in their bind pose" << std::endl;
+        return false;
+    }
+
+    std::vector<bool> used;
+    ShareAttribLocations(prog, this->_skinProgram, used);
+
+    GLint joints = -1, weights = -1;
+    for (GLint location = 0; location < (GLint)used.size() && weights < 0; location++)
+    {
+        if (used[location]) continue;
+        if (joints < 0) joints = location;
+        else weights = location;
+    }
+    if (weights < 0)
+    {
+        std::cout << "WARN: no free attribute locations for in_joints and in_weights, skinned meshes are drawn in their bind pose" << std::endl;
+        return false;
+    }
+    glBindAttribLocation(this->_skinProgram, joints, "in_joints");
+    glBindAttribLocation(this->_skinProgram, weights, "in_weights");
+    glLinkProgram(this->_skinProgram);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(this->_skinProgram, GL_LINK_STATUS, &linked);
+    auto block = linked == GL_TRUE ? glGetUniformBlockIndex(this->_skinProgram, "JointPalette") : GL_INVALID_INDEX;
+    if (block == GL_INVALID_INDEX || glGetAttribLocation(this->_skinProgram, "in_joints") != joints ||
+        glGetAttribLocation(this->_skinProgram, "in_weights") != weights)
+    {
+        std::cout << "WARN: skinning needs in_joints, in_weights and a JointPalette uniform block in the skinned program" << std::endl;
+        return false;
+    }
+    glUniformBlockBinding(this->_skinProgram, block, 0);
+    glGetActiveUniformBlockiv(this->_skinProgram, block, GL_UNIFORM_BLOCK_DATA_SIZE, &this->_paletteBlockSize);
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &this->_paletteAlignment);
+    if (this->_paletteAlignment < 1) this->_paletteAlignment = 1;
+
+    // Palettes of all skins are packed in one upload per frame, each draw binds a
+    // block sized range of it. The last range needs room for a whole block.
+    this->_paletteSize = 0;
+    for (size_t s = 0; s < this->_skins.size(); s++)
+    {
+        auto& skin = this->_skins[s];
+        auto size = (GLint)(skin.jointCount * sizeof(float) * 16);
+        if (skin.baked) continue;
+        if (size > this->_paletteBlockSize)
+        {
+            std::cout << "WARN: skin " << s << " has " << skin.jointCount << " joints, more than JointPalette holds, it is drawn in its bind pose" << std::endl;
+            continue;
+        }
+        skin.paletteOffset = (int)this->_paletteSize;
+        this->_paletteSize += (size + this->_paletteAlignment - 1) / this->_paletteAlignment * this->_paletteAlignment;
+    }
+    this->_paletteSize += this->_paletteBlockSize;
+
+    // Same texture units as prog
+    glUseProgram(this->_skinProgram);
+    auto arrayLocation = glGetUniformLocation(this->_skinProgram, "diffuseArray");
+    if (arrayLocation >= 0) glUniform1i(arrayLocation, 1);
+    glUseProgram(prog);
+
+    this->_attribs["JOINTS_0"] = joints;
+    this->_attribs["WEIGHTS_0"] = weights;
+    return true;
+}
+
+// The morph program gets the attribute locations of prog. It reads the deltas of the
+// active targets of a draw from a texture buffer at gl_VertexID.
+bool GLScene::setupMorphing(GLuint prog)
+{
+    if (this->_morphProgram == 0 || this->_morphTargets.empty()) return false;
+
+    if (!this->_textureBuffers)
+    {
+        std::cout << "WARN: morphing on the gpu needs texture buffers, morph targets are blended on the cpu" << std::endl;
+        return false;
+    }
+
+    std::vector<bool> used;
+    ShareAttribLocations(prog, this->_morphProgram, used);
+    glLinkProgram(this->_morphProgram);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(this->_morphProgram, GL_LINK_STATUS, &linked);
+    static const char *names[] = { "morphDeltas", "morphCount", "morphOffsets", "morphWeights", "morphNormals" };
+    bool found = linked == GL_TRUE;
+    for (auto name : names)
+    {
+        this->_morphUniforms[name] = linked == GL_TRUE ? glGetUniformLocation(this->_morphProgram, name) : -1;
+        found = found && this->_morphUniforms[name] >= 0;
+    }
+
+    // As many targets per draw as both arrays hold, bindMorph() passes at most 64
+    this->_morphSlots = 64;
+    GLint count = 0;
+    glGetProgramiv(this->_morphProgram, GL_ACTIVE_UNIFORMS, &count);
+    for (GLint i = 0; i < count && found; i++)
+    {
+        char name[256];
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(this->_morphProgram, (GLuint)i, sizeof(name), NULL, &size, &type, name);
+        if (strncmp(name, "morphOffsets", 12) == 0 || strncmp(name, "morphWeights", 12) == 0) this->_morphSlots = std::min(this->_morphSlots, (GLint)size);
+    }
+    if (!found)
+    {
+        std::cout << "WARN: morphing on the gpu needs morphDeltas, morphCount, morphOffsets, morphWeights and morphNormals in the morph program" << std::endl;
+        return false;
+    }
+
+    // Every target of every primitive, positions and then normals, one texel per vertex
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    size_t texels = 0;
+    for (auto& targets : this->_morphTargets) texels += targets.targetCount * targets.vertexCount * (targets.normals ? 2 : 1);
+    if (texels > (size_t)maxTexels)
+    {
+        std::cout << "WARN: morph targets need " << texels << " texels, more than a texture buffer holds, they are blended on the cpu" << std::endl;
+        return false;
+    }
+
+    texels = 0;
+    for (auto& targets : this->_morphTargets)
+    {
+        targets.firstTexel = (GLint)texels;
+        texels += targets.targetCount * targets.vertexCount * (targets.normals ? 2 : 1);
+    }
+
+    // Same texture units as prog, the deltas on unit 2
+    glUseProgram(this->_morphProgram);
+    glUniform1i(this->_morphUniforms["morphDeltas"], 2);
+    auto arrayLocation = glGetUniformLocation(this->_morphProgram, "diffuseArray");
+    if (arrayLocation >= 0) glUniform1i(arrayLocation, 1);
+    glUseProgram(prog);
+    return true;
+}
+
+// Items that can not always morph on the gpu get a range of _morphBuffer for their blended vertices
+void GLScene::packMorphs()
+{
+    this->_morphBufferSize = 0;
+    for (auto& item : this->_drawItems)
+    {
+        if (item.morph < 0 || item.vat >= 0) continue;
+
+        auto& morph = this->_morphs[item.morph];
+        auto& targets = this->_morphTargets[morph.targets];
+        if (this->_morphProgram != 0 && item.skin < 0 && targets.targetCount <= this->_morphSlots) continue;
+
+        morph.bufferOffset = (int)this->_morphBufferSize;
+        targets.cpu = true;
+        this->_morphBufferSize += targets.vertexCount * sizeof(float) * 4 * (targets.normals ? 2 : 1);
+    }
+    if (this->_morphBufferSize == 0) return;
+
+    glGenBuffers(1, &this->_morphBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, this->_morphBuffer);
+    glBufferData(GL_ARRAY_BUFFER, this->_morphBufferSize, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GLScene::uploadMorphTargets()
+{
+    // Copies a VEC3 attribute into the first 3 of every 4 floats, a missing one stays zero
+    std::vector<float> values;
+    auto read = [this, &values] (const std::map<std::string, int>& attributes, const char *name, float *out, size_t count)
+    {
+        auto it = attributes.find(name);
+        if (it == attributes.end()) return;
+
+        auto& accessor = this->_model.accessors[it->second];
+        if (!accessor_read_floats(this->_model, accessor, accessor.normalized, values) || values.size() < count * 3) return;
+        for (size_t v = 0; v < count; v++) memcpy(&out[v * 4], &values[v * 3], sizeof(float) * 3);
+    };
+
+    // Sparse targets without a base name every vertex they move, other targets are scanned
+    std::vector<unsigned int> candidates, indices;
+    auto sparse = [this, &candidates, &indices] (const std::map<std::string, int>& attributes, bool normals)
+    {
+        candidates.clear();
+        for (auto& it : attributes)
+        {
+            if (it.first != "POSITION" && (it.first != "NORMAL" || !normals)) continue;
+
+            const unsigned char *values;
+            auto& accessor = this->_model.accessors[it.second];
+            if (accessor.bufferView >= 0 || !accessor_sparse_elements(this->_model, accessor, indices, &values)) return false;
+            candidates.insert(candidates.end(), indices.begin(), indices.end());
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+        return true;
+    };
+
+    std::vector<float> texels, target;
+    size_t moved = 0, total = 0;
+    for (auto& targets : this->_morphTargets)
+    {
+        auto& primitive = this->_model.meshes[targets.mesh].primitives[targets.primitive];
+        auto n = targets.vertexCount;
+        auto stride = targets.normals ? 8 : 4;
+
+        if (targets.cpu)
+        {
+            targets.base.assign(n * stride, 0.0f);
+            read(primitive.attributes, "POSITION", targets.base.data(), n);
+            if (targets.normals) read(primitive.attributes, "NORMAL", &targets.base[n * 4], n);
+            targets.firstMoved.assign(1, 0);
+        }
+
+        for (int t = 0; t < targets.targetCount; t++)
+        {
+            target.assign(n * stride, 0.0f);
+            read(primitive.targets[t], "POSITION", target.data(), n);
+            if (targets.normals) read(primitive.targets[t], "NORMAL", &target[n * 4], n);
+            if (targets.firstTexel >= 0) texels.insert(texels.end(), target.begin(), target.end());
+            if (!targets.cpu) continue;
+
+            // Targets usually move a small part of the mesh, the cpu only visits that part
+            auto visit = sparse(primitive.targets[t], targets.normals);
+            for (size_t c = 0; c < (visit ? candidates.size() : n); c++)
+            {
+                auto v = visit ? candidates[c] : c;
+                auto p = &target[v * 4];
+                auto q = targets.normals ? &target[(n + v) * 4] : p;
+                if (p[0] == 0.0f && p[1] == 0.0f && p[2] == 0.0f && q[0] == 0.0f && q[1] == 0.0f && q[2] == 0.0f) continue;
+
+                targets.moved.push_back((unsigned int)v);
+                targets.deltas.insert(targets.deltas.end(), p, p + 4);
+                if (targets.normals) targets.deltas.insert(targets.deltas.end(), q, q + 4);
+            }
+            targets.firstMoved.push_back(targets.moved.size());
+            total += n;
+        }
+        moved += targets.moved.size();
+    }
+
+    if (!texels.empty())
+    {
+        glGenBuffers(1, &this->_morphDeltaBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, this->_morphDeltaBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(float), texels.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        glGenTextures(1, &this->_morphTexture);
+        glBindTexture(GL_TEXTURE_BUFFER, this->_morphTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, this->_morphDeltaBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    std::cout << "Morph targets of " << this->_morphTargets.size() << " primitives, " << texels.size() / 4 << " texels on the gpu, "
+              << moved << " of " << total << " target vertices moved on the cpu" << std::endl;
+}
+
+// The vertex animation program gets the attribute locations of prog and in_frame_offset
+// where prog has nothing. It reads the baked frames from a texture buffer at gl_VertexID.
+bool GLScene::setupVertexAnimation(GLuint prog)
+{
+    if (this->_vatProgram == 0) return false;
+    if (this->_vatAnimation < 0 || this->_vatAnimation >= this->_animation.AnimationCount())
+    {
+        std::cout << "WARN: there is no animation " << this->_vatAnimation << " to bake, deformed items are skinned and morphed every frame" << std::endl;
+        return false;
+    }
+    if (this->_modelAttrib < 0)
+    {
+        std::cout << "WARN: vertex animations are drawn instanced and need in_model in the shader, deformed items are skinned and morphed every frame" << std::endl;
+        return false;
+    }
+
+    if (!this->_textureBuffers)
+    {
+        std::cout << "WARN: vertex animations need texture buffers, deformed items are skinned and morphed every frame" << std::endl;
+        return false;
+    }
+
+    std::vector<bool> used;
+    ShareAttribLocations(prog, this->_vatProgram, used);
+
+    GLint offset = -1;
+    for (GLint location = 0; location < (GLint)used.size() && offset < 0; location++)
+    {
+        if (!used[location]) offset = location;
+    }
+    if (offset < 0)
+    {
+        std::cout << "WARN: no free attribute location for in_frame_offset, deformed items are skinned and morphed every frame" << std::endl;
+        return false;
+    }
+    glBindAttribLocation(this->_vatProgram, offset, "in_frame_offset");
+    glLinkProgram(this->_vatProgram);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(this->_vatProgram, GL_LINK_STATUS, &linked);
+    static const char *names[] = { "vatFrames", "vatFirst", "vatVertices", "vatFrameCount", "vatFrame" };
+    bool found = linked == GL_TRUE && glGetAttribLocation(this->_vatProgram, "in_frame_offset") == offset;
+    for (auto name : names)
+    {
+        this->_vatUniforms[name] = linked == GL_TRUE ? glGetUniformLocation(this->_vatProgram, name) : -1;
+        found = found && this->_vatUniforms[name] >= 0;
+    }
+    if (!found)
+    {
+        std::cout << "WARN: vertex animations need in_frame_offset, vatFrames, vatFirst, vatVertices, vatFrameCount and vatFrame in the program" << std::endl;
+        return false;
+    }
+
+    // Same texture units as prog, the frames on unit 3
+    glUseProgram(this->_vatProgram);
+    glUniform1i(this->_vatUniforms["vatFrames"], 3);
+    auto arrayLocation = glGetUniformLocation(this->_vatProgram, "diffuseArray");
+    if (arrayLocation >= 0) glUniform1i(arrayLocation, 1);
+    glUseProgram(prog);
+
+    this->_vatOffsetAttrib = offset;
+    return true;
+}
+
+// The top joint of a skin, where its skeleton is placed in the scene
+static int SkeletonRoot(const tinygltf::Skin& skin, const SceneGraph& graph)
+{
+    if (skin.skeleton >= 0 && skin.skeleton < graph.NodeCount()) return skin.skeleton;
+    if (skin.joints.empty() || skin.joints[0] < 0 || skin.joints[0] >= graph.NodeCount()) return -1;
+
+    auto root = skin.joints[0];
+    while (graph.Parent(root) >= 0 && std::find(skin.joints.begin(), skin.joints.end(), graph.Parent(root)) != skin.joints.end()) root = graph.Parent(root);
+    return root;
+}
+
+// Deformed items are grouped by primitive, the frames of a group are baked for its first
+// item in BVH order. The items of a group get neighbouring slots, so the visible ones are
+// drawn in a few instanced runs. Skins whose items are all baked are not updated any more.
+void GLScene::buildVertexAnimations()
+{
+    this->_vertexAnimations.clear();
+    this->_vatSlots.assign(this->_drawItems.size(), -1);
+    this->_vatAnchors.clear();
+    this->_vatPlacements.clear();
+    this->_vatInstances.clear();
+    for (auto& item : this->_drawItems) item.vat = -1;
+    for (auto& skin : this->_skins) skin.baked = false;
+    if (this->_vatProgram == 0) return;
+
+    auto length = this->_animation.End(this->_vatAnimation) - this->_animation.Start(this->_vatAnimation);
+    this->_vatFrameCount = std::max(1, (int)ceilf(length * this->_vatFrameRate));
+
+    auto readable = [this] (const tinygltf::Primitive& primitive, const char *name)
+    {
+        auto it = primitive.attributes.find(name);
+        return it != primitive.attributes.end() && it->second >= 0 && it->second < (int)this->_model.accessors.size() &&
+               accessor_readable(this->_model, this->_model.accessors[it->second]);
+    };
+
+    std::map<std::pair<std::pair<int, int>, bool>, int> found;
+    std::vector<std::vector<int> > groupItems;
+    for (auto index : this->_bvh.Items())
+    {
+        auto& item = this->_drawItems[index];
+        if (item.instanceCount > 0 || (item.skin < 0 && item.morph < 0)) continue;
+
+        // Skinned primitives without joints are drawn in their bind pose anyway
+        auto& primitive = this->_model.meshes[item.mesh].primitives[item.primitive];
+        if (!readable(primitive, "POSITION")) continue;
+        if (item.skin >= 0 && (!readable(primitive, "JOINTS_0") || !readable(primitive, "WEIGHTS_0") || SkeletonRoot(this->_model.skins[item.skin], this->_graph) < 0)) continue;
+
+        auto key = std::make_pair(std::make_pair(item.mesh, item.primitive), item.skin >= 0);
+        auto group = found.find(key);
+        if (group == found.end())
+        {
+            GLVertexAnimation vat;
+            vat.mesh = item.mesh;
+            vat.primitive = item.primitive;
+            vat.source = index;
+            vat.skinned = item.skin >= 0;
+            vat.firstTexel = 0;
+            vat.vertexCount = (int)this->_model.accessors[primitive.attributes.find("POSITION")->second].count;
+            vat.firstSlot = 0;
+            vat.count = 0;
+            memcpy(vat.bounds, item.localBounds, sizeof(vat.bounds));  // until they are baked
+
+            group = found.insert(std::make_pair(key, (int)this->_vertexAnimations.size())).first;
+            this->_vertexAnimations.push_back(vat);
+            groupItems.push_back(std::vector<int>());
+        }
+        groupItems[group->second].push_back(index);
+    }
+    if (this->_vertexAnimations.empty()) return;
+
+    // Every frame of every group and one at the end, positions and then normals, one texel per vertex
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    size_t texels = 0;
+    for (auto& vat : this->_vertexAnimations)
+    {
+        vat.firstTexel = (int)texels;
+        texels += (size_t)(this->_vatFrameCount + 1) * 2 * vat.vertexCount;
+    }
+    if (texels > (size_t)maxTexels)
+    {
+        std::cout << "WARN: vertex animations need " << texels << " texels, more than a texture buffer holds, deformed items are skinned and morphed every frame" << std::endl;
+        this->_vertexAnimations.clear();
+        this->_vatProgram = 0;
+        return;
+    }
+
+    // A skinned item is placed where its skeleton root is relative to the root's parent,
+    // which animation may still move. A morphed item is placed by its node.
+    int slot = 0;
+    for (size_t a = 0; a < this->_vertexAnimations.size(); a++)
+    {
+        auto& vat = this->_vertexAnimations[a];
+        vat.firstSlot = slot;
+        vat.count = (int)groupItems[a].size();
+        for (auto index : groupItems[a])
+        {
+            auto& item = this->_drawItems[index];
+            item.vat = (int)a;
+            this->_vatSlots[index] = slot++;
+
+            float placement[16];
+            auto anchor = item.node;
+            mat4_identity(placement);
+            if (vat.skinned)
+            {
+                auto root = SkeletonRoot(this->_model.skins[item.skin], this->_graph);
+                anchor = this->_graph.Parent(root);
+                mat4_copy(placement, this->_graph.World(root));
+                if (anchor >= 0)
+                {
+                    float inverse[16];
+                    mat4_inverse_affine(inverse, this->_graph.World(anchor));
+                    mat4_mul(placement, inverse, this->_graph.World(root));
+                }
+            }
+            this->_vatAnchors.push_back(anchor);
+            this->_vatPlacements.insert(this->_vatPlacements.end(), placement, placement + 16);
+
+            auto offset = this->_timeOffsets.find(item.node);
+            this->_vatInstances.insert(this->_vatInstances.end(), placement, placement + 16);
+            this->_vatInstances.push_back(offset != this->_timeOffsets.end() ? offset->second * this->_vatFrameRate : 0.0f);
+        }
+    }
+
+    std::vector<int> items(this->_skins.size(), 0), baked(this->_skins.size(), 0);
+    for (auto& item : this->_drawItems)
+    {
+        if (item.skin < 0) continue;
+        items[item.skin]++;
+        if (item.vat >= 0) baked[item.skin]++;
+    }
+    for (size_t s = 0; s < this->_skins.size(); s++) this->_skins[s].baked = items[s] > 0 && baked[s] == items[s];
+    this->_vatDirty = true;
+}
+
+// Plays the animation on a copy of the scene graph and stores the vertices of each group
+// at every frame, after optimizeMeshes() reordered them. Positions are stored as offsets
+// from the vertex, so the program still reads in_vertex. Skinned vertices are relative to
+// the placement of the source item and its anchor at that frame, so the instance matrix
+// puts them back. Channels that only moved baked items are left out of playback after.
+void GLScene::bakeVertexAnimations()
+{
+    typedef struct {
+        std::vector<float> positions;  // 3 per vertex
+        std::vector<float> normals;    // same, empty without normals
+        std::vector<float> joints;     // 4 per vertex, when skinned
+        std::vector<float> weights;
+        std::vector<std::vector<float> > targetPositions;  // per target, empty when it has none
+        std::vector<std::vector<float> > targetNormals;
+    } GLVertexSource;
+
+    auto read = [this] (const std::map<std::string, int>& attributes, const char *name, bool normalized, std::vector<float>& out)
+    {
+        out.clear();
+        auto it = attributes.find(name);
+        if (it == attributes.end() || it->second < 0 || it->second >= (int)this->_model.accessors.size()) return;
+
+        auto& accessor = this->_model.accessors[it->second];
+        if (!accessor_read_floats(this->_model, accessor, normalized || accessor.normalized, out)) out.clear();
+    };
+
+    std::vector<GLVertexSource> sources(this->_vertexAnimations.size());
+    for (size_t a = 0; a < this->_vertexAnimations.size(); a++)
+    {
+        auto& vat = this->_vertexAnimations[a];
+        auto& source = sources[a];
+        auto& primitive = this->_model.meshes[vat.mesh].primitives[vat.primitive];
+        auto n = (size_t)vat.vertexCount;
+
+        read(primitive.attributes, "POSITION", false, source.positions);
+        read(primitive.attributes, "NORMAL", false, source.normals);
+        if (source.normals.size() != n * 3) source.normals.clear();
+        if (vat.skinned)
+        {
+            read(primitive.attributes, "JOINTS_0", false, source.joints);
+            read(primitive.attributes, "WEIGHTS_0", false, source.weights);
+            if (source.joints.size() != n * 4 || source.weights.size() != n * 4) source.joints.clear();
+        }
+
+        auto morph = this->_drawItems[vat.source].morph;
+        if (morph < 0) continue;
+
+        auto& targets = this->_morphTargets[this->_morphs[morph].targets];
+        source.targetPositions.resize(targets.targetCount);
+        source.targetNormals.resize(targets.targetCount);
+        for (int t = 0; t < targets.targetCount; t++)
+        {
+            read(primitive.targets[t], "POSITION", false, source.targetPositions[t]);
+            if (!source.normals.empty()) read(primitive.targets[t], "NORMAL", false, source.targetNormals[t]);
+        }
+    }
+
+    auto& last = this->_vertexAnimations.back();
+    std::vector<float> texels(((size_t)last.firstTexel + (size_t)(this->_vatFrameCount + 1) * 2 * last.vertexCount) * 4, 0.0f);
+    for (auto& vat : this->_vertexAnimations) aabb_empty(vat.bounds);
+
+    auto graph = this->_graph;
+    auto start = this->_animation.Start(this->_vatAnimation), length = this->_animation.End(this->_vatAnimation) - start;
+    std::vector<float> positions, normals, jointMatrices;
+    for (int f = 0; f <= this->_vatFrameCount; f++)
+    {
+        this->_animation.Apply(this->_vatAnimation, start + length * f / this->_vatFrameCount, graph);
+        graph.Update();
+
+        for (size_t a = 0; a < this->_vertexAnimations.size(); a++)
+        {
+            auto& vat = this->_vertexAnimations[a];
+            auto& source = sources[a];
+            auto& item = this->_drawItems[vat.source];
+            auto n = (size_t)vat.vertexCount;
+
+            positions = source.positions;
+            normals = source.normals;
+            auto weights = graph.Weights(item.node);
+            auto weightCount = std::min((int)source.targetPositions.size(), graph.WeightCount(item.node));
+            for (int t = 0; t < weightCount; t++)
+            {
+                auto weight = weights[t];
+                if (weight == 0.0f) continue;
+
+                auto& p = source.targetPositions[t];
+                auto& q = source.targetNormals[t];
+                for (size_t k = 0; k < p.size() && k < positions.size(); k++) positions[k] += weight * p[k];
+                for (size_t k = 0; k < q.size() && k < normals.size(); k++) normals[k] += weight * q[k];
+            }
+
+            if (vat.skinned && !source.joints.empty())
+            {
+                auto& skin = this->_skins[item.skin];
+                auto& joints = this->_model.skins[item.skin].joints;
+                auto slot = this->_vatSlots[vat.source];
+                auto anchor = this->_vatAnchors[slot];
+
+                float relative[16], inverse[16], matrix[16];
+                mat4_inverse_affine(relative, &this->_vatPlacements[slot * 16]);
+                if (anchor >= 0)
+                {
+                    mat4_inverse_affine(inverse, graph.World(anchor));
+                    mat4_mul(matrix, relative, inverse);
+                    mat4_copy(relative, matrix);
+                }
+
+                jointMatrices.resize(joints.size() * 16);
+                for (size_t j = 0; j < joints.size(); j++)
+                {
+                    auto inverseBind = &this->_inverseBindMatrices[(skin.firstJoint + j) * 16];
+                    if (joints[j] >= 0 && joints[j] < graph.NodeCount())
+                        mat4_mul(matrix, graph.World(joints[j]), inverseBind);
+                    else
+                        mat4_copy(matrix, inverseBind);
+                    mat4_mul(&jointMatrices[j * 16], relative, matrix);
+                }
+
+                for (size_t v = 0; v < n; v++)
+                {
+                    float p[3] = { 0.0f, 0.0f, 0.0f }, q[3] = { 0.0f, 0.0f, 0.0f };
+                    auto position = &positions[v * 3];
+                    auto normal = normals.empty() ? NULL : &normals[v * 3];
+                    for (int k = 0; k < 4; k++)
+                    {
+                        auto joint = (size_t)source.joints[v * 4 + k];
+                        auto weight = source.weights[v * 4 + k];
+                        if (weight == 0.0f || joint >= joints.size()) continue;
+
+                        auto m = &jointMatrices[joint * 16];
+                        for (int r = 0; r < 3; r++)
+                        {
+                            p[r] += weight * (m[r] * position[0] + m[4 + r] * position[1] + m[8 + r] * position[2] + m[12 + r]);
+                            if (normal != NULL) q[r] += weight * (m[r] * normal[0] + m[4 + r] * normal[1] + m[8 + r] * normal[2]);
+                        }
+                    }
+                    memcpy(position, p, sizeof(p));
+                    if (normal != NULL) memcpy(normal, q, sizeof(q));
+                }
+            }
+
+            auto out = &texels[((size_t)vat.firstTexel + f * 2 * n) * 4];
+            for (size_t v = 0; v < n; v++)
+            {
+                auto p = &positions[v * 3];
+                float b[6] = { p[0], p[1], p[2], p[0], p[1], p[2] };
+                aabb_merge(vat.bounds, b);
+                for (int k = 0; k < 3; k++) out[v * 4 + k] = p[k] - source.positions[v * 3 + k];
+                if (normals.empty()) continue;
+
+                auto q = &normals[v * 3];
+                auto l = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2]);
+                for (int k = 0; k < 3; k++) out[(n + v) * 4 + k] = l > 0.0f ? q[k] / l : 0.0f;
+            }
+        }
+    }
+
+    glGenBuffers(1, &this->_vatBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, this->_vatBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(float), texels.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenTextures(1, &this->_vatTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, this->_vatTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, this->_vatBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    glGenBuffers(1, &this->_vatInstanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, this->_vatInstanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, this->_vatInstances.size() * sizeof(float), this->_vatInstances.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Nodes still needed are those drawn as before, the joints of skins that are not baked,
+    // the anchors and everything above them. Weights are only needed where morphing goes on.
+    std::vector<unsigned char> needed(this->_graph.NodeCount(), 0), weighted(this->_graph.NodeCount(), 0);
+    auto need = [this, &needed] (int node)
+    {
+        for (; node >= 0 && node < this->_graph.NodeCount() && !needed[node]; node = this->_graph.Parent(node)) needed[node] = 1;
+    };
+    for (auto& item : this->_drawItems)
+    {
+        if (item.vat >= 0) continue;
+        need(item.node);
+        if (item.morph >= 0) weighted[item.node] = 1;
+    }
+    for (size_t s = 0; s < this->_skins.size(); s++)
+    {
+        if (this->_skins[s].baked) continue;
+        for (auto joint : this->_model.skins[s].joints) need(joint);
+    }
+    for (auto anchor : this->_vatAnchors) need(anchor);
+
+    std::vector<unsigned char> paths(this->_graph.NodeCount(), 0);
+    for (size_t node = 0; node < paths.size(); node++)
+    {
+        if (!needed[node]) paths[node] = 0xff;
+        else if (!weighted[node]) paths[node] = 1 << SCENEANIMATION_WEIGHTS;
+    }
+    auto excluded = this->_animation.Exclude(paths, this->_graph);
+
+    std::cout << "Baked " << this->_vertexAnimations.size() << " vertex animations of " << this->_vatFrameCount + 1 << " frames for "
+              << this->_vatAnchors.size() << " draw items, " << texels.size() / 4 << " texels, " << excluded << " channels left out" << std::endl;
+
+    // The bounds hold every frame now
+    updateDrawItems(true);
+    this->_bvh.Refit(this->_worldBounds.data());
+}
+
+// Each draw item is animated by the subtree of its node, of its skeleton root when skinned
+// or of its anchor when baked. The leaf joints of skins are optional, tier 2 leaves them out.
+void GLScene::buildAnimationLod()
+{
+    this->_itemSubtrees.assign(this->_drawItems.size(), -1);
+    for (size_t i = 0; i < this->_drawItems.size(); i++)
+    {
+        auto& item = this->_drawItems[i];
+        auto node = item.node;
+        if (item.vat >= 0) node = this->_vatAnchors[this->_vatSlots[i]] >= 0 ? this->_vatAnchors[this->_vatSlots[i]] : -1;
+        else if (item.skin >= 0) node = SkeletonRoot(this->_model.skins[item.skin], this->_graph);
+        if (node >= 0 && node < this->_graph.NodeCount()) this->_itemSubtrees[i] = this->_graph.Subtree(node);
+    }
+
+    std::vector<unsigned char> leaves(this->_graph.NodeCount(), 0);
+    for (size_t s = 0; s < this->_skins.size(); s++)
+    {
+        auto& joints = this->_model.skins[s].joints;
+        if (this->_skins[s].baked) continue;
+
+        for (auto joint : joints)
+        {
+            if (joint < 0 || joint >= this->_graph.NodeCount()) continue;
+
+            bool leaf = true;
+            for (size_t j = 0; j < joints.size() && leaf; j++) leaf = joints[j] < 0 || joints[j] >= this->_graph.NodeCount() || this->_graph.Parent(joints[j]) != joint;
+            if (leaf) leaves[joint] = 1;
+        }
+    }
+    auto optional = this->_animation.SetOptional(leaves);
+
+    GLSubtreeAnimation state = { 0.0f, 0.0f, true, false };
+    this->_subtreeAnimations.assign(this->_graph.SubtreeCount(), state);
+    this->_lodAnimation = -1;
+
+    std::cout << "Animation level of detail over " << this->_graph.SubtreeCount() << " subtrees, " << optional << " channels of leaf joints" << std::endl;
+}
+
+static bool operator < (const GLSamplerKey& a, const GLSamplerKey& b)
+{
+    if (a.minFilter != b.minFilter) return a.minFilter < b.minFilter;
+    if (a.magFilter != b.magFilter) return a.magFilter < b.magFilter;
+    if (a.wrapS != b.wrapS) return a.wrapS < b.wrapS;
+    return a.wrapT < b.wrapT;
+}
+
+static int BaseColorTexture(tinygltf::Material& material)
+{
+    auto baseColorTexture = material.values["baseColorTexture"];
+    return (int)baseColorTexture.json_double_value["index"];
+}
+
+static GLSamplerKey SamplerKey(const tinygltf::Model& model, const tinygltf::Texture& texture)
+{
+    GLSamplerKey key = { GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT };
+    if (texture.sampler >= 0 && texture.sampler < (int)model.samplers.size())
+    {
+        auto& s = model.samplers[texture.sampler];
+        key.minFilter = s.minFilter;
+        key.magFilter = s.magFilter;
+        key.wrapS = s.wrapS;
+        key.wrapT = s.wrapT;
+    }
+    return key;
+}
+
+void GLScene::buildTextures()
+{
+    if (this->_flags & GLSCENE_TEXTURE_ARRAYS) buildTextureArrays();
+
+    for (auto& mesh : this->_model.meshes)
+    {
+        for (auto& primitive : mesh.primitives)
+        {
+            if (primitive.material < 0) continue;
+
+            auto textureIndex = BaseColorTexture(this->_model.materials[primitive.material]);
+
+            GLuint sampler = 0;
+            auto texture = getTexture(textureIndex, &sampler);
+            if (texture == 0) continue;
+
+            auto layer = this->_textureLayers.find(textureIndex);
+            this->_meshStates[mesh.name].diffuseTex[primitive.material] = texture;
+            this->_meshStates[mesh.name].diffuseSampler[primitive.material] = sampler;
+            this->_meshStates[mesh.name].diffuseLayer[primitive.material] = layer != this->_textureLayers.end() ? layer->second : -1;
+        }
+    }
+
+    if (this->_flags & GLSCENE_COMPRESS_TEXTURES)
+    {
+        std::cout << "Compressed " << this->_compressedTextures[0] << " textures on " << this->_workers.ThreadCount() << " threads, "
+                  << this->_compressedTextures[1] << " read from the cache" << std::endl;
+    }
+}
+
+static void BuildMipLevels(const unsigned char *pixels, int width, int height, int components, std::vector<std::vector<unsigned char> >& levels)
+{
+    levels.assign(image_mip_count(width, height), std::vector<unsigned char>());
+    levels[0].assign(pixels, pixels + (size_t)width * height * components);
+
+    for (size_t l = 1; l < levels.size(); l++)
+    {
+        levels[l].resize((size_t)(width > 1 ? width / 2 : 1) * (height > 1 ? height / 2 : 1) * components);
+        image_mip_downsample(levels[l].data(), levels[l - 1].data(), width, height, components);
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+}
+
+// BC1 for opaque images, BC3 when any pixel is not
+static int BlockFormat(const tinygltf::Image& image)
+{
+    if (image.component == 4)
+    {
+        for (size_t i = 3; i < image.image.size(); i += 4)
+        {
+            if (image.image[i] != 255) return TEXCOMPRESS_BC3;
+        }
+    }
+    return TEXCOMPRESS_BC1;
+}
+
+// Compressed mip chain of an image, from the cache when it has a file for these pixels.
+// Block rows of all levels are encoded in one parallel loop.
+void GLScene::compressLevels(const tinygltf::Image& image, int format, std::vector<std::vector<unsigned char> >& levels)
+{
+    auto count = image_mip_count(image.width, image.height);
+
+    std::string filename;
+    if (!this->_textureCache.empty())
+    {
+        int key[5] = { image.width, image.height, image.component, format, TEXCOMPRESS_VERSION };
+        auto hash = tex_compress_hash(key, sizeof(key), tex_compress_hash(image.image.data(), image.image.size()));
+
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bcn", hash);
+        filename = this->_textureCache + "/" + name;
+
+        if (tex_cache_read(filename, format, levels) && (int)levels.size() == count)
+        {
+            bool valid = true;
+            int width = image.width, height = image.height;
+            for (int l = 0; l < count; l++)
+            {
+                valid = valid && levels[l].size() == tex_compress_size(width, height, format);
+                width = width > 1 ? width / 2 : 1;
+                height = height > 1 ? height / 2 : 1;
+            }
+            if (valid)
+            {
+                this->_compressedTextures[1]++;
+                return;
+            }
+        }
+    }
+
+    std::vector<std::vector<unsigned char> > pixels;
+    BuildMipLevels(image.image.data(), image.width, image.height, image.component, pixels);
+
+    std::vector<int> rowLevels, rows, widths, heights;
+    levels.assign(count, std::vector<unsigned char>());
+    int width = image.width, height = image.height;
+    for (int l = 0; l < count; l++)
+    {
+        levels[l].resize(tex_compress_size(width, height, format));
+        widths.push_back(width);
+        heights.push_back(height);
+        for (int row = 0; row < (height + 3) / 4; row++)
+        {
+            rowLevels.push_back(l);
+            rows.push_back(row);
+        }
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+
+    this->_workers.ParallelFor((int)rows.size(), [&] (int i) {
+        auto l = rowLevels[i];
+        tex_compress_block_row(levels[l].data(), pixels[l].data(), widths[l], heights[l], image.component, format, rows[i]);
+    });
+    this->_compressedTextures[0]++;
+
+    if (!filename.empty() && !tex_cache_write(filename, format, levels))
+    {
+        std::cout << "WARN: could not write " << filename << std::endl;
+    }
+}
+
+// Texture object of a glTF texture, created on first use. Filtering and wrapping
+// live in a sampler object shared by all textures with the same glTF sampler values.
+GLuint GLScene::getTexture(int textureIndex, GLuint *sampler)
+{
+    if (textureIndex < 0 || textureIndex >= (int)this->_model.textures.size()) return 0;
+
+    auto& texture = this->_model.textures[textureIndex];
+    auto images = (int)this->_model.images.size();
+    if ((texture.source < 0 || texture.source >= images) && (texture.basisuSource < 0 || texture.basisuSource >= images)) return 0;
+
+    auto key = SamplerKey(this->_model, texture);
+
+    *sampler = 0;
+    if (this->_samplerObjects)
+    {
+        auto found = this->_samplers.find(key);
+        if (found == this->_samplers.end())
+        {
+            GLuint id = 0;
+            glGenSamplers(1, &id);
+            glSamplerParameteri(id, GL_TEXTURE_MIN_FILTER, key.minFilter);
+            glSamplerParameteri(id, GL_TEXTURE_MAG_FILTER, key.magFilter);
+            glSamplerParameteri(id, GL_TEXTURE_WRAP_S, key.wrapS);
+            glSamplerParameteri(id, GL_TEXTURE_WRAP_T, key.wrapT);
+            found = this->_samplers.insert(std::make_pair(key, id)).first;
+        }
+        *sampler = found->second;
+    }
+
+    auto found = this->_textures.find(textureIndex);
+    if (found != this->_textures.end()) return found->second;
+
+    GLuint id;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (!this->_samplerObjects)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, key.minFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, key.magFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, key.wrapS);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, key.wrapT);
+    }
+
+    // KHR_texture_basisu comes first, source is the fallback for what can not be read.
+    // Basis Universal payloads are not transcoded, so they always take the fallback.
+    bool uploaded = false;
+    if (texture.basisuSource >= 0 && texture.basisuSource < images) uploaded = uploadKtx2(this->_model.images[texture.basisuSource]);
+    if (!uploaded && texture.source >= 0 && texture.source < images)
+    {
+        auto& image = this->_model.images[texture.source];
+        uploaded = image.mimeType == "image/ktx2" ? uploadKtx2(image) : uploadImage(image);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (!uploaded)
+    {
+        glDeleteTextures(1, &id);
+        id = 0;
+    }
+    this->_textures[textureIndex] = id;
+    return id;
+}
+
+// Base color textures with the same size, format and sampler become layers of one
+// GL_TEXTURE_2D_ARRAY. Switching between their materials then only changes in_layer.
+void GLScene::buildTextureArrays()
+{
+    std::set<int> used;
+    for (auto& mesh : this->_model.meshes)
+    {
+        for (auto& primitive : mesh.primitives)
+        {
+            if (primitive.material >= 0) used.insert(BaseColorTexture(this->_model.materials[primitive.material]));
+        }
+    }
+
+    // KTX2 images keep their own textures, they are uploaded as stored
+    std::map<std::vector<int>, std::vector<int> > groups;
+    for (auto textureIndex : used)
+    {
+        if (textureIndex < 0 || textureIndex >= (int)this->_model.textures.size()) continue;
+
+        auto& texture = this->_model.textures[textureIndex];
+        if (texture.basisuSource >= 0 || texture.source < 0 || texture.source >= (int)this->_model.images.size()) continue;
+
+        auto& image = this->_model.images[texture.source];
+        if (image.image.empty() || (image.component != 3 && image.component != 4)) continue;
+
+        auto key = SamplerKey(this->_model, texture);
+        int blockFormat = (this->_flags & GLSCENE_COMPRESS_TEXTURES) ? BlockFormat(image) : 0;
+        std::vector<int> group = { image.width, image.height, image.component, blockFormat, key.minFilter, key.magFilter, key.wrapS, key.wrapT };
+        groups[group].push_back(textureIndex);
+    }
+
+    int arrays = 0, layers = 0;
+    for (auto& group : groups)
+    {
+        auto& members = group.second;
+        if (members.size() < 2) continue;
+
+        int width = group.first[0], height = group.first[1], components = group.first[2], blockFormat = group.first[3];
+        GLenum format = components == 3 ? GL_RGB : GL_RGBA;
+        GLenum internalFormat = components == 3 ? GL_RGB8 : GL_RGBA8;
+        GLenum compressedFormat = blockFormat == TEXCOMPRESS_BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        auto depth = (GLsizei)members.size();
+
+        GLuint id;
+        glGenTextures(1, &id);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if (!this->_samplerObjects)
+        {
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, group.first[4]);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, group.first[5]);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, group.first[6]);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, group.first[7]);
+        }
+
+        auto count = image_mip_count(width, height);
+        for (int l = 0, w = width, h = height; l < count; l++)
+        {
+            if (blockFormat != 0)
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, l, compressedFormat, w, h, depth, 0, (GLsizei)(tex_compress_size(w, h, blockFormat) * depth), NULL);
+            else
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, l, internalFormat, w, h, depth, 0, format, GL_UNSIGNED_BYTE, NULL);
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+        }
+
+        for (GLsizei layer = 0; layer < depth; layer++)
+        {
+            auto& image = this->_model.images[this->_model.textures[members[layer]].source];
+
+            std::vector<std::vector<unsigned char> > levels;
+            if (blockFormat != 0)
+                compressLevels(image, blockFormat, levels);
+            else
+                BuildMipLevels(image.image.data(), image.width, image.height, image.component, levels);
+
+            for (int l = 0, w = width, h = height; l < count; l++)
+            {
+                if (blockFormat != 0)
+                    glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, l, 0, 0, layer, w, h, 1, compressedFormat, (GLsizei)levels[l].size(), levels[l].data());
+                else
+                    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, l, 0, 0, layer, w, h, 1, format, GL_UNSIGNED_BYTE, levels[l].data());
+                w = w > 1 ? w / 2 : 1;
+                h = h > 1 ? h / 2 : 1;
+            }
+
+            this->_textures[members[layer]] = id;
+            this->_textureLayers[members[layer]] = (int)layer;
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, count - 1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        arrays++;
+        layers += (int)depth;
+    }
+
+    std::cout << "Packed " << layers << " of " << used.size() << " textures into " << arrays << " texture arrays" << std::endl;
+}
+
+// Uploads a decoded image and its mip chain to the bound texture
+bool GLScene::uploadImage(const tinygltf::Image& image)
+{
+    if (image.image.empty() || (image.component != 3 && image.component != 4)) return false;
+
+    // Ignore Texture.fomat.
+    GLenum format = GL_RGBA;
+    if (image.component == 3) format = GL_RGB;
+
+    // Every level is made here, so the result does not depend on the driver
+    std::vector<std::vector<unsigned char> > levels;
+    int blockFormat = 0;
+    if (this->_flags & GLSCENE_COMPRESS_TEXTURES)
+    {
+        blockFormat = BlockFormat(image);
+        compressLevels(image, blockFormat, levels);
+    }
+    else
+    {
+        BuildMipLevels(image.image.data(), image.width, image.height, image.component, levels);
+    }
+
+    GLenum compressedFormat = blockFormat == TEXCOMPRESS_BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    int width = image.width, height = image.height;
+    for (size_t l = 0; l < levels.size(); l++)
+    {
+        if (blockFormat != 0)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)l, compressedFormat, width, height, 0, (GLsizei)levels[l].size(), levels[l].data());
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, (GLint)l, format, width, height, 0, format, GL_UNSIGNED_BYTE, levels[l].data());
+        }
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+    return true;
+}
+
+// Uploads the levels of a KTX2 image to the bound texture as they are stored. Block
+// compressed levels the driver can not sample are decoded to RGBA8 on the workers.
+bool GLScene::uploadKtx2(const tinygltf::Image& image)
+{
+    auto data = image.image.data();
+    auto& label = image.name.empty() ? image.uri : image.name;
+    KTX2Info info;
+    if (image.mimeType != "image/ktx2" || !ktx2_read(data, image.image.size(), &info))
+    {
+        std::cout << "WARN: image " << label << " is not a 2D KTX2 texture" << std::endl;
+        return false;
+    }
+    if (info.vkFormat == KTX2_FORMAT_UNDEFINED || ktx2_level(data, info, 0) == NULL)
+    {
+        std::cout << "WARN: image " << label << " is Basis Universal or supercompressed, which is not transcoded" << std::endl;
+        return false;
+    }
+
+    GLenum format = 0, compressedFormat = 0;
+    int components = 0, blockFormat = 0;
+    switch (info.vkFormat)
+    {
+        case KTX2_FORMAT_R8G8B8_UNORM:
+        case KTX2_FORMAT_R8G8B8_SRGB:
+            format = GL_RGB;
+            components = 3;
+            break;
+        case KTX2_FORMAT_R8G8B8A8_UNORM:
+        case KTX2_FORMAT_R8G8B8A8_SRGB:
+            format = GL_RGBA;
+            components = 4;
+            break;
+        case KTX2_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case KTX2_FORMAT_BC1_RGB_SRGB_BLOCK:
+            compressedFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            blockFormat = TEXCOMPRESS_BC1;
+            break;
+        case KTX2_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case KTX2_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            compressedFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+            blockFormat = TEXCOMPRESS_BC1;
+            break;
+        case KTX2_FORMAT_BC3_UNORM_BLOCK:
+        case KTX2_FORMAT_BC3_SRGB_BLOCK:
+            compressedFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            blockFormat = TEXCOMPRESS_BC3;
+            break;
+        case KTX2_FORMAT_BC5_UNORM_BLOCK:
+            compressedFormat = GL_COMPRESSED_RG_RGTC2;  // core since OpenGL 3.0
+            blockFormat = TEXCOMPRESS_BC5;
+            break;
+        case KTX2_FORMAT_BC7_UNORM_BLOCK:
+        case KTX2_FORMAT_BC7_SRGB_BLOCK:
+            // There is no decoder for BC7, so it is uploaded or not used
+            if (this->_bptc) compressedFormat = GL_COMPRESSED_RGBA_BPTC_UNORM;
+            blockFormat = TEXCOMPRESS_BC3;  // same block size
+            break;
+    }
+    if (format == 0 && compressedFormat == 0)
+    {
+        std::cout << "WARN: image " << label << " has vkFormat " << info.vkFormat << ", which can not be uploaded" << std::endl;
+        return false;
+    }
+
+    // Only the S3TC formats are optional, RGTC is core and BC7 has no decoder
+    bool decode = !this->_s3tc && (compressedFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || compressedFormat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ||
+                                   compressedFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+    int width = info.width, height = info.height;
+    for (size_t l = 0; l < info.levels.size(); l++)
+    {
+        auto expected = blockFormat != 0 ? tex_compress_size(width, height, blockFormat) : (size_t)width * height * components;
+        if (info.levels[l].length != expected)
+        {
+            std::cout << "WARN: level " << l << " of image " << label << " has " << info.levels[l].length << " bytes, expected " << expected << std::endl;
+            return false;
+        }
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+
+    std::vector<std::vector<unsigned char> > decoded;
+    if (decode)
+    {
+        std::vector<int> rowLevels, rows;
+        decoded.resize(info.levels.size());
+        width = info.width, height = info.height;
+        for (size_t l = 0; l < info.levels.size(); l++)
+        {
+            decoded[l].resize((size_t)width * height * 4);
+            for (int row = 0; row < (height + 3) / 4; row++)
+            {
+                rowLevels.push_back((int)l);
+                rows.push_back(row);
+            }
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+        }
+
+        this->_workers.ParallelFor((int)rows.size(), [&] (int i) {
+            auto l = rowLevels[i];
+            int w = info.width >> l, h = info.height >> l;
+            tex_decompress_block_row(decoded[l].data(), ktx2_level(data, info, l), w > 1 ? w : 1, h > 1 ? h : 1, blockFormat, rows[i]);
+        });
+    }
+    else if (format != 0 && info.generateMips)
+    {
+        BuildMipLevels(ktx2_level(data, info, 0), info.width, info.height, components, decoded);
+    }
+
+    auto count = decoded.empty() ? info.levels.size() : decoded.size();
+    width = info.width, height = info.height;
+    for (size_t l = 0; l < count; l++)
+    {
+        auto level = decoded.empty() ? ktx2_level(data, info, (int)l) : decoded[l].data();
+        if (decode)
+        {
+            glTexImage2D(GL_TEXTURE_2D, (GLint)l, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, level);
+        }
+        else if (compressedFormat != 0)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)l, compressedFormat, width, height, 0, (GLsizei)info.levels[l].length, level);
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, (GLint)l, format, width, height, 0, format, GL_UNSIGNED_BYTE, level);
+        }
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)count - 1);
+    return true;
+}
+
+// Distance from p to the closest point of a box, 0 inside it
+static float GetBoxDistance(const float b[6], const float p[3])
+{
+    float d2 = 0.0f;
+    for (int k = 0; k < 3; k++)
+    {
+        auto d = p[k] < b[k] ? b[k] - p[k] : p[k] > b[k + 3] ? p[k] - b[k + 3] : 0.0f;
+        d2 += d * d;
+    }
+    return sqrtf(d2);
+}
+
+// Sorts the groups of the played animation into tiers with the bounds and visibility of
+// their subtree in the last Cull(). Tier 0 is sampled every frame. Tiers 1 and 2 sample
+// the pose a few frames ahead and blend towards it, tier 2 without optional channels.
+// Subtrees with nothing visible are frozen until they show again.
+void GLScene::planAnimation(int animation, float time)
+{
+    auto step = time - this->_animationTime;
+    if (step > 0.0f && step < 1.0f) this->_animationStep = step;
+    this->_animationTime = time;
+    if (animation != this->_lodAnimation)
+    {
+        for (auto& state : this->_subtreeAnimations) state.blending = false;
+        this->_lodAnimation = animation;
+    }
+
+    auto subtrees = this->_graph.SubtreeCount();
+    this->_subtreeBounds.resize(subtrees * 6);
+    for (int s = 0; s < subtrees; s++) aabb_empty(&this->_subtreeBounds[s * 6]);
+    this->_subtreeVisible.assign(subtrees, 0);
+    for (size_t i = 0; i < this->_drawItems.size(); i++)
+    {
+        if (this->_itemSubtrees[i] >= 0) aabb_merge(&this->_subtreeBounds[this->_itemSubtrees[i] * 6], &this->_worldBounds[i * 6]);
+    }
+    for (auto index : this->_visible)
+    {
+        if (this->_itemSubtrees[index] >= 0) this->_subtreeVisible[this->_itemSubtrees[index]] = 1;
+    }
+
+    memset(this->_stats.animated, 0, sizeof(this->_stats.animated));
+    this->_stats.blended = 0;
+    this->_stats.frozen = 0;
+    this->_stats.deferred = 0;
+
+    auto groups = this->_animation.GroupCount(animation);
+    this->_groupPlans.resize(groups);
+    this->_dueGroups.clear();
+    for (int g = 0; g < groups; g++)
+    {
+        auto node = this->_animation.GroupNode(animation, g);
+        auto subtree = node >= 0 && node < this->_graph.NodeCount() ? this->_graph.Subtree(node) : -1;
+        auto& plan = this->_groupPlans[g];
+        plan.action = 1;
+        plan.time = time;
+        plan.blend = -1.0f;
+        plan.all = true;
+
+        // Nodes outside the scene and subtrees without items, such as cameras, play as they are
+        auto bounds = subtree >= 0 ? &this->_subtreeBounds[subtree * 6] : NULL;
+        if (bounds == NULL || bounds[0] > bounds[3])
+        {
+            this->_stats.animated[0]++;
+            continue;
+        }
+
+        auto& state = this->_subtreeAnimations[subtree];
+        if (!this->_subtreeVisible[subtree])
+        {
+            plan.action = 0;
+            state.blending = false;
+            this->_stats.frozen++;
+            continue;
+        }
+
+        auto distance = GetBoxDistance(bounds, this->_cameraPosition);
+        auto tier = distance < this->_animationLodDistance ? 0 : distance < this->_animationLodDistance * 2.0f ? 1 : 2;
+        if (tier == 0)
+        {
+            state.blending = false;
+            this->_stats.animated[0]++;
+            continue;
+        }
+
+        plan.all = tier < 2;
+        auto blending = state.blending && state.all == plan.all && time >= state.from;
+        if (blending && time + this->_animationStep * 0.5f < state.to)
+        {
+            plan.action = 3;
+            plan.blend = std::min(1.0f, (time - state.from) / (state.to - state.from));
+            this->_stats.blended++;
+            continue;
+        }
+
+        // Lands on the pose it blended to, or starts from the current one, then samples the next one
+        plan.action = 2;
+        plan.time = time + this->_animationStep * this->_animationLodInterval * tier;
+        plan.blend = blending ? 1.0f : -1.0f;
+        this->_dueGroups.push_back(std::make_pair(blending ? time - state.to : FLT_MAX, g));
+    }
+
+    // Over the budget, the groups waiting longest go first and the others hold their pose
+    if (this->_animationBudget > 0 && (int)this->_dueGroups.size() > this->_animationBudget)
+    {
+        std::nth_element(this->_dueGroups.begin(), this->_dueGroups.begin() + this->_animationBudget, this->_dueGroups.end(),
+                         [] (const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first; });
+        for (size_t i = this->_animationBudget; i < this->_dueGroups.size(); i++)
+        {
+            auto& plan = this->_groupPlans[this->_dueGroups[i].second];
+            plan.action = plan.blend >= 0.0f ? 3 : 0;
+            this->_stats.deferred++;
+        }
+        this->_dueGroups.resize(this->_animationBudget);
+    }
+
+    for (auto& due : this->_dueGroups)
+    {
+        auto& plan = this->_groupPlans[due.second];
+        auto& state = this->_subtreeAnimations[this->_graph.Subtree(this->_animation.GroupNode(animation, due.second))];
+        state.from = time;
+        state.to = plan.time;
+        state.all = plan.all;
+        state.blending = true;
+        this->_stats.animated[plan.all ? 1 : 2]++;
+    }
+}
+
+// Channel groups write to different subtrees of the graph, they sample on the workers
+void GLScene::Animate(int animation, float time)
+{
+    if (animation < 0 || animation >= this->_animation.AnimationCount()) return;
+    if (animation == this->_vatAnimation) this->_vatFrame = (time - this->_animation.Start(animation)) * this->_vatFrameRate;
+
+    // Until the first Cull() there is no camera to measure from
+    if (!(this->_flags & GLSCENE_ANIMATION_LOD) || !this->_hasCamera)
+    {
+        this->_workers.ParallelFor(this->_animation.GroupCount(animation), [this, animation, time] (int group)
+        {
+            this->_animation.ApplyGroup(animation, group, time, this->_graph);
+        }, 4, "animation");
+        return;
+    }
+
+    planAnimation(animation, time);
+    this->_workers.ParallelFor(this->_animation.GroupCount(animation), [this, animation, time] (int group)
+    {
+        auto& plan = this->_groupPlans[group];
+        if (plan.action == 0) return;
+
+        if (plan.action == 1 || (plan.action == 2 && plan.blend < 0.0f))
+            this->_animation.ApplyGroup(animation, group, time, this->_graph, plan.all);
+        else
+            this->_animation.BlendGroup(animation, group, plan.blend, this->_graph, plan.all);
+        if (plan.action == 2) this->_animation.TargetGroup(animation, group, plan.time, this->_graph, plan.all);
+    }, 4, "animation");
+}
+
+void GLScene::Cull(const float projection[16], const float view[16])
+{
+    if (updateGraph())
+    {
+        // Skins and morphs are independent, the draw item bounds need both
+        auto skins = this->_workers.Submit([this] { updateSkins(false); }, std::vector<ThreadPoolTask>(), "skins");
+        auto morphs = this->_workers.Submit([this] { updateMorphs(false); }, std::vector<ThreadPoolTask>(), "morphs");
+        this->_workers.Wait(this->_workers.Submit([this] { updateDrawItems(false); }, { skins, morphs }, "draw items"));
+        this->_bvh.Refit(this->_worldBounds.data());
+    }
+
+    float viewProjection[16];
+    mat4_mul(viewProjection, projection, view);
+
+    Frustum frustum;
+    frustum_from_matrix(&frustum, viewProjection);
+
+    this->_visible.clear();
+    this->_stats.tested = this->_bvh.Cull(frustum, this->_worldBounds.data(), this->_visible);
+    this->_stats.visible = (int)this->_visible.size();
+    this->_stats.culled = (int)this->_drawItems.size() - this->_stats.visible;
+
+    // Keep the scene order so state changes between draws stay the same as without culling
+    std::sort(this->_visible.begin(), this->_visible.end());
+
+    this->_stats.occluded = 0;
+    if (this->_flags & GLSCENE_OCCLUSION_CULLING) cullOccluded(viewProjection, projection, view);
+
+    if (!this->_lodChains.empty()) selectLods(projection, view);
+
+    memcpy(this->_cullProjection, projection, sizeof(this->_cullProjection));
+    memcpy(this->_cullView, view, sizeof(this->_cullView));
+
+    // The next Animate() measures from here
+    float camera[16];
+    mat4_inverse_affine(camera, view);
+    memcpy(this->_cameraPosition, &camera[12], sizeof(this->_cameraPosition));
+    this->_hasCamera = true;
+}
+
+// Diameter of the bounding sphere of a world space box in normalized device coordinates
+static float GetProjectedSize(const float b[6], const float projection[16], const float view[16])
+{
+    auto viewScale = sqrtf(view[0] * view[0] + view[1] * view[1] + view[2] * view[2]);
+
+    float center[3] = { (b[0] + b[3]) * 0.5f, (b[1] + b[4]) * 0.5f, (b[2] + b[5]) * 0.5f };
+    float dx = b[3] - b[0], dy = b[4] - b[1], dz = b[5] - b[2];
+    auto radius = 0.5f * sqrtf(dx * dx + dy * dy + dz * dz) * viewScale;
+
+    float c[3];
+    for (int k = 0; k < 3; k++) c[k] = view[k] * center[0] + view[4 + k] * center[1] + view[8 + k] * center[2] + view[12 + k];
+    auto distance = sqrtf(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+
+    return distance > radius ? 2.0f * radius * projection[5] / distance : FLT_MAX;
+}
+
+const GLScene::GLOccluderMesh& GLScene::occluderMesh(int meshIndex, int primitiveIndex)
+{
+    auto key = std::make_pair(meshIndex, primitiveIndex);
+    auto found = this->_occluderMeshes.find(key);
+    if (found != this->_occluderMeshes.end()) return found->second;
+
+    auto& mesh = this->_occluderMeshes[key];
+    auto& primitive = this->_model.meshes[meshIndex].primitives[primitiveIndex];
+    if (primitive.mode != TINYGLTF_MODE_TRIANGLES) return mesh;
+
+    // Cut out or see-through surfaces do not hide what is behind them
+    if (primitive.material >= 0)
+    {
+        auto& material = this->_model.materials[primitive.material];
+        auto alphaMode = material.additionalValues.find("alphaMode");
+        if (alphaMode != material.additionalValues.end() && alphaMode->second.string_value != "OPAQUE") return mesh;
+    }
+
+    auto& positionAccessor = this->_model.accessors[primitive.attributes.find("POSITION")->second];
+    if (positionAccessor.type != TINYGLTF_TYPE_VEC3 ||
+        !accessor_read_floats(this->_model, positionAccessor, positionAccessor.normalized, mesh.positions) ||
+        !accessor_read_indices(this->_model, this->_model.accessors[primitive.indices], mesh.indices))
+    {
+        mesh.positions.clear();
+        mesh.indices.clear();
+        return mesh;
+    }
+
+    for (auto index : mesh.indices)
+    {
+        if (index >= positionAccessor.count)
+        {
+            mesh.positions.clear();
+            mesh.indices.clear();
+            break;
+        }
+    }
+    return mesh;
+}
+
+void GLScene::cullOccluded(const float viewProjection[16], const float projection[16], const float view[16])
+{
+    // Items that are small on screen hide little, only the largest ones are drawn as occluders
+    const float minimumSize = 0.1f;
+
+    this->_occluders.clear();
+    for (auto index : this->_visible)
+    {
+        auto& item = this->_drawItems[index];
+        if (item.instanceCount > 0 || item.skin >= 0 || item.morph >= 0) continue;
+
+        auto size = GetProjectedSize(&this->_worldBounds[index * 6], projection, view);
+        if (size < minimumSize || occluderMesh(item.mesh, item.primitive).indices.empty()) continue;
+
+        this->_occluders.push_back(std::make_pair(-size, index));
+    }
+
+    auto count = std::min((int)this->_occluders.size(), this->_maxOccluders);
+    std::partial_sort(this->_occluders.begin(), this->_occluders.begin() + count, this->_occluders.end());
+    this->_occluders.resize(count);
+
+    this->_occlusion.Clear(viewProjection);
+    for (auto& occluder : this->_occluders)
+    {
+        auto& item = this->_drawItems[occluder.second];
+        auto& mesh = occluderMesh(item.mesh, item.primitive);
+        this->_occlusion.RenderTriangles(mesh.positions.data(), mesh.indices.data(), mesh.indices.size(), this->_graph.World(item.node));
+    }
+    this->_occlusion.Finish();
+
+    // The occluders themselves are kept, their own depth can be in front of their box
+    size_t write = 0;
+    for (auto index : this->_visible)
+    {
+        bool occluder = false;
+        for (auto& o : this->_occluders) occluder = occluder || o.second == index;
+
+        if (occluder || this->_occlusion.TestAabb(&this->_worldBounds[index * 6]))
+            this->_visible[write++] = index;
+    }
+
+    this->_stats.occluded = (int)(this->_visible.size() - write);
+    this->_stats.visible = (int)write;
+    this->_visible.resize(write);
+}
+
+void GLScene::selectLods(const float projection[16], const float view[16])
+{
+    // A level is good enough when its error, projected the same way as the item's
+    // bounding sphere, stays below the threshold. Switching needs a margin on
+    // either side of it so items at the boundary do not flicker between levels.
+    const float hysteresis = 0.25f;
+
+    for (auto index : this->_visible)
+    {
+        auto chainIndex = this->_itemLodChains[index];
+        if (chainIndex < 0) continue;
+
+        auto size = GetProjectedSize(&this->_worldBounds[index * 6], projection, view);
+
+        auto& chain = this->_lodChains[chainIndex];
+        int finer = 0, coarser = 0;
+        while (finer < (int)chain.size() && chain[finer].error * size <= this->_lodThreshold * (1.0f + hysteresis)) finer++;
+        while (coarser < (int)chain.size() && chain[coarser].error * size <= this->_lodThreshold * (1.0f - hysteresis)) coarser++;
+
+        int level = this->_itemLods[index];
+        if (level > finer) level = finer;
+        else if (level < coarser) level = coarser;
+
+        this->_itemLods[index] = (unsigned char)level;
+        if (this->_itemSlots[index] >= 0) this->_slotLods[this->_itemSlots[index]] = (unsigned char)level;
+    }
+}
+
+static GLenum GetDrawMode(int mode)
+{
+    if (mode == TINYGLTF_MODE_TRIANGLES) return GL_TRIANGLES;
+    else if (mode == TINYGLTF_MODE_TRIANGLE_STRIP) return GL_TRIANGLE_STRIP;
+    else if (mode == TINYGLTF_MODE_TRIANGLE_FAN) return GL_TRIANGLE_FAN;
+    else if (mode == TINYGLTF_MODE_POINTS) return GL_POINTS;
+    else if (mode == TINYGLTF_MODE_LINE) return GL_LINES;
+    else if (mode == TINYGLTF_MODE_LINE_LOOP) return GL_LINE_LOOP;
+    return GL_TRIANGLES;
+}
+
+void GLScene::bindArena(int arena)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, this->_arenas[arena].vb);
+    for (auto& stream : this->_arenas[arena].streams)
+    {
+        auto attr = this->_attribs[stream.name];
+        if (attr >= 0)
+        {
+            glVertexAttribPointer(attr, stream.components, stream.componentType, stream.normalized, this->_arenas[arena].stride, BUFFER_OFFSET(stream.offset));
+            glEnableVertexAttribArray(attr);
+        }
+    }
+    if (this->_indexArena != 0) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->_indexArena);
+}
+
+// Forgets what is bound, for when other code may have bound textures since
+void GLScene::resetBindings()
+{
+    for (int unit = 0; unit < 2; unit++)
+    {
+        this->_boundTextures[unit] = ~0u;
+        this->_boundSamplers[unit] = ~0u;
+    }
+}
+
+// 2D textures go to unit 0 and arrays to unit 1, binding only what changed
+void GLScene::bindDiffuse(GLuint texture, GLuint sampler, bool array)
+{
+    int unit = array ? 1 : 0;
+    if (this->_boundTextures[unit] != texture)
+    {
+        if (array) glActiveTexture(GL_TEXTURE1);
+        glBindTexture(array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, texture);
+        if (array) glActiveTexture(GL_TEXTURE0);
+        this->_boundTextures[unit] = texture;
+        this->_stats.textureBinds++;
+    }
+    if (!this->_samplers.empty() && this->_boundSamplers[unit] != sampler)
+    {
+        glBindSampler(unit, sampler);
+        this->_boundSamplers[unit] = sampler;
+    }
+}
+
+void GLScene::bindPrimitive(int meshIndex, int primitiveIndex)
+{
+    auto& mesh = this->_model.meshes[meshIndex];
+    auto& primitive = mesh.primitives[primitiveIndex];
+
+    float layer = -1.0f;
+    if (primitive.material >= 0)
+    {
+        auto& state = this->_meshStates[mesh.name];
+        auto found = state.diffuseLayer.find(primitive.material);
+        if (found != state.diffuseLayer.end() && found->second >= 0) layer = (float)found->second;
+        bindDiffuse(state.diffuseTex[primitive.material], state.diffuseSampler[primitive.material], layer >= 0.0f);
+    }
+    if (this->_layerAttrib >= 0) glVertexAttrib1f(this->_layerAttrib, layer);
+
+    // Merged arenas hold the indices too, interleaved copies of the attributes keep
+    // the indices in their bufferView. Primitives outside arenas use their bufferViews.
+    auto found = this->_arenaRanges.find(std::make_pair(meshIndex, primitiveIndex));
+    if (found != this->_arenaRanges.end())
+    {
+        bindArena(found->second.arena);
+        if (this->_flags & GLSCENE_MERGED_BUFFERS) return;
+    }
+
+    for (auto it : primitive.attributes)
+    {
+        if (it.second < 0 || found != this->_arenaRanges.end()) continue;
+
+        auto accessor = this->_model.accessors[it.second];
+        glBindBuffer(GL_ARRAY_BUFFER, this->_buffers[accessor.bufferView].vb);
+
+        int count = 1;
+        if (accessor.type == TINYGLTF_TYPE_SCALAR) count = 1;
+        else if (accessor.type == TINYGLTF_TYPE_VEC2) count = 2;
+        else if (accessor.type == TINYGLTF_TYPE_VEC3) count = 3;
+        else if (accessor.type == TINYGLTF_TYPE_VEC4) count = 4;
+        else assert(0);
+
+        if (this->_attribs.count(it.first) != 0)
+        {
+            auto attr = this->_attribs[it.first];
+            if (attr >= 0)
+            {
+                // Quantized and interleaved attributes need the stride of the view
+                auto stride = (GLsizei)this->_model.bufferViews[accessor.bufferView].byteStride;
+                auto offset = accessor.byteOffset - this->_buffers[accessor.bufferView].first;
+                glVertexAttribPointer(attr, count, accessor.componentType, accessor.normalized ? GL_TRUE : GL_FALSE, stride, BUFFER_OFFSET(offset));
+                glEnableVertexAttribArray(attr);
+            }
+        }
+    }
+
+    auto& indexAccessor = this->_model.accessors[primitive.indices];
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->_buffers[indexAccessor.bufferView].vb);
+}
+
+void GLScene::unbindPrimitive(const tinygltf::Primitive& primitive)
+{
+    for (auto it : primitive.attributes)
+    {
+        if (this->_attribs.count(it.first) != 0)
+        {
+            auto attr = this->_attribs[it.first];
+            if (attr >= 0) glDisableVertexAttribArray(attr);
+        }
+    }
+}
+
+void GLScene::drawElements(int meshIndex, int primitiveIndex, GLsizei instanceCount, int lod)
+{
+    auto& primitive = this->_model.meshes[meshIndex].primitives[primitiveIndex];
+
+    const GLLod *level = NULL;
+    if (lod > 0)
+    {
+        auto chain = this->_primitiveLods.find(std::make_pair(meshIndex, primitiveIndex));
+        if (chain != this->_primitiveLods.end() && lod <= (int)this->_lodChains[chain->second].size()) level = &this->_lodChains[chain->second][lod - 1];
+    }
+
+    GLsizei count = 0;
+    auto found = (this->_flags & GLSCENE_MERGED_BUFFERS) ? this->_arenaRanges.find(std::make_pair(meshIndex, primitiveIndex)) : this->_arenaRanges.end();
+    if (found != this->_arenaRanges.end())
+    {
+        auto& range = found->second;
+        count = level != NULL ? level->count : range.count;
+        auto first = level != NULL ? level->firstIndex : range.firstIndex;
+        glDrawElementsInstancedBaseVertex(GetDrawMode(primitive.mode), count, GL_UNSIGNED_INT, BUFFER_OFFSET(first * sizeof(unsigned int)), instanceCount, range.baseVertex);
+    }
+    else if (level != NULL && level->ib != 0)
+    {
+        count = level->count;
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, level->ib);
+        glDrawElementsInstanced(GetDrawMode(primitive.mode), count, GL_UNSIGNED_INT, BUFFER_OFFSET(0), instanceCount);
+    }
+    else
+    {
+        auto& indexAccessor = this->_model.accessors[primitive.indices];
+        count = (GLsizei)indexAccessor.count;
+        auto& state = this->_buffers[indexAccessor.bufferView];
+
+        // A level of detail may have replaced the element buffer of this primitive
+        if (!this->_lodChains.empty()) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, state.vb);
+
+        auto offset = indexAccessor.byteOffset - state.first;
+        if (instanceCount == 1)
+            glDrawElements(GetDrawMode(primitive.mode), indexAccessor.count, indexAccessor.componentType, BUFFER_OFFSET(offset));
+        else
+            glDrawElementsInstanced(GetDrawMode(primitive.mode), indexAccessor.count, indexAccessor.componentType, BUFFER_OFFSET(offset), instanceCount);
+    }
+    this->_stats.drawCalls++;
+    this->_stats.triangles += count / 3 * instanceCount;
+}
+
+// Without instance arrays bound the shader reads these constant values instead
+void GLScene::setConstantInstance(const float *model)
+{
+    if (this->_modelAttrib >= 0)
+    {
+        float identity[16];
+        mat4_identity(identity);
+        if (model == NULL) model = identity;
+        for (int c = 0; c < 4; c++) glVertexAttrib4fv(this->_modelAttrib + c, model + c * 4);
+    }
+
+    if (this->_instanceAttribs["TRANSLATION"] >= 0) glVertexAttrib3f(this->_instanceAttribs["TRANSLATION"], 0.0f, 0.0f, 0.0f);
+    if (this->_instanceAttribs["ROTATION"] >= 0) glVertexAttrib4f(this->_instanceAttribs["ROTATION"], 0.0f, 0.0f, 0.0f, 1.0f);
+    if (this->_instanceAttribs["SCALE"] >= 0) glVertexAttrib3f(this->_instanceAttribs["SCALE"], 1.0f, 1.0f, 1.0f);
+}
+
+void GLScene::drawInstancingExtension(const GLDrawItem& item, const float *world)
+{
+    auto& node = this->_model.nodes[item.node];
+    auto& mesh = this->_model.meshes[item.mesh];
+    auto& primitive = mesh.primitives[item.primitive];
+
+    if (this->_modelAttrib >= 0)
+    {
+        setConstantInstance(world);
+    }
+    else
+    {
+        setConstantInstance(NULL);
+        glPushMatrix();
+        glMultMatrixf(world);
+    }
+
+    bindPrimitive(item.mesh, item.primitive);
+
+    // The instance accessors are bound as they are, straight from the glTF buffers
+    std::vector<GLint> enabled;
+    for (auto it : node.instanceAttributes)
+    {
+        auto found = this->_instanceAttribs.find(it.first);
+        if (found == this->_instanceAttribs.end() || found->second < 0) continue;
+
+        auto& accessor = this->_model.accessors[it.second];
+        auto& view = this->_model.bufferViews[accessor.bufferView];
+        GLboolean normalized = accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT ? GL_TRUE : GL_FALSE;
+
+        auto& state = this->_buffers[accessor.bufferView];
+        glBindBuffer(GL_ARRAY_BUFFER, state.vb);
+        glVertexAttribPointer(found->second, accessor_component_count(accessor.type), accessor.componentType, normalized, (GLsizei)view.byteStride, BUFFER_OFFSET(accessor.byteOffset - state.first));
+        glVertexAttribDivisor(found->second, 1);
+        glEnableVertexAttribArray(found->second);
+        enabled.push_back(found->second);
+    }
+
+    drawElements(item.mesh, item.primitive, item.instanceCount, 0);
+
+    for (auto attr : enabled)
+    {
+        glVertexAttribDivisor(attr, 0);
+        glDisableVertexAttribArray(attr);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    unbindPrimitive(primitive);
+
+    if (this->_modelAttrib < 0) glPopMatrix();
+    setConstantInstance(NULL);
+}
+
+void GLScene::DrawPrimitive(int meshIndex, int primitiveIndex, int lod)
+{
+    resetBindings();
+    drawPrimitive(meshIndex, primitiveIndex, lod);
+}
+
+void GLScene::drawPrimitive(int meshIndex, int primitiveIndex, int lod)
+{
+    auto& mesh = this->_model.meshes[meshIndex];
+    auto& primitive = mesh.primitives[primitiveIndex];
+
+    if (primitive.indices < 0) return;
+
+    setConstantInstance(NULL);
+
+    bindPrimitive(meshIndex, primitiveIndex);
+    drawElements(meshIndex, primitiveIndex, 1, lod);
+    unbindPrimitive(primitive);
+}
+
+void GLScene::DrawMesh(int index)
+{
+    resetBindings();
+
+    auto& mesh = this->_model.meshes[index];
+    for (size_t i = 0; i < mesh.primitives.size(); i++)
+    {
+        drawPrimitive(index, (int)i, 0);
+    }
+}
+
+// Every run of consecutive visible slots in a batch is one instanced draw. With unmerged
+// only batches that drawIndirect() has no bucket for are drawn, from their bufferViews.
+void GLScene::drawRuns(const GLFramePacket& frame, bool unmerged)
+{
+    int boundBatch = -1;
+    for (size_t i = 0; i < this->_visibleSlots.size();)
+    {
+        auto first = this->_visibleSlots[i];
+        auto batchIndex = this->_slotBatches[first];
+        size_t end = i + 1;
+        while (end < this->_visibleSlots.size() && this->_visibleSlots[end] == this->_visibleSlots[end - 1] + 1 &&
+               this->_slotBatches[this->_visibleSlots[end]] == batchIndex && frame.slotLods[this->_visibleSlots[end]] == frame.slotLods[first]) end++;
+
+        if (unmerged && this->_batchBuckets[batchIndex] >= 0)
+        {
+            i = end;
+            continue;
+        }
+
+        auto& batch = this->_batches[batchIndex];
+        if (batchIndex != boundBatch)
+        {
+            if (boundBatch >= 0) unbindPrimitive(this->_model.meshes[this->_batches[boundBatch].mesh].primitives[this->_batches[boundBatch].primitive]);
+            bindPrimitive(batch.mesh, batch.primitive);
+            boundBatch = batchIndex;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, this->_instanceBuffer);
+        for (int c = 0; c < 4; c++)
+        {
+            glVertexAttribPointer(this->_modelAttrib + c, 4, GL_FLOAT, GL_FALSE, sizeof(float) * 16, BUFFER_OFFSET((first * 16 + c * 4) * sizeof(float)));
+        }
+
+        drawElements(batch.mesh, batch.primitive, (GLsizei)(end - i), frame.slotLods[first]);
+
+        i = end;
+    }
+
+    if (boundBatch >= 0) unbindPrimitive(this->_model.meshes[this->_batches[boundBatch].mesh].primitives[this->_batches[boundBatch].primitive]);
+}
+
+void GLScene::drawIndirect(const GLFramePacket& frame)
+{
+    // Same runs as drawRuns(), but each run becomes a command. baseInstance points
+    // in_model at the first slot of the run, so the attribute pointers stay put.
+    this->_commands.clear();
+    this->_commandBuckets.clear();
+    for (size_t i = 0; i < this->_visibleSlots.size();)
+    {
+        auto first = this->_visibleSlots[i];
+        auto batchIndex = this->_slotBatches[first];
+        size_t end = i + 1;
+        while (end < this->_visibleSlots.size() && this->_visibleSlots[end] == this->_visibleSlots[end - 1] + 1 &&
+               this->_slotBatches[this->_visibleSlots[end]] == batchIndex && frame.slotLods[this->_visibleSlots[end]] == frame.slotLods[first]) end++;
+
+        if (this->_batchBuckets[batchIndex] >= 0)
+        {
+            auto command = this->_batchCommands[batchIndex];
+            command.instanceCount = (GLuint)(end - i);
+            command.baseInstance = (GLuint)first;
+
+            auto lod = frame.slotLods[first];
+            if (lod > 0 && this->_batchLodChains[batchIndex] >= 0)
+            {
+                auto& level = this->_lodChains[this->_batchLodChains[batchIndex]][lod - 1];
+                command.count = (GLuint)level.count;
+                command.firstIndex = level.firstIndex;
+            }
+            this->_commands.push_back(command);
+            this->_commandBuckets.push_back(this->_batchBuckets[batchIndex]);
+        }
+
+        i = end;
+    }
+    if (this->_commands.empty()) return;
+
+    // Counting sort on bucket, each bucket is then one contiguous range of commands
+    this->_bucketOffsets.assign(this->_buckets.size() + 1, 0);
+    for (auto bucket : this->_commandBuckets) this->_bucketOffsets[bucket + 1]++;
+    for (size_t b = 1; b < this->_bucketOffsets.size(); b++) this->_bucketOffsets[b] += this->_bucketOffsets[b - 1];
+
+    this->_bucketCommands.resize(this->_commands.size());
+    for (size_t i = 0; i < this->_commands.size(); i++) this->_bucketCommands[this->_bucketOffsets[this->_commandBuckets[i]]++] = this->_commands[i];
+    for (size_t b = this->_bucketOffsets.size() - 1; b > 0; b--) this->_bucketOffsets[b] = this->_bucketOffsets[b - 1];
+    this->_bucketOffsets[0] = 0;
+
+    auto size = this->_bucketCommands.size() * sizeof(GLDrawCommand);
+    GLintptr offset = 0;
+    auto data = this->_stream.Allocate(size, sizeof(GLuint), &offset);
+    if (data != NULL)
+    {
+        memcpy(data, this->_bucketCommands.data(), size);
+        this->_stream.Flush();
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->_stream.Buffer());
+    }
+    else
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->_indirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, size, this->_bucketCommands.data(), GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, this->_instanceBuffer);
+    for (int c = 0; c < 4; c++)
+    {
+        glVertexAttribPointer(this->_modelAttrib + c, 4, GL_FLOAT, GL_FALSE, sizeof(float) * 16, BUFFER_OFFSET(c * 4 * sizeof(float)));
+    }
+    if (this->_layerBuffer != 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, this->_layerBuffer);
+        glVertexAttribPointer(this->_layerAttrib, 1, GL_FLOAT, GL_FALSE, sizeof(float), BUFFER_OFFSET(0));
+        glVertexAttribDivisor(this->_layerAttrib, 1);
+        glEnableVertexAttribArray(this->_layerAttrib);
+    }
+    else if (this->_layerAttrib >= 0)
+    {
+        glVertexAttrib1f(this->_layerAttrib, -1.0f);
+    }
+
+    int boundArena = -1;
+    for (size_t b = 0; b < this->_buckets.size(); b++)
+    {
+        auto count = this->_bucketOffsets[b + 1] - this->_bucketOffsets[b];
+        if (count == 0) continue;
+
+        auto& bucket = this->_buckets[b];
+        if (bucket.texture != 0) bindDiffuse(bucket.texture, bucket.sampler, bucket.array);
+        if (bucket.arena != boundArena)
+        {
+            bindArena(bucket.arena);
+            boundArena = bucket.arena;
+        }
+
+        glMultiDrawElementsIndirect(GetDrawMode(bucket.mode), GL_UNSIGNED_INT, BUFFER_OFFSET(offset + this->_bucketOffsets[b] * sizeof(GLDrawCommand)), count, 0);
+        this->_stats.drawCalls++;
+        for (int k = this->_bucketOffsets[b]; k < this->_bucketOffsets[b + 1]; k++)
+            this->_stats.triangles += this->_bucketCommands[k].count / 3 * this->_bucketCommands[k].instanceCount;
+    }
+
+    for (auto& attrib : this->_attribs)
+    {
+        if (attrib.second >= 0) glDisableVertexAttribArray(attrib.second);
+    }
+    if (this->_layerBuffer != 0)
+    {
+        glVertexAttribDivisor(this->_layerAttrib, 0);
+        glDisableVertexAttribArray(this->_layerAttrib);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+// Adds weight times the deltas of the vertices a target moves. Positions and normals
+// are 4 floats per vertex, the deltas of a moved vertex are its position and normal.
+static void MorphAccumulate(float *positions, float *normals, const unsigned int *moved, const float *deltas, size_t count, float weight)
+{
+    auto stride = normals != NULL ? 8 : 4;
+#ifdef GLMATH_SSE
+    auto w = _mm_set1_ps(weight);
+    for (size_t i = 0; i < count; i++)
+    {
+        auto p = positions + (size_t)moved[i] * 4;
+        _mm_storeu_ps(p, _mm_add_ps(_mm_loadu_ps(p), _mm_mul_ps(w, _mm_loadu_ps(deltas + i * stride))));
+        if (normals == NULL) continue;
+
+        auto n = normals + (size_t)moved[i] * 4;
+        _mm_storeu_ps(n, _mm_add_ps(_mm_loadu_ps(n), _mm_mul_ps(w, _mm_loadu_ps(deltas + i * stride + 4))));
+    }
+#else
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int k = 0; k < 4; k++) positions[(size_t)moved[i] * 4 + k] += weight * deltas[i * stride + k];
+        if (normals == NULL) continue;
+
+        for (int k = 0; k < 4; k++) normals[(size_t)moved[i] * 4 + k] += weight * deltas[i * stride + 4 + k];
+    }
+#endif
+}
+
+// Skinned items morph on the cpu, the skinned program has no targets
+bool GLScene::morphOnGpu(const GLFramePacket& frame, const GLDrawItem& item) const
+{
+    return item.morph >= 0 && this->_morphProgram != 0 && item.skin < 0 && (int)frame.morphs[item.morph].size() <= this->_morphSlots;
+}
+
+// Visible items that morph on the cpu and whose weights changed are blended from the
+// base vertices and the vertices each active target moves, then copied to _morphBuffer.
+// Weights that changed while an item was hidden are blended once it shows.
+void GLScene::blendMorphs(const GLFramePacket& frame)
+{
+    this->_morphStale.resize(this->_morphs.size(), 1);
+    for (size_t m = 0; m < frame.morphsChanged.size(); m++) this->_morphStale[m] |= frame.morphsChanged[m];
+
+    bool bound = false;
+    for (auto v : this->_visibleDeformed)
+    {
+        auto& item = this->_drawItems[frame.visible[v]];
+        if (item.morph < 0) continue;
+
+        auto& morph = this->_morphs[item.morph];
+        if (!this->_morphStale[item.morph] || frame.morphs[item.morph].empty() || morphOnGpu(frame, item)) continue;
+
+        auto& targets = this->_morphTargets[morph.targets];
+        this->_morphScratch.assign(targets.base.begin(), targets.base.end());
+        auto positions = this->_morphScratch.data();
+        auto normals = targets.normals ? positions + targets.vertexCount * 4 : NULL;
+        for (auto& active : frame.morphs[item.morph])
+        {
+            auto first = targets.firstMoved[active.first];
+            MorphAccumulate(positions, normals, targets.moved.data() + first, targets.deltas.data() + first * (normals != NULL ? 8 : 4),
+                            targets.firstMoved[active.first + 1] - first, active.second);
+        }
+
+        if (!bound)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, this->_morphBuffer);
+            glBindBuffer(GL_COPY_READ_BUFFER, this->_stream.Buffer());
+            bound = true;
+        }
+
+        auto size = this->_morphScratch.size() * sizeof(float);
+        GLintptr offset = 0;
+        auto data = this->_stream.Allocate(size, 16, &offset);
+        if (data != NULL)
+        {
+            memcpy(data, this->_morphScratch.data(), size);
+            this->_stream.Flush();
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER, offset, morph.bufferOffset, size);
+        }
+        else
+        {
+            glBufferSubData(GL_ARRAY_BUFFER, morph.bufferOffset, size, this->_morphScratch.data());
+        }
+        this->_morphStale[item.morph] = 0;
+    }
+
+    if (bound)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+// After bindPrimitive(), hands the active targets to the morph program, or points
+// POSITION and NORMAL at the vertices blended on the cpu
+void GLScene::bindMorph(const GLMorph& morph, const std::vector<std::pair<int, float> >& active, bool gpu)
+{
+    auto& targets = this->_morphTargets[morph.targets];
+    if (gpu)
+    {
+        GLint offsets[64];
+        float weights[64];
+        auto count = (int)active.size();
+        auto texels = (GLint)(targets.vertexCount * (targets.normals ? 2 : 1));
+        for (int i = 0; i < count; i++)
+        {
+            offsets[i] = targets.firstTexel + active[i].first * texels;
+            weights[i] = active[i].second;
+        }
+
+        glUniform1i(this->_morphUniforms["morphCount"], count);
+        glUniform1iv(this->_morphUniforms["morphOffsets"], count, offsets);
+        glUniform1fv(this->_morphUniforms["morphWeights"], count, weights);
+        glUniform1i(this->_morphUniforms["morphNormals"], targets.normals ? (GLint)targets.vertexCount : 0);
+        return;
+    }
+
+    auto position = this->_attribs["POSITION"], normal = this->_attribs["NORMAL"];
+    glBindBuffer(GL_ARRAY_BUFFER, this->_morphBuffer);
+    if (position >= 0)
+    {
+        glVertexAttribPointer(position, 4, GL_FLOAT, GL_FALSE, sizeof(float) * 4, BUFFER_OFFSET(morph.bufferOffset));
+        glEnableVertexAttribArray(position);
+    }
+    if (normal >= 0 && targets.normals)
+    {
+        glVertexAttribPointer(normal, 4, GL_FLOAT, GL_FALSE, sizeof(float) * 4, BUFFER_OFFSET(morph.bufferOffset + targets.vertexCount * sizeof(float) * 4));
+        glEnableVertexAttribArray(normal);
+    }
+}
+
+void GLScene::drawDeformed(const GLFramePacket& frame)
+{
+    this->_visibleDeformed.clear();
+    for (size_t v = 0; v < frame.visible.size(); v++)
+    {
+        auto& item = this->_drawItems[frame.visible[v]];
+        if ((item.skin >= 0 || item.morph >= 0) && item.vat < 0) this->_visibleDeformed.push_back((int)v);
+    }
+    if (this->_visibleDeformed.empty()) return;
+
+    // The palettes of all skins go up in one piece, draws bind their range of it
+    GLuint buffer = 0;
+    GLintptr base = 0;
+    if (this->_skinProgram != 0)
+    {
+        auto data = (unsigned char *)this->_stream.Allocate(this->_paletteSize, this->_paletteAlignment, &base);
+        auto staged = data == NULL;
+        if (staged)
+        {
+            this->_palettes.resize(this->_paletteSize);
+            data = this->_palettes.data();
+        }
+        for (auto& skin : this->_skins)
+        {
+            if (skin.paletteOffset >= 0) memcpy(data + skin.paletteOffset, &frame.jointMatrices[skin.firstJoint * 16], skin.jointCount * sizeof(float) * 16);
+        }
+
+        if (staged)
+        {
+            if (this->_paletteBuffer == 0) glGenBuffers(1, &this->_paletteBuffer);
+            glBindBuffer(GL_UNIFORM_BUFFER, this->_paletteBuffer);
+            glBufferData(GL_UNIFORM_BUFFER, this->_paletteSize, data, GL_STREAM_DRAW);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            buffer = this->_paletteBuffer;
+            base = 0;
+        }
+        else
+        {
+            this->_stream.Flush();
+            buffer = this->_stream.Buffer();
+        }
+    }
+
+    blendMorphs(frame);
+    if (this->_morphTexture != 0)
+    {
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_BUFFER, this->_morphTexture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // Skinned items without a palette are drawn in their bind pose, which ignores the node
+    // transform like skinning does. Items without active targets need no morphing.
+    GLuint current = this->_program;
+    int boundSkin = -1;
+    for (auto v : this->_visibleDeformed)
+    {
+        auto index = frame.visible[v];
+        auto& item = this->_drawItems[index];
+        auto skinned = item.skin >= 0 && this->_skinProgram != 0 && this->_skins[item.skin].paletteOffset >= 0;
+        auto morphed = item.morph >= 0 && !frame.morphs[item.morph].empty();
+        auto gpu = morphed && morphOnGpu(frame, item);
+
+        auto program = skinned ? this->_skinProgram : gpu ? this->_morphProgram : this->_program;
+        if (program != current) glUseProgram(program);
+        current = program;
+        if (skinned && boundSkin != item.skin)
+        {
+            glBindBufferRange(GL_UNIFORM_BUFFER, 0, buffer, base + this->_skins[item.skin].paletteOffset, this->_paletteBlockSize);
+            boundSkin = item.skin;
+        }
+
+        const float *world = item.skin >= 0 ? NULL : &frame.worlds[v * 16];
+        if (this->_modelAttrib >= 0)
+        {
+            setConstantInstance(world);
+        }
+        else if (world != NULL)
+        {
+            glPushMatrix();
+            glMultMatrixf(world);
+        }
+
+        bindPrimitive(item.mesh, item.primitive);
+        if (morphed) bindMorph(this->_morphs[item.morph], frame.morphs[item.morph], gpu);
+        drawElements(item.mesh, item.primitive, 1, frame.itemLods[index]);
+        unbindPrimitive(this->_model.meshes[item.mesh].primitives[item.primitive]);
+
+        if (this->_modelAttrib < 0 && world != NULL) glPopMatrix();
+    }
+    if (current != this->_program) glUseProgram(this->_program);
+    setConstantInstance(NULL);
+}
+
+// Visible baked items are drawn with one instanced draw per run of neighbouring slots of a
+// group. The frame and the instance data are all the cpu hands over, whatever the count.
+void GLScene::drawVertexAnimations(const GLFramePacket& frame)
+{
+    // Moved instances go up even when none is visible, the next packets only hold later moves
+    if (!frame.vatInstances.empty() && this->_vatInstanceBuffer != 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, this->_vatInstanceBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, frame.vatInstances.size() * sizeof(float), frame.vatInstances.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    this->_visibleVat.clear();
+    for (auto index : frame.visible)
+    {
+        if (this->_drawItems[index].vat >= 0) this->_visibleVat.push_back(index);
+    }
+    if (this->_visibleVat.empty()) return;
+
+    std::sort(this->_visibleVat.begin(), this->_visibleVat.end(), [this] (int a, int b) { return this->_vatSlots[a] < this->_vatSlots[b]; });
+
+    glUseProgram(this->_vatProgram);
+    glUniform1f(this->_vatUniforms["vatFrame"], frame.vatFrame);
+    glUniform1i(this->_vatUniforms["vatFrameCount"], this->_vatFrameCount);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_BUFFER, this->_vatTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    for (int c = 0; c < 4; c++)
+    {
+        glEnableVertexAttribArray(this->_modelAttrib + c);
+        glVertexAttribDivisor(this->_modelAttrib + c, 1);
+    }
+    glEnableVertexAttribArray(this->_vatOffsetAttrib);
+    glVertexAttribDivisor(this->_vatOffsetAttrib, 1);
+
+    for (size_t i = 0; i < this->_visibleVat.size();)
+    {
+        auto index = this->_visibleVat[i];
+        auto first = this->_vatSlots[index];
+        auto lod = frame.itemLods[index];
+        auto& vat = this->_vertexAnimations[this->_drawItems[index].vat];
+
+        size_t end = i + 1;
+        while (end < this->_visibleVat.size() && this->_vatSlots[this->_visibleVat[end]] == first + (int)(end - i) &&
+               this->_drawItems[this->_visibleVat[end]].vat == this->_drawItems[index].vat && frame.itemLods[this->_visibleVat[end]] == lod) end++;
+
+        bindPrimitive(vat.mesh, vat.primitive);
+
+        // gl_VertexID counts from the base vertex of merged arenas
+        auto firstTexel = vat.firstTexel;
+        auto range = this->_arenaRanges.find(std::make_pair(vat.mesh, vat.primitive));
+        if ((this->_flags & GLSCENE_MERGED_BUFFERS) && range != this->_arenaRanges.end()) firstTexel -= range->second.baseVertex;
+        glUniform1i(this->_vatUniforms["vatFirst"], firstTexel);
+        glUniform1i(this->_vatUniforms["vatVertices"], vat.vertexCount);
+
+        glBindBuffer(GL_ARRAY_BUFFER, this->_vatInstanceBuffer);
+        auto stride = (GLsizei)(sizeof(float) * 17);
+        for (int c = 0; c < 4; c++)
+        {
+            glVertexAttribPointer(this->_modelAttrib + c, 4, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET((first * 17 + c * 4) * sizeof(float)));
+        }
+        glVertexAttribPointer(this->_vatOffsetAttrib, 1, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET((first * 17 + 16) * sizeof(float)));
+
+        drawElements(vat.mesh, vat.primitive, (GLsizei)(end - i), lod);
+        unbindPrimitive(this->_model.meshes[vat.mesh].primitives[vat.primitive]);
+        i = end;
+    }
+
+    for (int c = 0; c < 4; c++)
+    {
+        glVertexAttribDivisor(this->_modelAttrib + c, 0);
+        glDisableVertexAttribArray(this->_modelAttrib + c);
+    }
+    glVertexAttribDivisor(this->_vatOffsetAttrib, 0);
+    glDisableVertexAttribArray(this->_vatOffsetAttrib);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(this->_program);
+}
+
+// Copies what Draw() reads, the scene can animate and cull the next frame after this
+void GLScene::Publish(GLFramePacket& frame)
+{
+    memcpy(frame.projection, this->_cullProjection, sizeof(frame.projection));
+    memcpy(frame.view, this->_cullView, sizeof(frame.view));
+    frame.visible = this->_visible;
+    frame.itemLods = this->_itemLods;
+    frame.slotLods = this->_slotLods;
+
+    // Items in instance slots and baked items take their matrices from instance buffers
+    frame.worlds.resize(this->_visible.size() * 16);
+    for (size_t v = 0; v < this->_visible.size(); v++)
+    {
+        auto index = this->_visible[v];
+        auto& item = this->_drawItems[index];
+        if (item.vat >= 0 || (!this->_itemSlots.empty() && this->_itemSlots[index] >= 0)) continue;
+
+        mat4_copy(&frame.worlds[v * 16], this->_graph.World(item.node));
+    }
+
+    std::sort(this->_dirtySlots.begin(), this->_dirtySlots.end());
+    this->_dirtySlots.erase(std::unique(this->_dirtySlots.begin(), this->_dirtySlots.end()), this->_dirtySlots.end());
+    frame.dirtySlots.swap(this->_dirtySlots);
+    this->_dirtySlots.clear();
+    frame.slotMatrices.resize(frame.dirtySlots.size() * 16);
+    for (size_t i = 0; i < frame.dirtySlots.size(); i++) mat4_copy(&frame.slotMatrices[i * 16], &this->_instanceMatrices[frame.dirtySlots[i] * 16]);
+
+    if (this->_skinProgram != 0)
+        frame.jointMatrices = this->_jointMatrices;
+    else
+        frame.jointMatrices.clear();
+
+    frame.morphs.resize(this->_morphs.size());
+    frame.morphsChanged.resize(this->_morphs.size());
+    for (size_t m = 0; m < this->_morphs.size(); m++)
+    {
+        frame.morphs[m] = this->_morphs[m].active;
+        frame.morphsChanged[m] = this->_morphs[m].dirty ? 1 : 0;
+        this->_morphs[m].dirty = false;
+    }
+
+    frame.vatInstances.clear();
+    if (this->_vatDirty) frame.vatInstances = this->_vatInstances;
+    this->_vatDirty = false;
+    frame.vatFrame = this->_vatFrame;
+}
+
+void GLScene::Draw()
+{
+    Publish(this->_frame);
+    Draw(this->_frame);
+}
+
+// Reads the scene only where it stays the same after Setup(), the rest comes from the frame
+void GLScene::Draw(const GLFramePacket& frame)
+{
+    this->_stats.drawCalls = 0;
+    this->_stats.triangles = 0;
+    this->_stats.textureBinds = 0;
+    resetBindings();
+    this->_stream.BeginFrame();
+
+    // Expects the camera view in the modelview matrix, node transforms are multiplied onto it
+    if (this->_instanceBuffer == 0)
+    {
+        for (size_t v = 0; v < frame.visible.size(); v++)
+        {
+            auto index = frame.visible[v];
+            auto& item = this->_drawItems[index];
+            if (item.skin >= 0 || item.morph >= 0 || item.vat >= 0) continue;
+            if (item.instanceCount > 0)
+            {
+                drawInstancingExtension(item, &frame.worlds[v * 16]);
+                continue;
+            }
+
+            glPushMatrix();
+            glMultMatrixf(&frame.worlds[v * 16]);
+            drawPrimitive(item.mesh, item.primitive, frame.itemLods[index]);
+            glPopMatrix();
+        }
+        drawVertexAnimations(frame);
+        drawDeformed(frame);
+        this->_stream.EndFrame();
+        return;
+    }
+
+    uploadDirtySlots(frame);
+
+    this->_visibleSlots.clear();
+    for (auto index : frame.visible)
+    {
+        if (this->_itemSlots[index] >= 0) this->_visibleSlots.push_back(this->_itemSlots[index]);
+    }
+    std::sort(this->_visibleSlots.begin(), this->_visibleSlots.end());
+
+    for (int c = 0; c < 4; c++)
+    {
+        glEnableVertexAttribArray(this->_modelAttrib + c);
+        glVertexAttribDivisor(this->_modelAttrib + c, 1);
+    }
+
+    if (this->_flags & GLSCENE_MERGED_BUFFERS)
+    {
+        // Primitives that could not be merged are drawn after the arenas
+        drawIndirect(frame);
+        drawRuns(frame, true);
+    }
+    else
+    {
+        drawRuns(frame, false);
+    }
+
+    for (int c = 0; c < 4; c++)
+    {
+        glVertexAttribDivisor(this->_modelAttrib + c, 0);
+        glDisableVertexAttribArray(this->_modelAttrib + c);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    for (size_t v = 0; v < frame.visible.size(); v++)
+    {
+        auto& item = this->_drawItems[frame.visible[v]];
+        if (item.instanceCount > 0) drawInstancingExtension(item, &frame.worlds[v * 16]);
+    }
+
+    drawVertexAnimations(frame);
+    drawDeformed(frame);
+
+    this->_stream.EndFrame();
+}
+
+void GLScene::Cleanup()
+{
+    if (this->_instanceBuffer != 0) glDeleteBuffers(1, &this->_instanceBuffer);
+    this->_instanceBuffer = 0;
+    this->_stream.Cleanup();
+
+    for (auto& arena : this->_arenas) glDeleteBuffers(1, &arena.vb);
+    this->_arenas.clear();
+    this->_arenaRanges.clear();
+    if (this->_indexArena != 0) glDeleteBuffers(1, &this->_indexArena);
+    this->_indexArena = 0;
+    if (this->_indirectBuffer != 0) glDeleteBuffers(1, &this->_indirectBuffer);
+    this->_indirectBuffer = 0;
+    if (this->_paletteBuffer != 0) glDeleteBuffers(1, &this->_paletteBuffer);
+    this->_paletteBuffer = 0;
+    if (this->_morphBuffer != 0) glDeleteBuffers(1, &this->_morphBuffer);
+    this->_morphBuffer = 0;
+    if (this->_morphTexture != 0) glDeleteTextures(1, &this->_morphTexture);
+    this->_morphTexture = 0;
+    if (this->_morphDeltaBuffer != 0) glDeleteBuffers(1, &this->_morphDeltaBuffer);
+    this->_morphDeltaBuffer = 0;
+    if (this->_vatTexture != 0) glDeleteTextures(1, &this->_vatTexture);
+    this->_vatTexture = 0;
+    if (this->_vatBuffer != 0) glDeleteBuffers(1, &this->_vatBuffer);
+    this->_vatBuffer = 0;
+    if (this->_vatInstanceBuffer != 0) glDeleteBuffers(1, &this->_vatInstanceBuffer);
+    this->_vatInstanceBuffer = 0;
+
+    for (auto& chain : this->_lodChains)
+    {
+        for (auto& lod : chain)
+        {
+            if (lod.ib != 0) glDeleteBuffers(1, &lod.ib);
+        }
+    }
+    this->_lodChains.clear();
+    this->_primitiveLods.clear();
+
+    // Arrays are shared by several textures
+    std::set<GLuint> textures;
+    for (auto& it : this->_textures) textures.insert(it.second);
+    for (auto texture : textures) glDeleteTextures(1, &texture);
+    this->_textures.clear();
+    this->_textureLayers.clear();
+    if (this->_layerBuffer != 0) glDeleteBuffers(1, &this->_layerBuffer);
+    this->_layerBuffer = 0;
+    for (auto& it : this->_samplers) glDeleteSamplers(1, &it.second);
+    this->_samplers.clear();
+    this->_meshStates.clear();
+}
+
+SceneGraph& GLScene::Graph() { return this->_graph; }
+
+SceneAnimation& GLScene::Animation() { return this->_animation; }
+
+const GLSceneStats& GLScene::Stats() const { return this->_stats; }
+
 #endif // GLSCENE_IMPLEMENTATION
@@ -7,19 +7,115 @@
 #include "glfwcamera.h"
 #include "glprogram.h"
 
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+// What the update thread hands to the render thread
+typedef struct {
+    GLFramePacket packet;
+    int width;
+    int height;
+} ViewerFrame;
+
+// Filled frames go to the render thread in order, drawn ones come back to be filled again
+class FrameQueue
+{
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    std::deque<ViewerFrame*> _free;
+    std::deque<ViewerFrame*> _filled;
+    bool _closed;
+
+    ViewerFrame *take(std::deque<ViewerFrame*>& frames)
+    {
+        std::unique_lock<std::mutex> lock(this->_mutex);
+        this->_changed.wait(lock, [this, &frames] { return this->_closed || !frames.empty(); });
+        if (this->_closed) return NULL;
+
+        auto frame = frames.front();
+        frames.pop_front();
+        return frame;
+    }
+
+    void give(std::deque<ViewerFrame*>& frames, ViewerFrame *frame)
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            frames.push_back(frame);
+        }
+        this->_changed.notify_all();
+    }
+public:
+    FrameQueue(std::vector<ViewerFrame>& frames) : _closed(false)
+    {
+        for (auto& frame : frames) this->_free.push_back(&frame);
+    }
+
+    // Both block until there is a frame, NULL once closed
+    ViewerFrame *Fill() { return take(this->_free); }
+    ViewerFrame *Draw() { return take(this->_filled); }
+
+    void Filled(ViewerFrame *frame) { give(this->_filled, frame); }
+    void Drawn(ViewerFrame *frame) { give(this->_free, frame); }
+
+    void Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            this->_closed = true;
+        }
+        this->_changed.notify_all();
+    }
+};
+
 int main(int argc, char *argv[])
 {
     if (argc < 2)
     {
-        std::cout << "glview input.gltf <scale>\n" << std::endl;
+        std::cout << "glview input.gltf <scale> [--merged] [--lod] [--occlusion] [--optimize] [--quantize] [--interleaved] [--compress[=cachedir]] [--arrays] [--compress-animations] [--animation-lod] [--animate[=index]] [--vertex-animation] [--single-thread]\n" << std::endl;
         return 0;
     }
 
+    float scale = 1.0f;
+    unsigned int sceneFlags = 0;
+    std::string textureCache;
+    int animation = -1;
+    bool vertexAnimation = false;
+    bool singleThread = false;
+    for (int i = 2; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--merged") sceneFlags |= GLSCENE_MERGED_BUFFERS;
+        else if (std::string(argv[i]) == "--lod") sceneFlags |= GLSCENE_GENERATE_LODS;
+        else if (std::string(argv[i]) == "--occlusion") sceneFlags |= GLSCENE_OCCLUSION_CULLING;
+        else if (std::string(argv[i]) == "--optimize") sceneFlags |= GLSCENE_OPTIMIZE_MESHES | GLSCENE_OPTIMIZE_OVERDRAW;
+        else if (std::string(argv[i]) == "--quantize") sceneFlags |= GLSCENE_QUANTIZE_VERTICES;
+        else if (std::string(argv[i]) == "--interleaved") sceneFlags |= GLSCENE_INTERLEAVED_BUFFERS;
+        else if (std::string(argv[i]) == "--arrays") sceneFlags |= GLSCENE_TEXTURE_ARRAYS;
+        else if (std::string(argv[i]) == "--compress-animations") sceneFlags |= GLSCENE_COMPRESS_ANIMATIONS;
+        else if (std::string(argv[i]) == "--animation-lod") sceneFlags |= GLSCENE_ANIMATION_LOD;
+        else if (std::string(argv[i]).compare(0, 10, "--compress") == 0)
+        {
+            sceneFlags |= GLSCENE_COMPRESS_TEXTURES;
+            if (std::string(argv[i]).compare(0, 11, "--compress=") == 0) textureCache = std::string(argv[i]).substr(11);
+        }
+        else if (std::string(argv[i]) == "--vertex-animation") vertexAnimation = true;
+        else if (std::string(argv[i]) == "--single-thread") singleThread = true;
+        else if (std::string(argv[i]).compare(0, 9, "--animate") == 0)
+        {
+            animation = 0;
+            if (std::string(argv[i]).compare(0, 10, "--animate=") == 0) animation = std::stoi(std::string(argv[i]).substr(10));
+        }
+        else scale = std::stof(argv[i]);
+    }
+
     if (!glfwInit())
     {
         std::cerr << "Failed to initialize GLFW." << std::endl;
@@ -59,7 +155,7 @@ int main(int argc, char *argv[])
 
     GLFWCamera camera;
     camera.Setup(window);
-    camera.SetScale(argc > 2 ? std::stof(argv[2]) : 1.0f);
+    camera.SetScale(scale);
 
     GLProgram program;
     std::map<GLenum, const char*> shaders = {
@@ -72,6 +168,41 @@ int main(int argc, char *argv[])
         return -1;
     }
 
+    GLProgram skinnedProgram;
+    std::map<GLenum, const char*> skinnedShaders = {
+        { GL_VERTEX_SHADER, "shader_skinned.vert" },
+        { GL_FRAGMENT_SHADER, "shader.frag" }
+    };
+    if (!skinnedProgram.Setup(skinnedShaders))
+    {
+        std::cout << "WARN: no skinned shader, skinned meshes are drawn in their bind pose" << std::endl;
+        skinnedProgram.Cleanup();
+    }
+
+    GLProgram morphProgram;
+    std::map<GLenum, const char*> morphShaders = {
+        { GL_VERTEX_SHADER, "shader_morph.vert" },
+        { GL_FRAGMENT_SHADER, "shader.frag" }
+    };
+    if (!morphProgram.Setup(morphShaders))
+    {
+        std::cout << "WARN: no morph shader, morph targets are blended on the cpu" << std::endl;
+        morphProgram.Cleanup();
+    }
+
+    // Bakes the played animation, so it needs one
+    GLProgram vatProgram;
+    std::map<GLenum, const char*> vatShaders = {
+        { GL_VERTEX_SHADER, "shader_vat.vert" },
+        { GL_FRAGMENT_SHADER, "shader.frag" }
+    };
+    if (vertexAnimation && animation < 0) animation = 0;
+    if (vertexAnimation && !vatProgram.Setup(vatShaders))
+    {
+        std::cout << "WARN: no vertex animation shader, deformed meshes are skinned and morphed every frame" << std::endl;
+        vatProgram.Cleanup();
+    }
+
     GLScene scene;
     if (!scene.Load(argv[1]))
     {
@@ -79,27 +210,121 @@ int main(int argc, char *argv[])
         return -1;
     }
 
-    scene.Setup(program.ProgId());
+    scene.SetTextureCache(textureCache);
+    scene.SetSkinningProgram(skinnedProgram.ProgId());
+    scene.SetMorphProgram(morphProgram.ProgId());
+    if (vertexAnimation) scene.SetVertexAnimation(vatProgram.ProgId(), animation);
+    scene.Setup(program.ProgId(), sceneFlags);
 
-    while (glfwWindowShouldClose(window) == GL_FALSE)
+    if (animation >= scene.Animation().AnimationCount()) animation = -1;
+
+    double lastTitleUpdate = glfwGetTime();
+    double animationStart = glfwGetTime();
+
+    // Input, animation and culling run on this thread, a render thread owns the context and
+    // draws the frames they leave. With three frames one is filled while one waits and one
+    // is drawn, so a frame takes about the longer of the two instead of both.
+    std::vector<ViewerFrame> frameStore(singleThread ? 1 : 3);
+    FrameQueue frames(frameStore);
+    std::atomic<int> triangles(0);
+
+    int viewportWidth = camera.Width(), viewportHeight = camera.Height();
+    auto drawFrame = [&] (const ViewerFrame& frame)
     {
-        glfwPollEvents();
+        if (frame.width != viewportWidth || frame.height != viewportHeight)
+        {
+            viewportWidth = frame.width;
+            viewportHeight = frame.height;
+            glViewport(0, 0, viewportWidth, viewportHeight);
+        }
+
         glClearColor(0.3f, 0.4f, 0.6f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         glEnable(GL_DEPTH_TEST);
 
-        camera.Build();
+        glMatrixMode(GL_PROJECTION);
+        glLoadMatrixf(frame.packet.projection);
+        glMatrixMode(GL_MODELVIEW);
+        glLoadMatrixf(frame.packet.view);
 
-        scene.Draw();
+        scene.Draw(frame.packet);
 
         glFlush();
 
         glfwSwapBuffers(window);
+        triangles = scene.Stats().triangles;
+    };
+
+    std::thread renderer;
+    if (!singleThread)
+    {
+        camera.SetLoadMatrices(false);
+        glfwMakeContextCurrent(NULL);
+        renderer = std::thread([&] ()
+        {
+            glfwMakeContextCurrent(window);
+            for (auto frame = frames.Draw(); frame != NULL; frame = frames.Draw())
+            {
+                drawFrame(*frame);
+                frames.Drawn(frame);
+            }
+            glfwMakeContextCurrent(NULL);
+        });
+    }
+
+    while (glfwWindowShouldClose(window) == GL_FALSE)
+    {
+        glfwPollEvents();
+
+        camera.Build();
+
+        if (animation >= 0)
+        {
+            // Loop over the keys of the animation
+            float start = scene.Animation().Start(animation), length = scene.Animation().End(animation) - start;
+            float time = (float)(glfwGetTime() - animationStart);
+            scene.Animate(animation, start + (length > 0.0f ? fmodf(time, length) : 0.0f));
+        }
+
+        scene.Cull(camera.Projection(), camera.View());
+
+        auto frame = singleThread ? &frameStore[0] : frames.Fill();
+        scene.Publish(frame->packet);
+        frame->width = camera.Width();
+        frame->height = camera.Height();
+        if (singleThread)
+            drawFrame(*frame);
+        else
+            frames.Filled(frame);
+
+        if (glfwGetTime() - lastTitleUpdate > 1.0)
+        {
+            auto& stats = scene.Stats();
+            std::stringstream statsTitle;
+            statsTitle << title.str() << " [visible " << stats.visible << ", culled " << stats.culled << ", occluded " << stats.occluded << ", tested " << stats.tested << ", triangles " << triangles << "]";
+            if (sceneFlags & GLSCENE_ANIMATION_LOD)
+            {
+                statsTitle << " [animated " << stats.animated[0] << "/" << stats.animated[1] << "/" << stats.animated[2] << ", blended " << stats.blended
+                           << ", frozen " << stats.frozen << ", deferred " << stats.deferred << "]";
+            }
+            glfwSetWindowTitle(window, statsTitle.str().c_str());
+            lastTitleUpdate = glfwGetTime();
+        }
+    }
+
+    if (!singleThread)
+    {
+        frames.Close();
+        renderer.join();
+        glfwMakeContextCurrent(window);
     }
 
     scene.Cleanup();
 
+    vatProgram.Cleanup();
+    morphProgram.Cleanup();
+    skinnedProgram.Cleanup();
     program.Cleanup();
 
     glfwTerminate();
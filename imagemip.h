@@ -0,0 +1,96 @@
+/* imagemip - v0.1 - public domain mip chain generation for 8 bit images
+
+    Do this:
+        #define IMAGEMIP_IMPLEMENTATION
+    before you include this file in *one* C or C++ file to create the implementation.
+
+    Every level is a 2x2 box filter of the one before it, rounded to nearest.
+    Odd sizes repeat the last row or column. RGBA images are filtered two
+    pixels at a time when SSE2 is available, with the same integer math as
+    the scalar code, so the levels are identical on every machine and driver.
+
+    The filter works on the stored values, it does not convert sRGB to linear.
+
+    Release notes:
+        v0.1    (2026-10-18)    initial version for mipmapped textures in gltfscene
+
+LICENSE
+
+This software is in the public domain. Where that dedication is not
+recognized, you are granted a perpetual, irrevocable license to copy,
+distribute, and modify this file as you see fit.
+
+*/
+#ifndef IMAGEMIP_H
+#define IMAGEMIP_H
+
+// Number of levels including the image itself, down to 1x1
+int image_mip_count(int width, int height);
+
+// Writes the next level, max(width / 2, 1) by max(height / 2, 1) pixels
+void image_mip_downsample(unsigned char *destination, const unsigned char *source, int width, int height, int components);
+
+#endif // IMAGEMIP_H
+
+#ifdef IMAGEMIP_IMPLEMENTATION
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGEMIP_SSE2
+#include <emmintrin.h>
+#endif
+
+int image_mip_count(int width, int height)
+{
+    int count = 1;
+    while (width > 1 || height > 1)
+    {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        count++;
+    }
+    return count;
+}
+
+void image_mip_downsample(unsigned char *destination, const unsigned char *source, int width, int height, int components)
+{
+    auto w = width > 1 ? width / 2 : 1;
+    auto h = height > 1 ? height / 2 : 1;
+    for (int y = 0; y < h; y++)
+    {
+        auto row0 = source + (size_t)(y * 2 < height ? y * 2 : height - 1) * width * components;
+        auto row1 = source + (size_t)(y * 2 + 1 < height ? y * 2 + 1 : height - 1) * width * components;
+        auto out = destination + (size_t)y * w * components;
+
+        int x = 0;
+#ifdef IMAGEMIP_SSE2
+        if (components == 4 && width > 1)
+        {
+            // Four source pixels of both rows give two output pixels
+            const __m128i zero = _mm_setzero_si128(), round = _mm_set1_epi16(2);
+            for (; x + 2 <= w; x += 2)
+            {
+                auto a = _mm_loadu_si128((const __m128i *)(row0 + x * 8));
+                auto b = _mm_loadu_si128((const __m128i *)(row1 + x * 8));
+                auto lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                auto hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+                hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+                auto sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), round), 2);
+                _mm_storel_epi64((__m128i *)(out + x * 4), _mm_packus_epi16(sum, zero));
+            }
+        }
+#endif
+        for (; x < w; x++)
+        {
+            auto x0 = x * 2 < width ? x * 2 : width - 1;
+            auto x1 = x * 2 + 1 < width ? x * 2 + 1 : width - 1;
+            for (int c = 0; c < components; c++)
+            {
+                int sum = row0[x0 * components + c] + row0[x1 * components + c] + row1[x0 * components + c] + row1[x1 * components + c];
+                out[x * components + c] = (unsigned char)((sum + 2) >> 2);
+            }
+        }
+    }
+}
+
+#endif // IMAGEMIP_IMPLEMENTATION
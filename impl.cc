@@ -2,9 +2,29 @@
 #define GLEXTL_IMPLEMENTATION
 #include <GL/glextl.h>
 
-#define GLSCENE_IMPLEMENTATION
+// tiny_gltf.h is included by several of the headers below, its implementation
+// section has no guard so it is compiled here once on its own.
 #define TINYGLTF_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
+#include "tiny_gltf.h"
+#undef TINYGLTF_IMPLEMENTATION
+#undef STB_IMAGE_IMPLEMENTATION
+
+#define ANIMCOMPRESS_IMPLEMENTATION
+#define GLSCENE_IMPLEMENTATION
+#define GLSTREAMBUFFER_IMPLEMENTATION
+#define GLTFACCESSOR_IMPLEMENTATION
+#define IMAGEMIP_IMPLEMENTATION
+#define KTX2_IMPLEMENTATION
+#define MESHOPTIMIZE_IMPLEMENTATION
+#define MESHQUANTIZE_IMPLEMENTATION
+#define MESHSIMPLIFY_IMPLEMENTATION
+#define OCCLUSION_IMPLEMENTATION
+#define SCENEANIMATION_IMPLEMENTATION
+#define SCENEBVH_IMPLEMENTATION
+#define SCENEGRAPH_IMPLEMENTATION
+#define TEXCOMPRESS_IMPLEMENTATION
+#define THREADPOOL_IMPLEMENTATION
 #include "gltfscene.h"
 
 #define GLFWCAMERA_IMPLEMENTATION
@@ -0,0 +1,142 @@
+/* ktx2 - v0.2 - public domain KTX 2.0 container reader for 2D textures
+
+    Do this:
+        #define KTX2_IMPLEMENTATION
+    before you include this file in *one* C or C++ file to create the implementation.
+
+    Reads the header and level index of a KTX 2.0 file held in memory and
+    hands out where every mip level is. Nothing is copied, the levels point
+    into the caller's data.
+
+    Only 2D textures are read: no depth, array layers or cube faces. Levels
+    with supercompression are reported but not unpacked. BasisLZ (ETC1S) and
+    Zstandard (used with UASTC) need the Basis Universal transcoder and zstd,
+    ktx2_level returns NULL for them and callers should use a fallback image.
+
+    Release notes:
+        v0.1    (2026-10-18)    initial version for KHR_texture_basisu in gltfscene
+        v0.2    (2026-10-18)    BC5 vkFormat
+
+LICENSE
+
+This software is in the public domain. Where that dedication is not
+recognized, you are granted a perpetual, irrevocable license to copy,
+distribute, and modify this file as you see fit.
+
+*/
+#ifndef KTX2_H
+#define KTX2_H
+
+#include <cstddef>
+#include <vector>
+
+// vkFormat values of the formats the reader has a use for
+#define KTX2_FORMAT_UNDEFINED 0  // Basis Universal payloads
+#define KTX2_FORMAT_R8G8B8_UNORM 23
+#define KTX2_FORMAT_R8G8B8_SRGB 29
+#define KTX2_FORMAT_R8G8B8A8_UNORM 37
+#define KTX2_FORMAT_R8G8B8A8_SRGB 43
+#define KTX2_FORMAT_BC1_RGB_UNORM_BLOCK 131
+#define KTX2_FORMAT_BC1_RGB_SRGB_BLOCK 132
+#define KTX2_FORMAT_BC1_RGBA_UNORM_BLOCK 133
+#define KTX2_FORMAT_BC1_RGBA_SRGB_BLOCK 134
+#define KTX2_FORMAT_BC3_UNORM_BLOCK 137
+#define KTX2_FORMAT_BC3_SRGB_BLOCK 138
+#define KTX2_FORMAT_BC5_UNORM_BLOCK 141
+#define KTX2_FORMAT_BC7_UNORM_BLOCK 145
+#define KTX2_FORMAT_BC7_SRGB_BLOCK 146
+
+#define KTX2_SUPERCOMPRESSION_NONE 0
+#define KTX2_SUPERCOMPRESSION_BASISLZ 1
+#define KTX2_SUPERCOMPRESSION_ZSTD 2
+#define KTX2_SUPERCOMPRESSION_ZLIB 3
+
+typedef struct {
+    size_t offset;
+    size_t length;
+} KTX2Level;
+
+typedef struct {
+    unsigned int vkFormat;
+    int width;
+    int height;
+    unsigned int supercompression;
+    bool generateMips;              // levelCount 0, only the base level is stored
+    std::vector<KTX2Level> levels;  // largest first
+} KTX2Info;
+
+bool ktx2_is(const unsigned char *data, size_t size);
+
+// Checks the header and that every level lies inside data. False for anything
+// that is not a plain 2D texture.
+bool ktx2_read(const unsigned char *data, size_t size, KTX2Info *info);
+
+// Bytes of a level, NULL when the level is supercompressed
+const unsigned char *ktx2_level(const unsigned char *data, const KTX2Info& info, int level);
+
+#endif // KTX2_H
+
+#ifdef KTX2_IMPLEMENTATION
+
+#include <cstring>
+
+static const unsigned char ktx2_identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+static unsigned int ktx2_uint(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static unsigned long long ktx2_ulong(const unsigned char *p)
+{
+    return ktx2_uint(p) | ((unsigned long long)ktx2_uint(p + 4) << 32);
+}
+
+bool ktx2_is(const unsigned char *data, size_t size)
+{
+    return size >= 12 && memcmp(data, ktx2_identifier, 12) == 0;
+}
+
+bool ktx2_read(const unsigned char *data, size_t size, KTX2Info *info)
+{
+    // Identifier, 9 header fields, the index and at least one level
+    if (!ktx2_is(data, size) || size < 80 + 24) return false;
+
+    info->vkFormat = ktx2_uint(data + 12);
+    info->width = (int)ktx2_uint(data + 20);
+    info->height = (int)ktx2_uint(data + 24);
+    auto depth = ktx2_uint(data + 28);
+    auto layers = ktx2_uint(data + 32);
+    auto faces = ktx2_uint(data + 36);
+    auto levelCount = ktx2_uint(data + 40);
+    info->supercompression = ktx2_uint(data + 44);
+    info->generateMips = levelCount == 0;
+    info->levels.clear();
+
+    if (info->width <= 0 || info->height <= 0 || depth > 1 || layers > 1 || faces != 1 || levelCount > 32) return false;
+
+    if (levelCount == 0) levelCount = 1;
+    if (80 + (size_t)levelCount * 24 > size) return false;
+
+    for (unsigned int l = 0; l < levelCount; l++)
+    {
+        auto entry = data + 80 + l * 24;
+        auto offset = ktx2_ulong(entry);
+        auto length = ktx2_ulong(entry + 8);
+        if (offset > size || length > size - offset) return false;
+
+        KTX2Level level = { (size_t)offset, (size_t)length };
+        info->levels.push_back(level);
+    }
+    return true;
+}
+
+const unsigned char *ktx2_level(const unsigned char *data, const KTX2Info& info, int level)
+{
+    if (info.supercompression != KTX2_SUPERCOMPRESSION_NONE) return NULL;
+    if (level < 0 || level >= (int)info.levels.size()) return NULL;
+
+    return data + info.levels[level].offset;
+}
+
+#endif // KTX2_IMPLEMENTATION
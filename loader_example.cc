@@ -236,6 +236,14 @@ static std::string PrintValue(const std::string &name,
   return ss.str();
 }
 
+static void DumpStringIntMap(const std::map<std::string, int> &m, int indent) {
+  std::map<std::string, int>::const_iterator it(m.begin());
+  std::map<std::string, int>::const_iterator itEnd(m.end());
+  for (; it != itEnd; it++) {
+    std::cout << Indent(indent) << it->first << ": " << it->second << std::endl;
+  }
+}
+
 static void DumpNode(const tinygltf::Node &node, int indent) {
   std::cout << Indent(indent) << "name        : " << node.name << std::endl;
   std::cout << Indent(indent) << "camera      : " << node.camera << std::endl;
@@ -262,13 +270,11 @@ static void DumpNode(const tinygltf::Node &node, int indent) {
 
   std::cout << Indent(indent)
             << "children    : " << PrintIntArray(node.children) << std::endl;
-}
 
-static void DumpStringIntMap(const std::map<std::string, int> &m, int indent) {
-  std::map<std::string, int>::const_iterator it(m.begin());
-  std::map<std::string, int>::const_iterator itEnd(m.end());
-  for (; it != itEnd; it++) {
-    std::cout << Indent(indent) << it->first << ": " << it->second << std::endl;
+  if (!node.instanceAttributes.empty()) {
+    std::cout << Indent(indent) << "EXT_mesh_gpu_instancing(items="
+              << node.instanceAttributes.size() << ")" << std::endl;
+    DumpStringIntMap(node.instanceAttributes, indent + 1);
   }
 }
 
@@ -356,6 +362,18 @@ static void Dump(const tinygltf::Model &model) {
         }
         std::cout << "]" << std::endl;
       }
+      if (accessor.sparse.isSparse) {
+        std::cout << Indent(2) << "sparse count : " << accessor.sparse.count
+                  << std::endl;
+        std::cout << Indent(3) << "indices      : bufferView "
+                  << accessor.sparse.indices.bufferView << ", byteOffset "
+                  << accessor.sparse.indices.byteOffset << ", "
+                  << PrintComponentType(accessor.sparse.indices.componentType)
+                  << std::endl;
+        std::cout << Indent(3) << "values       : bufferView "
+                  << accessor.sparse.values.bufferView << ", byteOffset "
+                  << accessor.sparse.values.byteOffset << std::endl;
+      }
     }
   }
 
@@ -0,0 +1,259 @@
+/* meshoptimize - v0.1 - public domain index and vertex reordering for the gpu
+
+    Do this:
+        #define MESHOPTIMIZE_IMPLEMENTATION
+    before you include this file in *one* C or C++ file to create the implementation.
+
+    Three passes over an indexed triangle list, usually run in this order:
+
+    mesh_optimize_vertex_cache reorders triangles so vertices are reused while
+    they are still in the post-transform cache (Tipsify, Sander et al. 2007).
+
+    mesh_optimize_overdraw splits that order into clusters where the cache
+    starts over anyway and sorts the clusters so the ones facing outwards are
+    drawn first, which lets early depth rejection skip more of the rest.
+
+    mesh_optimize_vertex_fetch renumbers the vertices in the order the indices
+    first use them, so vertex fetches walk through memory. The remap tells the
+    caller where every vertex has to move to.
+
+    mesh_analyze_vertex_cache simulates a fifo cache and reports the average
+    cache miss ratio per triangle (ACMR) and per vertex (ATVR, 1.0 is ideal).
+
+    Release notes:
+        v0.1    (2026-10-18)    initial version for load time optimization in gltfscene
+
+LICENSE
+
+This software is in the public domain. Where that dedication is not
+recognized, you are granted a perpetual, irrevocable license to copy,
+distribute, and modify this file as you see fit.
+
+*/
+#ifndef MESHOPTIMIZE_H
+#define MESHOPTIMIZE_H
+
+#include <cstddef>
+
+#define MESHOPTIMIZE_CACHE_SIZE 16
+
+// destination may not alias indices
+void mesh_optimize_vertex_cache(unsigned int *destination, const unsigned int *indices, size_t indexCount, size_t vertexCount);
+
+// Expects the output of mesh_optimize_vertex_cache, destination may not alias indices
+void mesh_optimize_overdraw(unsigned int *destination, const unsigned int *indices, size_t indexCount, const float *positions, size_t vertexCount);
+
+// Rewrites the indices in place. remap[old] is the new position of every vertex,
+// unreferenced vertices go to the end. Returns the number of referenced vertices.
+size_t mesh_optimize_vertex_fetch(unsigned int *remap, unsigned int *indices, size_t indexCount, size_t vertexCount);
+
+void mesh_analyze_vertex_cache(const unsigned int *indices, size_t indexCount, size_t vertexCount, float *acmr, float *atvr);
+
+#endif // MESHOPTIMIZE_H
+
+#ifdef MESHOPTIMIZE_IMPLEMENTATION
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Next vertex to fan around: the candidate with the oldest cache entry that will
+// still be in the cache after its remaining triangles are emitted
+static int mesh_next_vertex(const std::vector<unsigned int>& candidates, const std::vector<unsigned int>& live, const std::vector<unsigned int>& timestamps,
+                            unsigned int time, std::vector<unsigned int>& deadEnd, size_t& cursor, size_t vertexCount)
+{
+    int best = -1;
+    int bestPriority = -1;
+    for (auto v : candidates)
+    {
+        if (live[v] == 0) continue;
+
+        int priority = 0;
+        if (time - timestamps[v] + 2 * live[v] <= MESHOPTIMIZE_CACHE_SIZE) priority = (int)(time - timestamps[v]);
+        if (priority > bestPriority)
+        {
+            best = (int)v;
+            bestPriority = priority;
+        }
+    }
+    if (best >= 0) return best;
+
+    while (!deadEnd.empty())
+    {
+        auto v = deadEnd.back();
+        deadEnd.pop_back();
+        if (live[v] > 0) return (int)v;
+    }
+
+    for (; cursor < vertexCount; cursor++)
+    {
+        if (live[cursor] > 0) return (int)cursor;
+    }
+    return -1;
+}
+
+void mesh_optimize_vertex_cache(unsigned int *destination, const unsigned int *indices, size_t indexCount, size_t vertexCount)
+{
+    auto triangleCount = indexCount / 3;
+
+    std::vector<unsigned int> live(vertexCount, 0), offsets(vertexCount + 1, 0), adjacency(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount * 3; i++) live[indices[i]]++;
+    for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + live[v];
+    {
+        std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++) adjacency[cursor[indices[i]]++] = (unsigned int)(i / 3);
+    }
+
+    std::vector<unsigned int> timestamps(vertexCount, 0), deadEnd, candidates;
+    std::vector<unsigned char> emitted(triangleCount, 0);
+    unsigned int time = MESHOPTIMIZE_CACHE_SIZE + 1;
+    size_t cursor = 0, write = 0;
+
+    int fan = triangleCount > 0 ? mesh_next_vertex(candidates, live, timestamps, time, deadEnd, cursor, vertexCount) : -1;
+    while (fan >= 0)
+    {
+        candidates.clear();
+        for (auto i = offsets[fan]; i < offsets[fan + 1]; i++)
+        {
+            auto t = adjacency[i];
+            if (emitted[t]) continue;
+
+            emitted[t] = 1;
+            for (int k = 0; k < 3; k++)
+            {
+                auto v = indices[t * 3 + k];
+                destination[write++] = v;
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - timestamps[v] > MESHOPTIMIZE_CACHE_SIZE) timestamps[v] = time++;
+            }
+        }
+
+        fan = mesh_next_vertex(candidates, live, timestamps, time, deadEnd, cursor, vertexCount);
+    }
+}
+
+void mesh_optimize_overdraw(unsigned int *destination, const unsigned int *indices, size_t indexCount, const float *positions, size_t vertexCount)
+{
+    auto triangleCount = indexCount / 3;
+
+    // A triangle that misses the cache on all three vertices starts a cluster,
+    // moving clusters around then costs next to nothing in cache efficiency
+    std::vector<size_t> clusters;
+    std::vector<unsigned int> timestamps(vertexCount, 0);
+    unsigned int time = MESHOPTIMIZE_CACHE_SIZE + 1;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        int misses = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            auto v = indices[t * 3 + k];
+            if (time - timestamps[v] > MESHOPTIMIZE_CACHE_SIZE)
+            {
+                timestamps[v] = time++;
+                misses++;
+            }
+        }
+        if (misses == 3 || t == 0) clusters.push_back(t);
+    }
+    clusters.push_back(triangleCount);
+
+    float meshCenter[3] = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+    std::vector<float> clusterCenters((clusters.size() - 1) * 3, 0.0f), clusterNormals((clusters.size() - 1) * 3, 0.0f), clusterAreas(clusters.size() - 1, 0.0f);
+    for (size_t c = 0; c + 1 < clusters.size(); c++)
+    {
+        for (auto t = clusters[c]; t < clusters[c + 1]; t++)
+        {
+            auto a = &positions[indices[t * 3] * 3], b = &positions[indices[t * 3 + 1] * 3], d = &positions[indices[t * 3 + 2] * 3];
+            float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            float e2[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int k = 0; k < 3; k++)
+            {
+                float center = (a[k] + b[k] + d[k]) / 3.0f;
+                clusterCenters[c * 3 + k] += center * area;
+                clusterNormals[c * 3 + k] += n[k];
+                meshCenter[k] += center * area;
+            }
+            clusterAreas[c] += area;
+            meshArea += area;
+        }
+    }
+    if (meshArea > 0.0f)
+    {
+        for (int k = 0; k < 3; k++) meshCenter[k] /= meshArea;
+    }
+
+    // Clusters facing away from the center are most likely to hide the others
+    std::vector<float> sortKeys(clusters.size() - 1, 0.0f);
+    std::vector<size_t> order(clusters.size() - 1);
+    for (size_t c = 0; c < order.size(); c++)
+    {
+        order[c] = c;
+        if (clusterAreas[c] <= 0.0f) continue;
+
+        auto n = &clusterNormals[c * 3];
+        float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length <= 0.0f) continue;
+
+        for (int k = 0; k < 3; k++) sortKeys[c] += (clusterCenters[c * 3 + k] / clusterAreas[c] - meshCenter[k]) * n[k] / length;
+    }
+    std::stable_sort(order.begin(), order.end(), [&sortKeys] (size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    size_t write = 0;
+    for (auto c : order)
+    {
+        for (auto i = clusters[c] * 3; i < clusters[c + 1] * 3; i++) destination[write++] = indices[i];
+    }
+}
+
+size_t mesh_optimize_vertex_fetch(unsigned int *remap, unsigned int *indices, size_t indexCount, size_t vertexCount)
+{
+    const unsigned int unused = ~0u;
+    std::fill(remap, remap + vertexCount, unused);
+
+    unsigned int next = 0;
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        auto& v = indices[i];
+        if (remap[v] == unused) remap[v] = next++;
+        v = remap[v];
+    }
+
+    size_t referenced = next;
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        if (remap[v] == unused) remap[v] = next++;
+    }
+    return referenced;
+}
+
+void mesh_analyze_vertex_cache(const unsigned int *indices, size_t indexCount, size_t vertexCount, float *acmr, float *atvr)
+{
+    std::vector<unsigned int> timestamps(vertexCount, 0);
+    std::vector<unsigned char> used(vertexCount, 0);
+    unsigned int time = MESHOPTIMIZE_CACHE_SIZE + 1;
+    size_t misses = 0, unique = 0;
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        auto v = indices[i];
+        if (time - timestamps[v] > MESHOPTIMIZE_CACHE_SIZE)
+        {
+            timestamps[v] = time++;
+            misses++;
+        }
+        if (!used[v])
+        {
+            used[v] = 1;
+            unique++;
+        }
+    }
+
+    if (acmr != NULL) *acmr = indexCount >= 3 ? (float)misses / (indexCount / 3) : 0.0f;
+    if (atvr != NULL) *atvr = unique > 0 ? (float)misses / unique : 0.0f;
+}
+
+#endif // MESHOPTIMIZE_IMPLEMENTATION
@@ -0,0 +1,97 @@
+/* meshquantize - v0.1 - public domain vertex attribute quantization
+
+    Do this:
+        #define MESHQUANTIZE_IMPLEMENTATION
+    before you include this file in *one* C or C++ file to create the implementation.
+
+    Encoders for the attribute formats of KHR_mesh_quantization. Every vertex
+    is written padded to a multiple of four bytes, as glTF requires for vertex
+    attributes, so the output can be used as a bufferView as it is.
+
+    mesh_quantize_positions writes unsigned 16 bit integers relative to a box,
+    one uniform scale for all axes keeps normals valid under the transform
+    that turns them back into positions: p = offset + q * scale.
+
+    mesh_quantize_normals writes signed normalized bytes, 3 per vertex plus
+    one byte padding. The extension only allows vec3 normals, so octahedral
+    encodings are out.
+
+    mesh_quantize_texcoords writes unsigned normalized 16 bit integers, which
+    only covers coordinates in [0, 1].
+
+    Release notes:
+        v0.1    (2026-10-18)    initial version for KHR_mesh_quantization in gltfscene
+
+LICENSE
+
+This software is in the public domain. Where that dedication is not
+recognized, you are granted a perpetual, irrevocable license to copy,
+distribute, and modify this file as you see fit.
+
+*/
+#ifndef MESHQUANTIZE_H
+#define MESHQUANTIZE_H
+
+#include <cstddef>
+
+// Uniform scale that maps the largest extent of bounds to 65535, never 0
+float mesh_quantize_scale(const float bounds[6]);
+
+// 4 unsigned shorts per vertex, the last one is padding
+void mesh_quantize_positions(unsigned short *destination, const float *positions, size_t count, const float offset[3], float scale);
+
+// 4 signed chars per vertex, the last one is padding
+void mesh_quantize_normals(signed char *destination, const float *normals, size_t count);
+
+// 2 unsigned shorts per vertex, coordinates are clamped to [0, 1]
+void mesh_quantize_texcoords(unsigned short *destination, const float *texcoords, size_t count);
+
+#endif // MESHQUANTIZE_H
+
+#ifdef MESHQUANTIZE_IMPLEMENTATION
+
+#include <cmath>
+
+static int mesh_quantize_round(float v, int low, int high)
+{
+    auto q = (int)floorf(v + 0.5f);
+    return q < low ? low : (q > high ? high : q);
+}
+
+float mesh_quantize_scale(const float bounds[6])
+{
+    float extent = 0.0f;
+    for (int k = 0; k < 3; k++)
+    {
+        if (bounds[k + 3] - bounds[k] > extent) extent = bounds[k + 3] - bounds[k];
+    }
+    return extent > 0.0f ? extent / 65535.0f : 1.0f;
+}
+
+void mesh_quantize_positions(unsigned short *destination, const float *positions, size_t count, const float offset[3], float scale)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int k = 0; k < 3; k++) destination[i * 4 + k] = (unsigned short)mesh_quantize_round((positions[i * 3 + k] - offset[k]) / scale, 0, 65535);
+        destination[i * 4 + 3] = 0;
+    }
+}
+
+void mesh_quantize_normals(signed char *destination, const float *normals, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        auto n = &normals[i * 3];
+        float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        float s = length > 0.0f ? 127.0f / length : 0.0f;
+        for (int k = 0; k < 3; k++) destination[i * 4 + k] = (signed char)mesh_quantize_round(n[k] * s, -127, 127);
+        destination[i * 4 + 3] = 0;
+    }
+}
+
+void mesh_quantize_texcoords(unsigned short *destination, const float *texcoords, size_t count)
+{
+    for (size_t i = 0; i < count * 2; i++) destination[i] = (unsigned short)mesh_quantize_round(texcoords[i] * 65535.0f, 0, 65535);
+}
+
+#endif // MESHQUANTIZE_IMPLEMENTATION
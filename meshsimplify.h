@@ -0,0 +1,314 @@
+/* meshsimplify - v0.1 - public domain quadric error mesh simplification
+
+    Do this:
+        #define MESHSIMPLIFY_IMPLEMENTATION
+    before you include this file in *one* C or C++ file to create the implementation.
+
+    Reduces an indexed triangle list by collapsing edges onto existing vertices,
+    so the result is a new index list for the same vertex buffer. Collapses are
+    ordered by the quadric error of the positions (Garland/Heckbert) plus the
+    difference in attributes, weighted by `attributeWeight'. Vertices that share
+    a position but not their attributes (uv seams, hard normals) move together,
+    each onto the wedge with the closest attributes at the target position.
+    Vertices on open borders never move.
+
+    Errors are geometric only and relative to the size of the mesh, 0.01 is 1%
+    of its extent. The attribute difference just decides which collapse goes first.
+
+    Release notes:
+        v0.1    (2026-10-18)    initial version for level of detail chains in gltfscene
+
+LICENSE
+
+This software is in the public domain. Where that dedication is not
+recognized, you are granted a perpetual, irrevocable license to copy,
+distribute, and modify this file as you see fit.
+
+*/
+#ifndef MESHSIMPLIFY_H
+#define MESHSIMPLIFY_H
+
+#include <cstddef>
+
+// Writes at most indexCount indices to `destination' and returns how many were
+// written. Stops at targetIndexCount or when the next collapse would exceed
+// targetError. `attributes' has attributeCount floats per vertex and may be NULL.
+size_t mesh_simplify(unsigned int *destination, const unsigned int *indices, size_t indexCount,
+                     const float *positions, size_t vertexCount,
+                     const float *attributes, int attributeCount, float attributeWeight,
+                     size_t targetIndexCount, float targetError, float *resultError);
+
+#endif // MESHSIMPLIFY_H
+
+#ifdef MESHSIMPLIFY_IMPLEMENTATION
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <vector>
+
+typedef struct {
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+} MeshQuadric;
+
+typedef struct {
+    float cost;   // ordering, includes the attribute difference
+    float error;  // squared geometric error only
+    unsigned int from;  // position ids
+    unsigned int to;
+} MeshCollapse;
+
+static void mesh_quadric_add(MeshQuadric& q, const MeshQuadric& r)
+{
+    q.a2 += r.a2; q.ab += r.ab; q.ac += r.ac; q.ad += r.ad; q.b2 += r.b2;
+    q.bc += r.bc; q.bd += r.bd; q.c2 += r.c2; q.cd += r.cd; q.d2 += r.d2;
+}
+
+static double mesh_quadric_error(const MeshQuadric& q, const float *p)
+{
+    double x = p[0], y = p[1], z = p[2];
+    double e = q.a2 * x * x + q.b2 * y * y + q.c2 * z * z + q.d2
+             + 2.0 * (q.ab * x * y + q.ac * x * z + q.bc * y * z + q.ad * x + q.bd * y + q.cd * z);
+    return e > 0.0 ? e : 0.0;
+}
+
+static void mesh_triangle_normal(float n[3], const float *a, const float *b, const float *c)
+{
+    float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+static float mesh_attribute_distance(const float *attributes, int attributeCount, unsigned int a, unsigned int b)
+{
+    float d = 0.0f;
+    for (int k = 0; k < attributeCount; k++)
+    {
+        float e = attributes[a * attributeCount + k] - attributes[b * attributeCount + k];
+        d += e * e;
+    }
+    return d;
+}
+
+size_t mesh_simplify(unsigned int *destination, const unsigned int *indices, size_t indexCount,
+                     const float *positions, size_t vertexCount,
+                     const float *attributes, int attributeCount, float attributeWeight,
+                     size_t targetIndexCount, float targetError, float *resultError)
+{
+    if (resultError != NULL) *resultError = 0.0f;
+
+    // Positions scaled to the unit cube so errors do not depend on the model units
+    float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            lo[k] = std::min(lo[k], positions[v * 3 + k]);
+            hi[k] = std::max(hi[k], positions[v * 3 + k]);
+        }
+    }
+    float extent = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+    float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+    // Vertices with the same position are wedges of one position id
+    std::map<std::vector<float>, unsigned int> unique;
+    std::vector<unsigned int> positionIds(vertexCount);
+    std::vector<float> points;
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        std::vector<float> key(positions + v * 3, positions + v * 3 + 3);
+        auto found = unique.insert(std::make_pair(key, (unsigned int)unique.size()));
+        positionIds[v] = found.first->second;
+        if (found.second)
+        {
+            for (int k = 0; k < 3; k++) points.push_back((positions[v * 3 + k] - lo[k]) * scale);
+        }
+    }
+    auto positionCount = unique.size();
+
+    std::vector<unsigned int> wedgeOffsets(positionCount + 1, 0), wedges(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) wedgeOffsets[positionIds[v] + 1]++;
+    for (size_t p = 0; p < positionCount; p++) wedgeOffsets[p + 1] += wedgeOffsets[p];
+    {
+        std::vector<unsigned int> cursor(wedgeOffsets.begin(), wedgeOffsets.end() - 1);
+        for (size_t v = 0; v < vertexCount; v++) wedges[cursor[positionIds[v]]++] = (unsigned int)v;
+    }
+
+    std::vector<unsigned int> result(indices, indices + indexCount);
+    size_t triangleCount = indexCount / 3;
+    result.resize(triangleCount * 3);
+
+    // Plane quadrics, and borders from edges with a single triangle
+    std::vector<MeshQuadric> quadrics(positionCount);
+    memset(quadrics.data(), 0, quadrics.size() * sizeof(MeshQuadric));
+    std::map<std::pair<unsigned int, unsigned int>, int> edges;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        unsigned int p[3] = { positionIds[result[t * 3]], positionIds[result[t * 3 + 1]], positionIds[result[t * 3 + 2]] };
+        if (p[0] == p[1] || p[1] == p[2] || p[0] == p[2]) continue;
+
+        float n[3];
+        mesh_triangle_normal(n, &points[p[0] * 3], &points[p[1] * 3], &points[p[2] * 3]);
+        float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length > 0.0f)
+        {
+            double a = n[0] / length, b = n[1] / length, c = n[2] / length;
+            double d = -(a * points[p[0] * 3] + b * points[p[0] * 3 + 1] + c * points[p[0] * 3 + 2]);
+            MeshQuadric q = { a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d };
+            for (int k = 0; k < 3; k++) mesh_quadric_add(quadrics[p[k]], q);
+        }
+
+        for (int k = 0; k < 3; k++) edges[std::make_pair(std::min(p[k], p[(k + 1) % 3]), std::max(p[k], p[(k + 1) % 3]))]++;
+    }
+
+    std::vector<unsigned char> locked(positionCount, 0);
+    for (auto& edge : edges)
+    {
+        if (edge.second == 1) locked[edge.first.first] = locked[edge.first.second] = 1;
+    }
+
+    std::vector<unsigned int> triangleOffsets, triangles, collapseTo(positionCount), vertexRemap(vertexCount);
+    std::vector<unsigned char> touched(positionCount);
+    std::vector<MeshCollapse> collapses;
+    float maxError = 0.0f;
+    float errorLimit = targetError * targetError;
+
+    while (result.size() > targetIndexCount)
+    {
+        // Triangles around each position id
+        triangleCount = result.size() / 3;
+        triangleOffsets.assign(positionCount + 1, 0);
+        for (size_t i = 0; i < result.size(); i++) triangleOffsets[positionIds[result[i]] + 1]++;
+        for (size_t p = 0; p < positionCount; p++) triangleOffsets[p + 1] += triangleOffsets[p];
+        triangles.resize(result.size());
+        {
+            std::vector<unsigned int> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i++) triangles[cursor[positionIds[result[i]]]++] = (unsigned int)(i / 3);
+        }
+
+        collapses.clear();
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                auto from = positionIds[result[t * 3 + k]];
+                auto to = positionIds[result[t * 3 + (k + 1) % 3]];
+                for (int dir = 0; dir < 2; dir++, std::swap(from, to))
+                {
+                    if (locked[from]) continue;
+
+                    MeshQuadric q = quadrics[from];
+                    mesh_quadric_add(q, quadrics[to]);
+                    float error = (float)mesh_quadric_error(q, &points[to * 3]);
+                    if (error > errorLimit) continue;
+
+                    float cost = error;
+
+                    // Every wedge of `from' ends up on the closest wedge of `to'
+                    if (attributes != NULL && attributeWeight > 0.0f)
+                    {
+                        float attributeCost = 0.0f;
+                        for (auto w = wedgeOffsets[from]; w < wedgeOffsets[from + 1]; w++)
+                        {
+                            float best = FLT_MAX;
+                            for (auto u = wedgeOffsets[to]; u < wedgeOffsets[to + 1]; u++)
+                                best = std::min(best, mesh_attribute_distance(attributes, attributeCount, wedges[w], wedges[u]));
+                            attributeCost = std::max(attributeCost, best);
+                        }
+                        cost += attributeCost * attributeWeight;
+                    }
+
+                    MeshCollapse collapse = { cost, error, from, to };
+                    collapses.push_back(collapse);
+                }
+            }
+        }
+        if (collapses.empty()) break;
+
+        std::sort(collapses.begin(), collapses.end(), [] (const MeshCollapse& a, const MeshCollapse& b) { return a.cost < b.cost; });
+
+        for (size_t p = 0; p < positionCount; p++) collapseTo[p] = (unsigned int)p;
+        std::fill(touched.begin(), touched.end(), 0);
+
+        // Only independent collapses in one pass, the adjacency is rebuilt after
+        size_t removed = 0, needed = (result.size() - targetIndexCount + 2) / 3;
+        for (auto& collapse : collapses)
+        {
+            if (removed >= needed) break;
+            if (touched[collapse.from] || touched[collapse.to]) continue;
+
+            // Reject collapses that flip a triangle around `from'
+            bool flips = false;
+            size_t collapsing = 0;
+            for (auto i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1] && !flips; i++)
+            {
+                auto t = triangles[i];
+                unsigned int p[3] = { positionIds[result[t * 3]], positionIds[result[t * 3 + 1]], positionIds[result[t * 3 + 2]] };
+                if (p[0] == collapse.to || p[1] == collapse.to || p[2] == collapse.to)
+                {
+                    collapsing++;
+                    continue;
+                }
+
+                float before[3], after[3];
+                const float *corners[3];
+                for (int k = 0; k < 3; k++) corners[k] = &points[p[k] * 3];
+                mesh_triangle_normal(before, corners[0], corners[1], corners[2]);
+                for (int k = 0; k < 3; k++) if (p[k] == collapse.from) corners[k] = &points[collapse.to * 3];
+                mesh_triangle_normal(after, corners[0], corners[1], corners[2]);
+                flips = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0f;
+            }
+            if (flips) continue;
+
+            collapseTo[collapse.from] = collapse.to;
+            mesh_quadric_add(quadrics[collapse.to], quadrics[collapse.from]);
+            maxError = std::max(maxError, collapse.error);
+            removed += collapsing;
+
+            for (auto i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1]; i++)
+            {
+                auto t = triangles[i];
+                for (int k = 0; k < 3; k++) touched[positionIds[result[t * 3 + k]]] = 1;
+            }
+        }
+        if (removed == 0) break;
+
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            vertexRemap[v] = (unsigned int)v;
+            auto to = collapseTo[positionIds[v]];
+            if (to == positionIds[v]) continue;
+
+            float best = FLT_MAX;
+            for (auto u = wedgeOffsets[to]; u < wedgeOffsets[to + 1]; u++)
+            {
+                float d = attributes != NULL ? mesh_attribute_distance(attributes, attributeCount, (unsigned int)v, wedges[u]) : 0.0f;
+                if (d < best)
+                {
+                    best = d;
+                    vertexRemap[v] = wedges[u];
+                }
+            }
+        }
+
+        size_t write = 0;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            unsigned int v[3] = { vertexRemap[result[t * 3]], vertexRemap[result[t * 3 + 1]], vertexRemap[result[t * 3 + 2]] };
+            if (positionIds[v[0]] == positionIds[v[1]] || positionIds[v[1]] == positionIds[v[2]] || positionIds[v[0]] == positionIds[v[2]]) continue;
+
+            for (int k = 0; k < 3; k++) result[write++] = v[k];
+        }
+        result.resize(write);
+    }
+
+    if (resultError != NULL) *resultError = sqrtf(maxError);
+    std::copy(result.begin(), result.end(), destination);
+    return result.size();
+}
+
+#endif // MESHSIMPLIFY_IMPLEMENTATION
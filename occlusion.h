@@ -0,0 +1,288 @@
+/* occlusion - v0.1 - public domain software depth buffer for occlusion culling
+
+    Do this:
+        #define OCCLUSION_IMPLEMENTATION
+    before you include this file in *one* C or C++ file to create the implementation.
+
+    A small depth buffer on the cpu. Occluder triangles are rasterized into it
+    with a view projection matrix (column-major, see glmath.h), four pixels at a
+    time when SSE2 is available. Finish() then keeps the farthest depth of every
+    8x8 tile, so most box tests are decided on the tiles alone and only the
+    tiles that are not conclusive are checked pixel by pixel.
+
+    Depth is z/w mapped to [0, 1], smaller is closer. Nothing depends on a gl
+    context and the results do not depend on timing or threads, so the same
+    input always culls the same boxes.
+
+    Release notes:
+        v0.1    (2026-10-18)    initial version for occlusion culling in gltfscene
+
+LICENSE
+
+This software is in the public domain. Where that dedication is not
+recognized, you are granted a perpetual, irrevocable license to copy,
+distribute, and modify this file as you see fit.
+
+*/
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <cstddef>
+#include <vector>
+
+#define OCCLUSION_TILE_SIZE 8
+
+class OcclusionBuffer
+{
+    int _width;   // multiple of OCCLUSION_TILE_SIZE
+    int _height;
+    float _viewProjection[16];
+    std::vector<float> _depth;
+    std::vector<float> _tileMax;  // farthest depth in each tile, valid after Finish()
+
+    void rasterize(const float *a, const float *b, const float *c);
+public:
+    OcclusionBuffer();
+    virtual ~OcclusionBuffer();
+
+    void Setup(int width, int height);
+    void Clear(const float viewProjection[16]);
+    int RenderTriangles(const float *positions, const unsigned int *indices, size_t indexCount, const float model[16]);
+    void Finish();
+
+    // False when the box is hidden behind everything rendered so far
+    bool TestAabb(const float bounds[6]) const;
+
+    int Width() const;
+    int Height() const;
+    const float *Depth() const;
+};
+
+#endif // OCCLUSION_H
+
+#ifdef OCCLUSION_IMPLEMENTATION
+
+#include <algorithm>
+#include <cmath>
+
+#include "glmath.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SSE2
+#include <emmintrin.h>
+#endif
+
+OcclusionBuffer::OcclusionBuffer() : _width(0), _height(0) { mat4_identity(_viewProjection); }
+
+OcclusionBuffer::~OcclusionBuffer() { }
+
+void OcclusionBuffer::Setup(int width, int height)
+{
+    this->_width = std::max(1, (width + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE) * OCCLUSION_TILE_SIZE;
+    this->_height = std::max(1, (height + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE) * OCCLUSION_TILE_SIZE;
+    this->_depth.assign(this->_width * this->_height, 1.0f);
+    this->_tileMax.assign((this->_width / OCCLUSION_TILE_SIZE) * (this->_height / OCCLUSION_TILE_SIZE), 1.0f);
+}
+
+void OcclusionBuffer::Clear(const float viewProjection[16])
+{
+    mat4_copy(this->_viewProjection, viewProjection);
+    std::fill(this->_depth.begin(), this->_depth.end(), 1.0f);
+    std::fill(this->_tileMax.begin(), this->_tileMax.end(), 1.0f);
+}
+
+static void occlusion_transform(float out[4], const float m[16], const float *p)
+{
+    for (int k = 0; k < 4; k++) out[k] = m[k] * p[0] + m[4 + k] * p[1] + m[8 + k] * p[2] + m[12 + k];
+}
+
+// Screen position and depth of a clip space vertex in front of the near plane
+static void occlusion_project(float out[3], const float clip[4], int width, int height)
+{
+    out[0] = (clip[0] / clip[3] * 0.5f + 0.5f) * width;
+    out[1] = (clip[1] / clip[3] * 0.5f + 0.5f) * height;
+    out[2] = clip[2] / clip[3] * 0.5f + 0.5f;
+}
+
+int OcclusionBuffer::RenderTriangles(const float *positions, const unsigned int *indices, size_t indexCount, const float model[16])
+{
+    float mvp[16];
+    mat4_mul(mvp, this->_viewProjection, model);
+
+    int rendered = 0;
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        float clip[3][4];
+        for (int k = 0; k < 3; k++) occlusion_transform(clip[k], mvp, &positions[indices[i + k] * 3]);
+
+        // Skip triangles that are completely outside one of the side planes
+        bool outside = false;
+        for (int axis = 0; axis < 3 && !outside; axis++)
+        {
+            outside = (clip[0][axis] > clip[0][3] && clip[1][axis] > clip[1][3] && clip[2][axis] > clip[2][3]) ||
+                      (clip[0][axis] < -clip[0][3] && clip[1][axis] < -clip[1][3] && clip[2][axis] < -clip[2][3]);
+        }
+        if (outside) continue;
+
+        // Clip against the near plane (z = -w), the result is a triangle or a quad
+        float polygon[4][4];
+        int count = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            auto a = clip[k], b = clip[(k + 1) % 3];
+            float da = a[2] + a[3], db = b[2] + b[3];
+            if (da >= 0.0f) memcpy(polygon[count++], a, sizeof(float) * 4);
+            if ((da >= 0.0f) != (db >= 0.0f))
+            {
+                float t = da / (da - db);
+                for (int c = 0; c < 4; c++) polygon[count][c] = a[c] + (b[c] - a[c]) * t;
+                count++;
+            }
+        }
+        if (count < 3) continue;
+
+        float screen[4][3];
+        for (int k = 0; k < count; k++) occlusion_project(screen[k], polygon[k], this->_width, this->_height);
+        for (int k = 1; k + 1 < count; k++) rasterize(screen[0], screen[k], screen[k + 1]);
+        rendered++;
+    }
+    return rendered;
+}
+
+void OcclusionBuffer::rasterize(const float *a, const float *b, const float *c)
+{
+    float area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+    if (fabsf(area) < 1e-8f) return;
+
+    // Both windings are drawn, occluders may be double sided
+    if (area < 0.0f)
+    {
+        std::swap(b, c);
+        area = -area;
+    }
+
+    int minX = std::max(0, (int)floorf(std::min(a[0], std::min(b[0], c[0]))));
+    int maxX = std::min(this->_width - 1, (int)ceilf(std::max(a[0], std::max(b[0], c[0]))));
+    int minY = std::max(0, (int)floorf(std::min(a[1], std::min(b[1], c[1]))));
+    int maxY = std::min(this->_height - 1, (int)ceilf(std::max(a[1], std::max(b[1], c[1]))));
+    if (minX > maxX || minY > maxY) return;
+
+    // Edge functions for the edges opposite a, b and c, positive inside. They
+    // double as barycentric weights for the depth.
+    float ex[3] = { b[1] - c[1], c[1] - a[1], a[1] - b[1] };
+    float ey[3] = { c[0] - b[0], a[0] - c[0], b[0] - a[0] };
+    float e0[3] = { b[0] * c[1] - b[1] * c[0], c[0] * a[1] - c[1] * a[0], a[0] * b[1] - a[1] * b[0] };
+
+    float inverseArea = 1.0f / area;
+    float zx = (ex[0] * a[2] + ex[1] * b[2] + ex[2] * c[2]) * inverseArea;
+    float zy = (ey[0] * a[2] + ey[1] * b[2] + ey[2] * c[2]) * inverseArea;
+    float z0 = (e0[0] * a[2] + e0[1] * b[2] + e0[2] * c[2]) * inverseArea;
+
+    // Spans start on a multiple of four, pixels outside the triangle fail the edge test anyway
+    minX &= ~3;
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        float py = y + 0.5f;
+        float *row = &this->_depth[y * this->_width];
+
+#ifdef OCCLUSION_SSE2
+        const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        for (int x = minX; x <= maxX; x += 4)
+        {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+            __m128 w0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ex[0]), px), _mm_set1_ps(ey[0] * py + e0[0]));
+            __m128 w1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ex[1]), px), _mm_set1_ps(ey[1] * py + e0[1]));
+            __m128 w2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ex[2]), px), _mm_set1_ps(ey[2] * py + e0[2]));
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)), _mm_cmpge_ps(w2, zero));
+            if (_mm_movemask_ps(inside) == 0) continue;
+
+            __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zx), px), _mm_set1_ps(zy * py + z0));
+            __m128 depth = _mm_loadu_ps(&row[x]);
+            __m128 closer = _mm_and_ps(inside, _mm_and_ps(_mm_cmplt_ps(z, depth), _mm_cmpge_ps(z, zero)));
+            closer = _mm_and_ps(closer, _mm_cmple_ps(z, one));
+            _mm_storeu_ps(&row[x], _mm_or_ps(_mm_and_ps(closer, z), _mm_andnot_ps(closer, depth)));
+        }
+#else
+        for (int x = minX; x <= maxX && x < this->_width; x++)
+        {
+            float px = x + 0.5f;
+            if (ex[0] * px + ey[0] * py + e0[0] < 0.0f || ex[1] * px + ey[1] * py + e0[1] < 0.0f || ex[2] * px + ey[2] * py + e0[2] < 0.0f) continue;
+
+            float z = zx * px + zy * py + z0;
+            if (z >= 0.0f && z <= 1.0f && z < row[x]) row[x] = z;
+        }
+#endif
+    }
+}
+
+void OcclusionBuffer::Finish()
+{
+    auto tilesX = this->_width / OCCLUSION_TILE_SIZE;
+    for (size_t t = 0; t < this->_tileMax.size(); t++)
+    {
+        int tx = (int)(t % tilesX) * OCCLUSION_TILE_SIZE, ty = (int)(t / tilesX) * OCCLUSION_TILE_SIZE;
+        float farthest = 0.0f;
+        for (int y = ty; y < ty + OCCLUSION_TILE_SIZE; y++)
+        {
+            for (int x = tx; x < tx + OCCLUSION_TILE_SIZE; x++) farthest = std::max(farthest, this->_depth[y * this->_width + x]);
+        }
+        this->_tileMax[t] = farthest;
+    }
+}
+
+bool OcclusionBuffer::TestAabb(const float bounds[6]) const
+{
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, nearest = 1.0f;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        float p[3] = { bounds[(corner & 1) ? 3 : 0], bounds[(corner & 2) ? 4 : 1], bounds[(corner & 4) ? 5 : 2] };
+        float clip[4];
+        occlusion_transform(clip, this->_viewProjection, p);
+
+        // Boxes reaching through the near plane are never culled
+        if (clip[2] + clip[3] <= 0.0f) return true;
+
+        float screen[3];
+        occlusion_project(screen, clip, this->_width, this->_height);
+        minX = std::min(minX, screen[0]); maxX = std::max(maxX, screen[0]);
+        minY = std::min(minY, screen[1]); maxY = std::max(maxY, screen[1]);
+        nearest = std::min(nearest, screen[2]);
+    }
+    if (nearest <= 0.0f) return true;
+
+    int x0 = std::max(0, (int)floorf(minX)), x1 = std::min(this->_width - 1, (int)floorf(maxX));
+    int y0 = std::max(0, (int)floorf(minY)), y1 = std::min(this->_height - 1, (int)floorf(maxY));
+    if (x0 > x1 || y0 > y1) return true;  // off screen, that is for the frustum test to decide
+
+    auto tilesX = this->_width / OCCLUSION_TILE_SIZE;
+    for (int ty = y0 / OCCLUSION_TILE_SIZE; ty <= y1 / OCCLUSION_TILE_SIZE; ty++)
+    {
+        for (int tx = x0 / OCCLUSION_TILE_SIZE; tx <= x1 / OCCLUSION_TILE_SIZE; tx++)
+        {
+            if (this->_tileMax[ty * tilesX + tx] < nearest) continue;
+
+            // The tile has something farther away, check the pixels the box covers
+            int px0 = std::max(x0, tx * OCCLUSION_TILE_SIZE), px1 = std::min(x1, tx * OCCLUSION_TILE_SIZE + OCCLUSION_TILE_SIZE - 1);
+            int py0 = std::max(y0, ty * OCCLUSION_TILE_SIZE), py1 = std::min(y1, ty * OCCLUSION_TILE_SIZE + OCCLUSION_TILE_SIZE - 1);
+            for (int y = py0; y <= py1; y++)
+            {
+                for (int x = px0; x <= px1; x++)
+                {
+                    if (this->_depth[y * this->_width + x] >= nearest) return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+int OcclusionBuffer::Width() const { return this->_width; }
+
+int OcclusionBuffer::Height() const { return this->_height; }
+
+const float *OcclusionBuffer::Depth() const { return this->_depth.data(); }
+
+#endif // OCCLUSION_IMPLEMENTATION
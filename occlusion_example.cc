@@ -0,0 +1,58 @@
+#define OCCLUSION_IMPLEMENTATION
+#include "occlusion.h"
+#include "glmath.h"
+
+#include <cstdio>
+
+// Rasterizes a wall in front of the camera and checks which boxes it hides.
+// Needs no gl context, so it runs anywhere the occlusion buffer has to be trusted.
+
+typedef struct {
+    const char *name;
+    float bounds[6];
+    bool visible;
+} OcclusionCase;
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    // A 4x4 wall at z = 0, the camera looks at it from z = 5
+    float positions[] = { -2.0f, -2.0f, 0.0f, 2.0f, -2.0f, 0.0f, 2.0f, 2.0f, 0.0f, -2.0f, 2.0f, 0.0f };
+    unsigned int indices[] = { 0, 1, 2, 0, 2, 3 };
+
+    float projection[16], view[16], viewProjection[16], model[16];
+    float eye[3] = { 0.0f, 0.0f, 5.0f }, center[3] = { 0.0f, 0.0f, 0.0f }, up[3] = { 0.0f, 1.0f, 0.0f };
+    mat4_perspective(projection, 60.0f, 2.0f, 0.1f, 100.0f);
+    mat4_lookat(view, eye, center, up);
+    mat4_mul(viewProjection, projection, view);
+    mat4_identity(model);
+
+    OcclusionBuffer buffer;
+    buffer.Setup(256, 128);
+    buffer.Clear(viewProjection);
+    int rendered = buffer.RenderTriangles(positions, indices, 6, model);
+    buffer.Finish();
+
+    OcclusionCase cases[] = {
+        { "behind the wall", { -0.5f, -0.5f, -3.0f, 0.5f, 0.5f, -2.0f }, false },
+        { "far behind the wall", { -1.0f, -1.0f, -40.0f, 1.0f, 1.0f, -30.0f }, false },
+        { "beside the wall", { 5.0f, -0.5f, -3.0f, 6.0f, 0.5f, -2.0f }, true },
+        { "behind the edge of the wall", { 2.5f, -0.5f, -3.0f, 3.5f, 0.5f, -2.0f }, true },
+        { "in front of the wall", { -0.5f, -0.5f, 1.0f, 0.5f, 0.5f, 2.0f }, true },
+        { "through the wall", { -0.5f, -0.5f, -1.0f, 0.5f, 0.5f, 1.0f }, true },
+        { "around the camera", { -1.0f, -1.0f, 4.0f, 1.0f, 1.0f, 6.0f }, true },
+    };
+
+    int failed = rendered == 2 ? 0 : 1;
+    printf("%d of 2 occluder triangles rendered\n", rendered);
+    for (auto& c : cases)
+    {
+        bool visible = buffer.TestAabb(c.bounds);
+        printf("%-30s %-8s %s\n", c.name, visible ? "visible" : "hidden", visible == c.visible ? "ok" : "FAILED");
+        if (visible != c.visible) failed++;
+    }
+
+    return failed == 0 ? 0 : 1;
+}
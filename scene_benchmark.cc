@@ -0,0 +1,273 @@
+#define GLEXTL_IMPLEMENTATION
+#include <GL/glextl.h>
+
+// tiny_gltf.h is included by several of the headers below, its implementation
+// section has no guard so it is compiled here once on its own.
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#include "tiny_gltf.h"
+#undef TINYGLTF_IMPLEMENTATION
+#undef STB_IMAGE_IMPLEMENTATION
+
+#define ANIMCOMPRESS_IMPLEMENTATION
+#define GLSCENE_IMPLEMENTATION
+#define GLSTREAMBUFFER_IMPLEMENTATION
+#define GLTFACCESSOR_IMPLEMENTATION
+#define IMAGEMIP_IMPLEMENTATION
+#define KTX2_IMPLEMENTATION
+#define MESHOPTIMIZE_IMPLEMENTATION
+#define MESHQUANTIZE_IMPLEMENTATION
+#define MESHSIMPLIFY_IMPLEMENTATION
+#define OCCLUSION_IMPLEMENTATION
+#define SCENEANIMATION_IMPLEMENTATION
+#define SCENEBVH_IMPLEMENTATION
+#define SCENEGRAPH_IMPLEMENTATION
+#define TEXCOMPRESS_IMPLEMENTATION
+#define THREADPOOL_IMPLEMENTATION
+#include "gltfscene.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Headless timings of animation playback and of the scene update on a generated
+// crowd, so they can be compared between machines and changes:
+//
+//     scene_benchmark [characters] [joints] [keys] [threads]
+//
+// Every character is a root node with a chain of joints, each joint holding a
+// box. One animation moves every root and rotates every joint, that is
+// characters * (joints + 1) LINEAR channels of keys keys each.
+//
+// GLScene::Animate() and Cull() need no gl context, so the scene is loaded from
+// the generated model without Setup() and timed with 1 to threads threads.
+
+typedef std::chrono::steady_clock Clock;
+
+static double Seconds(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static int AddAccessor(tinygltf::Model& model, const void *data, size_t byteLength, int componentType, int type, size_t count, int target)
+{
+    auto& buffer = model.buffers[0];
+    while (buffer.data.size() % 4 != 0) buffer.data.push_back(0);
+
+    tinygltf::BufferView view;
+    view.buffer = 0;
+    view.byteOffset = buffer.data.size();
+    view.byteLength = byteLength;
+    view.target = target;
+    buffer.data.insert(buffer.data.end(), (const unsigned char *)data, (const unsigned char *)data + byteLength);
+    model.bufferViews.push_back(view);
+
+    tinygltf::Accessor accessor;
+    accessor.bufferView = (int)model.bufferViews.size() - 1;
+    accessor.byteOffset = 0;
+    accessor.componentType = componentType;
+    accessor.count = count;
+    accessor.type = type;
+    model.accessors.push_back(accessor);
+    return (int)model.accessors.size() - 1;
+}
+
+static void BuildCrowd(tinygltf::Model& model, int characters, int joints, int keys)
+{
+    model = tinygltf::Model();
+    model.buffers.resize(1);
+    model.defaultScene = 0;
+    model.scenes.resize(1);
+    model.animations.resize(1);
+
+    // A unit box for every joint
+    float positions[] = { -0.5f, 0.0f, -0.5f, 0.5f, 0.0f, -0.5f, 0.5f, 1.0f, -0.5f, -0.5f, 1.0f, -0.5f,
+                          -0.5f, 0.0f, 0.5f, 0.5f, 0.0f, 0.5f, 0.5f, 1.0f, 0.5f, -0.5f, 1.0f, 0.5f };
+    unsigned short indices[] = { 0, 2, 1, 0, 3, 2, 4, 5, 6, 4, 6, 7, 0, 1, 5, 0, 5, 4, 3, 6, 2, 3, 7, 6, 0, 4, 7, 0, 7, 3, 1, 2, 6, 1, 6, 5 };
+    auto position = AddAccessor(model, positions, sizeof(positions), TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, 8, TINYGLTF_TARGET_ARRAY_BUFFER);
+    model.accessors[position].minValues = { -0.5, 0.0, -0.5 };
+    model.accessors[position].maxValues = { 0.5, 1.0, 0.5 };
+    auto index = AddAccessor(model, indices, sizeof(indices), TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_SCALAR, 36,
+                             TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER);
+
+    tinygltf::Primitive primitive;
+    primitive.attributes["POSITION"] = position;
+    primitive.indices = index;
+    primitive.mode = TINYGLTF_MODE_TRIANGLES;
+    model.meshes.resize(1);
+    model.meshes[0].primitives.push_back(primitive);
+
+    // Two seconds at 60 keys per second by default, the joints swing and the roots bob
+    std::vector<float> times(keys), rotations(keys * 4), translations(keys * 3);
+    for (int k = 0; k < keys; k++)
+    {
+        times[k] = k / 60.0f;
+        auto phase = 6.2831853f * k / (keys - 1);
+        auto angle = 0.4f * sinf(phase);
+        rotations[k * 4 + 0] = 0.0f;
+        rotations[k * 4 + 1] = 0.0f;
+        rotations[k * 4 + 2] = sinf(angle * 0.5f);
+        rotations[k * 4 + 3] = cosf(angle * 0.5f);
+        translations[k * 3 + 0] = 0.0f;
+        translations[k * 3 + 1] = 0.1f * sinf(phase * 2.0f);
+        translations[k * 3 + 2] = 0.0f;
+    }
+    auto input = AddAccessor(model, times.data(), times.size() * sizeof(float), TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_SCALAR, keys, 0);
+    model.accessors[input].minValues = { times.front() };
+    model.accessors[input].maxValues = { times.back() };
+    auto rotation = AddAccessor(model, rotations.data(), rotations.size() * sizeof(float), TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC4, keys, 0);
+    auto translation = AddAccessor(model, translations.data(), translations.size() * sizeof(float), TINYGLTF_COMPONENT_TYPE_FLOAT,
+                                   TINYGLTF_TYPE_VEC3, keys, 0);
+
+    auto& animation = model.animations[0];
+    auto side = (int)ceilf(sqrtf((float)characters));
+    for (int c = 0; c < characters; c++)
+    {
+        tinygltf::Node root;
+        root.translation = { (c % side) * 2.0, 0.0, (c / side) * 2.0 };
+        model.scenes[0].nodes.push_back((int)model.nodes.size());
+        model.nodes.push_back(root);
+
+        for (int j = 0; j <= joints; j++)
+        {
+            auto node = (int)model.nodes.size() - 1;
+            if (j < joints)
+            {
+                tinygltf::Node joint;
+                joint.mesh = 0;
+                joint.translation = { 0.0, j == 0 ? 0.0 : 1.0, 0.0 };
+                joint.scale = { 0.9, 0.9, 0.9 };
+                model.nodes[node].children.push_back(node + 1);
+                model.nodes.push_back(joint);
+            }
+
+            tinygltf::AnimationSampler sampler;
+            sampler.input = input;
+            sampler.output = j == joints ? translation : rotation;
+            animation.samplers.push_back(sampler);
+
+            tinygltf::AnimationChannel channel;
+            channel.sampler = (int)animation.samplers.size() - 1;
+            channel.target_node = j == joints ? (int)model.nodes.size() - joints - 1 : node + 1;
+            channel.target_path = j == joints ? "translation" : "rotation";
+            animation.channels.push_back(channel);
+        }
+    }
+}
+
+// Forward playback at 60 frames per second, where the cached key cursors only step
+// ahead, then times spread over the whole clip, where they have to search
+static void BenchmarkPlayback(const tinygltf::Model& model, int frames)
+{
+    SceneGraph graph;
+    graph.Build(model, model.defaultScene);
+    graph.Update();
+
+    SceneAnimation animation;
+    auto channels = animation.Build(model);
+    auto start = animation.Start(0), length = animation.End(0) - start;
+    printf("%d channels, %d keys each\n", channels, (int)model.accessors[model.animations[0].samplers[0].input].count);
+
+    auto begin = Clock::now();
+    for (int f = 0; f < frames; f++) animation.Apply(0, start + fmodf(f / 60.0f, length), graph);
+    auto sequential = Seconds(begin);
+
+    unsigned int seed = 1;
+    begin = Clock::now();
+    for (int f = 0; f < frames; f++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        animation.Apply(0, start + length * (seed >> 8) / 16777216.0f, graph);
+    }
+    auto random = Seconds(begin);
+
+    printf("sequential playback  %8.3f ms per frame  %8.1f M channels/s\n", sequential * 1000.0 / frames, channels * frames / sequential / 1e6);
+    printf("random seeks         %8.3f ms per frame  %8.1f M channels/s\n", random * 1000.0 / frames, channels * frames / random / 1e6);
+}
+
+// Animate() and Cull() of the whole crowd in view, with a pool of threads - 1 workers
+static void BenchmarkUpdate(const tinygltf::Model& model, int threads, int frames, double *animate, double *cull)
+{
+    ThreadPool pool(threads - 1);
+    GLScene scene(pool);
+    scene.Load(model);
+
+    float bounds[6];
+    aabb_empty(bounds);
+    auto& graph = scene.Graph();
+    for (int n = 0; n < graph.NodeCount(); n++)
+    {
+        float point[6] = { graph.World(n)[12], graph.World(n)[13], graph.World(n)[14], graph.World(n)[12], graph.World(n)[13], graph.World(n)[14] };
+        aabb_merge(bounds, point);
+    }
+    float center[3] = { (bounds[0] + bounds[3]) * 0.5f, (bounds[1] + bounds[4]) * 0.5f, (bounds[2] + bounds[5]) * 0.5f };
+    float eye[3] = { center[0], center[1] + (bounds[3] - bounds[0]), center[2] + (bounds[5] - bounds[2]) * 1.5f + 10.0f };
+    float up[3] = { 0.0f, 1.0f, 0.0f };
+    float projection[16], view[16];
+    mat4_perspective(projection, 60.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+    mat4_lookat(view, eye, center, up);
+
+    auto& animation = scene.Animation();
+    auto start = animation.Start(0), length = animation.End(0) - start;
+    *animate = 0.0;
+    *cull = 0.0;
+    for (int f = -10; f < frames; f++)
+    {
+        auto begin = Clock::now();
+        scene.Animate(0, start + fmodf((f + 10) / 60.0f, length));
+        auto animated = Seconds(begin);
+
+        begin = Clock::now();
+        scene.Cull(projection, view);
+        auto culled = Seconds(begin);
+
+        // The first frames fill the caches and wake the workers
+        if (f < 0) continue;
+        *animate += animated;
+        *cull += culled;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int characters = argc > 1 ? atoi(argv[1]) : 512;
+    int joints = argc > 2 ? atoi(argv[2]) : 24;
+    int keys = argc > 3 ? atoi(argv[3]) : 120;
+    int threads = argc > 4 ? atoi(argv[4]) : (int)std::thread::hardware_concurrency();
+    if (characters < 1 || joints < 1 || keys < 2)
+    {
+        printf("Usage: %s [characters] [joints] [keys] [threads]\n", argv[0]);
+        return 1;
+    }
+    if (threads < 1) threads = 1;
+
+    tinygltf::Model model;
+    BuildCrowd(model, characters, joints, keys);
+    printf("%d characters of %d joints\n", characters, joints);
+
+    BenchmarkPlayback(model, 1000);
+
+    // Doubling up to the hardware, and the hardware itself
+    std::vector<int> counts;
+    for (int t = 1; t < threads; t *= 2) counts.push_back(t);
+    counts.push_back(threads);
+
+    const int frames = 200;
+    double serial = 0.0;
+    printf("\nthreads  Animate() ms  Cull() ms  frame ms  speedup  efficiency\n");
+    for (auto t : counts)
+    {
+        double animate, cull;
+        BenchmarkUpdate(model, t, frames, &animate, &cull);
+        auto frame = (animate + cull) / frames;
+        if (t == 1) serial = frame;
+        printf("%7d  %12.3f  %9.3f  %8.3f  %6.2fx  %9.0f%%\n", t, animate * 1000.0 / frames, cull * 1000.0 / frames, frame * 1000.0,
+               serial / frame, serial / frame / t * 100.0);
+    }
+    return 0;
+}
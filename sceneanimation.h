@@ -0,0 +1,663 @@
+/* sceneanimation - v0.6 - public domain gltf animation playback onto a scenegraph
+
+    Do this:
+        #define SCENEANIMATION_IMPLEMENTATION
+    before you include this file in *one* C or C++ file to create the implementation.
+
+    Build() copies the keyframes of all animation samplers into two float
+    arrays, one for key times and one for values, so sampling never goes
+    through accessors. Samplers sharing an input accessor share its keys.
+
+    Apply() samples every channel of an animation at a time and writes the
+    result straight into the local translation, rotation, scale or morph
+    target weights of the target node in a SceneGraph, which flags it dirty. Each channel remembers
+    the key interval it used last, playing forward usually finds the next
+    one in a step or two, jumps fall back to a binary search.
+
+    LINEAR rotations use slerp, CUBICSPLINE uses the Hermite form from the
+    glTF specification and normalizes rotations afterwards. Time outside the
+    keys clamps to the first or last value. A "weights" sampler has one
+    value per morph target for every key, channels whose count does not
+    match the weights of the node in the graph are skipped.
+
+    Partition() groups the channels of every animation by the subtree of the
+    scene graph their node is in. Groups write to different nodes and have
+    their own cursors, so ApplyGroup() may run for several groups of one
+    animation on different threads at once. Until then every animation is
+    one group. Exclude() drops the channels of nodes nothing depends on any
+    more, such as the joints of skins that play baked vertex animations.
+
+    For level of detail, SetOptional() marks the channels of nodes that can
+    be left out at a distance, such as the leaf joints of a skin, and the
+    group functions skip them unless optional is true. A group can also be
+    sampled less often: TargetGroup() keeps what the graph shows as the start
+    pose and samples the group at a later time as the end pose, then
+    BlendGroup() moves the graph between the two, which costs a lerp or slerp
+    per channel instead of a sample.
+
+    Compress() converts the keys at load time: LINEAR samplers drop the keys
+    that interpolation reproduces within a tolerance, then LINEAR and STEP
+    values are stored as 16 bit integers, rotations as their smallest three
+    components and everything else relative to the range of its track.
+    sample() decodes the two keys around the time in place, a compressed
+    sampler reads 6 or 2 * components shorts per sample from one array.
+    CUBICSPLINE samplers stay float, and so do tracks of 4 keys or less
+    other than rotations, whose range would take more than quantizing saves.
+    Rotations have no range and are always quantized.
+
+    The implementation calls into gltfaccessor, scenegraph and animcompress,
+    include gltfaccessor.h, scenegraph.h and animcompress.h before this file.
+
+    Release notes:
+        v0.1    (2026-10-18)    initial version for animation playback in gltfscene
+        v0.2    (2026-10-18)    "weights" channels write morph target weights
+        v0.3    (2026-10-18)    channels grouped per scene graph subtree, groups applied independently
+        v0.4    (2026-10-18)    Compress(), reduced keys and quantized values decoded while sampling
+        v0.5    (2026-10-18)    Exclude() leaves channels out of playback
+        v0.6    (2026-10-18)    optional channels, TargetGroup() and BlendGroup() for throttled playback
+
+LICENSE
+
+This software is in the public domain. Where that dedication is not
+recognized, you are granted a perpetual, irrevocable license to copy,
+distribute, and modify this file as you see fit.
+
+*/
+#ifndef SCENEANIMATION_H
+#define SCENEANIMATION_H
+
+#include <string>
+#include <vector>
+
+#include "tiny_gltf.h"
+
+class SceneGraph;
+
+#define SCENEANIMATION_STEP 0
+#define SCENEANIMATION_LINEAR 1
+#define SCENEANIMATION_CUBICSPLINE 2
+
+#define SCENEANIMATION_TRANSLATION 0
+#define SCENEANIMATION_ROTATION 1
+#define SCENEANIMATION_SCALE 2
+#define SCENEANIMATION_WEIGHTS 3
+
+class SceneAnimation
+{
+    typedef struct {
+        int firstKey;       // in _keys
+        int keyCount;
+        int firstValue;     // in _values, 3 values per key for CUBICSPLINE, in _quantized when quantized
+        int components;     // 3 or 4, the number of morph targets for weights
+        int interpolation;
+        int path;
+        bool quantized;     // 3 shorts per rotation, components shorts per key otherwise
+        int firstRange;     // in _ranges, offsets then scales of the components, -1 for rotations
+    } Sampler;
+
+    typedef struct {
+        int sampler;
+        int node;
+        int path;
+        int cursor;     // key interval of the last sample
+        bool optional;  // skipped at a lower level of detail
+        int firstPose;  // in _poses, start and end pose of TargetGroup()
+    } Channel;
+
+    typedef struct {
+        int firstChannel;
+        int channelCount;
+    } Group;
+
+    typedef struct {
+        std::string name;
+        int firstChannel;
+        int channelCount;
+        int firstGroup;     // in _groups
+        int groupCount;
+        float start;
+        float end;
+    } Clip;
+
+    std::vector<float> _keys;
+    std::vector<float> _values;
+    std::vector<unsigned short> _quantized;
+    std::vector<float> _ranges;
+    std::vector<Sampler> _samplers;
+    std::vector<Channel> _channels;
+    std::vector<Group> _groups;
+    std::vector<Clip> _clips;
+    std::vector<float> _poses;
+
+    void decode(const Sampler& sampler, int key, float *out) const;
+    void sample(const Sampler& sampler, int& cursor, float time, float *out) const;
+public:
+    SceneAnimation();
+    virtual ~SceneAnimation();
+
+    // Returns the number of channels that can be played, invalid ones are left out
+    int Build(const tinygltf::Model& model);
+
+    int AnimationCount() const;
+    const std::string& Name(int animation) const;
+    float Start(int animation) const;
+    float End(int animation) const;
+    int ChannelCount(int animation) const;
+
+    // Regroups the channels after the graph is built, returns the number of groups
+    int Partition(const SceneGraph& graph);
+    int GroupCount(int animation) const;
+
+    // Leaves out the channels whose bit 1 << path is set in paths[node] and regroups the
+    // rest, returns the number left out. Start() and End() stay as they were.
+    int Exclude(const std::vector<unsigned char>& paths, const SceneGraph& graph);
+
+    // Marks the channels of nodes with a non-zero entry optional, returns how many there are
+    int SetOptional(const std::vector<unsigned char>& nodes);
+    int GroupNode(int animation, int group) const;  // target of the first channel, -1 for an empty group
+
+    // Reduces and quantizes the keys after Build(), tolerance in the units of the values and
+    // angleTolerance in radians for rotations, returns the number of keys left
+    int Compress(float tolerance, float angleTolerance);
+    size_t ByteSize() const;  // of the keys and values
+
+    void Apply(int animation, float time, SceneGraph& graph);
+    void ApplyGroup(int animation, int group, float time, SceneGraph& graph, bool optional = true);
+
+    // Throttled playback of a group, t of BlendGroup() goes from 0 at the start pose to 1 at the end pose
+    void TargetGroup(int animation, int group, float time, SceneGraph& graph, bool optional = true);
+    void BlendGroup(int animation, int group, float t, SceneGraph& graph, bool optional = true);
+};
+
+#endif // SCENEANIMATION_H
+
+#ifdef SCENEANIMATION_IMPLEMENTATION
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+SceneAnimation::SceneAnimation() { }
+
+SceneAnimation::~SceneAnimation() { }
+
+int SceneAnimation::Build(const tinygltf::Model& model)
+{
+    this->_keys.clear();
+    this->_values.clear();
+    this->_quantized.clear();
+    this->_ranges.clear();
+    this->_samplers.clear();
+    this->_channels.clear();
+    this->_groups.clear();
+    this->_clips.clear();
+    this->_poses.clear();
+
+    std::map<int, int> inputKeys;  // input accessor to first key
+    std::vector<float> floats;
+    for (auto& animation : model.animations)
+    {
+        Clip clip = { animation.name, (int)this->_channels.size(), 0, (int)this->_groups.size(), 1, 0.0f, 0.0f };
+        std::map<int, int> samplers;  // animation sampler to index in _samplers
+        for (auto& channel : animation.channels)
+        {
+            int path = -1;
+            if (channel.target_path == "translation") path = SCENEANIMATION_TRANSLATION;
+            else if (channel.target_path == "rotation") path = SCENEANIMATION_ROTATION;
+            else if (channel.target_path == "scale") path = SCENEANIMATION_SCALE;
+            else if (channel.target_path == "weights") path = SCENEANIMATION_WEIGHTS;
+            if (path < 0 || channel.target_node < 0 || channel.target_node >= (int)model.nodes.size()) continue;
+            if (channel.sampler < 0 || channel.sampler >= (int)animation.samplers.size()) continue;
+
+            auto found = samplers.find(channel.sampler);
+            if (found == samplers.end())
+            {
+                auto& source = animation.samplers[channel.sampler];
+                if (source.input < 0 || source.input >= (int)model.accessors.size()) continue;
+                if (source.output < 0 || source.output >= (int)model.accessors.size()) continue;
+
+                auto& input = model.accessors[source.input];
+                auto& output = model.accessors[source.output];
+
+                Sampler sampler;
+                sampler.keyCount = (int)input.count;
+                sampler.components = path == SCENEANIMATION_ROTATION ? 4 : 3;
+                sampler.interpolation = SCENEANIMATION_LINEAR;
+                sampler.path = path;
+                sampler.quantized = false;
+                sampler.firstRange = -1;
+                if (source.interpolation == "STEP") sampler.interpolation = SCENEANIMATION_STEP;
+                else if (source.interpolation == "CUBICSPLINE") sampler.interpolation = SCENEANIMATION_CUBICSPLINE;
+
+                auto valuesPerKey = sampler.interpolation == SCENEANIMATION_CUBICSPLINE ? 3 : 1;
+                if (sampler.keyCount == 0) continue;
+
+                // Weights are scalars, all targets of a key one after the other
+                if (path == SCENEANIMATION_WEIGHTS)
+                {
+                    sampler.components = (int)(output.count / (input.count * valuesPerKey));
+                    if (output.type != TINYGLTF_TYPE_SCALAR || sampler.components == 0 ||
+                        output.count != input.count * valuesPerKey * sampler.components) continue;
+                }
+                else if (accessor_component_count(output.type) != sampler.components || output.count != input.count * valuesPerKey)
+                {
+                    continue;
+                }
+
+                auto keys = inputKeys.find(source.input);
+                if (keys == inputKeys.end())
+                {
+                    if (!accessor_read_floats(model, input, false, floats)) continue;
+
+                    keys = inputKeys.insert(std::make_pair(source.input, (int)this->_keys.size())).first;
+                    this->_keys.insert(this->_keys.end(), floats.begin(), floats.end());
+                }
+                sampler.firstKey = keys->second;
+
+                if (!accessor_read_floats(model, output, output.normalized, floats)) continue;
+
+                sampler.firstValue = (int)this->_values.size();
+                this->_values.insert(this->_values.end(), floats.begin(), floats.end());
+
+                found = samplers.insert(std::make_pair(channel.sampler, (int)this->_samplers.size())).first;
+                this->_samplers.push_back(sampler);
+            }
+
+            auto& sampler = this->_samplers[found->second];
+            if (sampler.path != path) continue;
+
+            Channel c = { found->second, channel.target_node, path, 0, false, (int)this->_poses.size() };
+            this->_channels.push_back(c);
+            this->_poses.resize(this->_poses.size() + sampler.components * 2, 0.0f);
+
+            float start = this->_keys[sampler.firstKey], end = this->_keys[sampler.firstKey + sampler.keyCount - 1];
+            if (clip.channelCount == 0 || start < clip.start) clip.start = start;
+            if (clip.channelCount == 0 || end > clip.end) clip.end = end;
+            clip.channelCount++;
+        }
+        Group group = { clip.firstChannel, clip.channelCount };
+        this->_groups.push_back(group);
+        this->_clips.push_back(clip);
+    }
+    return (int)this->_channels.size();
+}
+
+int SceneAnimation::AnimationCount() const { return (int)this->_clips.size(); }
+
+const std::string& SceneAnimation::Name(int animation) const { return this->_clips[animation].name; }
+
+float SceneAnimation::Start(int animation) const { return this->_clips[animation].start; }
+
+float SceneAnimation::End(int animation) const { return this->_clips[animation].end; }
+
+int SceneAnimation::ChannelCount(int animation) const { return this->_clips[animation].channelCount; }
+
+int SceneAnimation::Partition(const SceneGraph& graph)
+{
+    // Nodes outside the graph or the scene form one more group, Apply() skips the former
+    auto subtree = [&graph] (const Channel& channel)
+    {
+        return channel.node < graph.NodeCount() ? graph.Subtree(channel.node) : -1;
+    };
+
+    this->_groups.clear();
+    for (auto& clip : this->_clips)
+    {
+        auto first = this->_channels.begin() + clip.firstChannel;
+        std::stable_sort(first, first + clip.channelCount, [&subtree] (const Channel& a, const Channel& b) { return subtree(a) < subtree(b); });
+
+        clip.firstGroup = (int)this->_groups.size();
+        clip.groupCount = 0;
+        for (int c = clip.firstChannel; c < clip.firstChannel + clip.channelCount; c++)
+        {
+            if (clip.groupCount == 0 || subtree(this->_channels[c]) != subtree(this->_channels[c - 1]))
+            {
+                Group group = { c, 0 };
+                this->_groups.push_back(group);
+                clip.groupCount++;
+            }
+            this->_groups.back().channelCount++;
+        }
+    }
+    return (int)this->_groups.size();
+}
+
+int SceneAnimation::GroupCount(int animation) const { return this->_clips[animation].groupCount; }
+
+int SceneAnimation::Exclude(const std::vector<unsigned char>& paths, const SceneGraph& graph)
+{
+    int excluded = 0;
+    size_t kept = 0;
+    for (auto& clip : this->_clips)
+    {
+        auto first = kept;
+        for (int c = clip.firstChannel; c < clip.firstChannel + clip.channelCount; c++)
+        {
+            auto& channel = this->_channels[c];
+            if (channel.node < (int)paths.size() && (paths[channel.node] & (1 << channel.path)) != 0)
+            {
+                excluded++;
+                continue;
+            }
+            this->_channels[kept++] = channel;
+        }
+        clip.firstChannel = (int)first;
+        clip.channelCount = (int)(kept - first);
+    }
+    this->_channels.resize(kept);
+
+    Partition(graph);
+    return excluded;
+}
+
+int SceneAnimation::SetOptional(const std::vector<unsigned char>& nodes)
+{
+    int count = 0;
+    for (auto& channel : this->_channels)
+    {
+        channel.optional = channel.node < (int)nodes.size() && nodes[channel.node] != 0;
+        if (channel.optional) count++;
+    }
+    return count;
+}
+
+int SceneAnimation::GroupNode(int animation, int group) const
+{
+    auto& g = this->_groups[this->_clips[animation].firstGroup + group];
+    return g.channelCount > 0 ? this->_channels[g.firstChannel].node : -1;
+}
+
+int SceneAnimation::Compress(float tolerance, float angleTolerance)
+{
+    std::vector<float> keys, values;
+    std::vector<unsigned short> quantized;
+    std::map<int, int> sharedKeys;  // first key of samplers keeping all their keys, to the new first key
+    std::vector<unsigned char> keep;
+    std::vector<float> kept;
+    int keyCount = 0;
+    for (auto& sampler : this->_samplers)
+    {
+        auto n = sampler.components;
+        auto rotation = sampler.path == SCENEANIMATION_ROTATION;
+        auto source = sampler.quantized ? NULL : &this->_values[sampler.firstValue];
+        auto count = sampler.keyCount;
+
+        keep.assign(count, 1);
+        if (sampler.interpolation == SCENEANIMATION_LINEAR && !sampler.quantized && count > 2)
+        {
+            count = anim_reduce_keys(keep.data(), &this->_keys[sampler.firstKey], source, count, n, rotation, rotation ? angleTolerance : tolerance);
+        }
+
+        // Samplers keeping all keys of an input still share them
+        auto shared = sharedKeys.find(sampler.firstKey);
+        if (count == sampler.keyCount && shared != sharedKeys.end())
+        {
+            sampler.firstKey = shared->second;
+        }
+        else
+        {
+            if (count == sampler.keyCount) sharedKeys[sampler.firstKey] = (int)keys.size();
+            auto first = (int)keys.size();
+            for (int i = 0; i < sampler.keyCount; i++)
+            {
+                if (keep[i]) keys.push_back(this->_keys[sampler.firstKey + i]);
+            }
+            sampler.firstKey = first;
+        }
+        keyCount += count;
+
+        // Quantized samplers are from an earlier Compress() and stay as they are
+        if (sampler.quantized)
+        {
+            auto first = &this->_quantized[sampler.firstValue];
+            sampler.firstValue = (int)quantized.size();
+            quantized.insert(quantized.end(), first, first + sampler.keyCount * (rotation ? 3 : n));
+            continue;
+        }
+        if (sampler.interpolation == SCENEANIMATION_CUBICSPLINE)
+        {
+            sampler.firstValue = (int)values.size();
+            values.insert(values.end(), source, source + sampler.keyCount * n * 3);
+            continue;
+        }
+
+        kept.clear();
+        for (int i = 0; i < sampler.keyCount; i++)
+        {
+            if (keep[i]) kept.insert(kept.end(), &source[i * n], &source[(i + 1) * n]);
+        }
+        sampler.keyCount = count;
+
+        // The range of a track takes 4 floats per component, short tracks are smaller as they are
+        if (!rotation && count <= 4)
+        {
+            sampler.firstValue = (int)values.size();
+            values.insert(values.end(), kept.begin(), kept.end());
+            continue;
+        }
+
+        sampler.firstValue = (int)quantized.size();
+        if (rotation)
+        {
+            quantized.resize(quantized.size() + count * 3);
+            for (int i = 0; i < count; i++) anim_quantize_rotation(&quantized[sampler.firstValue + i * 3], &kept[i * 4]);
+        }
+        else
+        {
+            sampler.firstRange = (int)this->_ranges.size();
+            this->_ranges.resize(this->_ranges.size() + n * 2);
+            anim_quantize_range(&this->_ranges[sampler.firstRange], &this->_ranges[sampler.firstRange + n], kept.data(), count, n);
+
+            quantized.resize(quantized.size() + count * n);
+            anim_quantize_values(&quantized[sampler.firstValue], kept.data(), count, n, &this->_ranges[sampler.firstRange], &this->_ranges[sampler.firstRange + n]);
+        }
+        sampler.quantized = true;
+    }
+
+    this->_keys.swap(keys);
+    this->_values.swap(values);
+    this->_quantized.swap(quantized);
+    this->_keys.shrink_to_fit();
+    this->_values.shrink_to_fit();
+    this->_quantized.shrink_to_fit();
+
+    // Key intervals changed
+    for (auto& channel : this->_channels) channel.cursor = 0;
+
+    return keyCount;
+}
+
+size_t SceneAnimation::ByteSize() const
+{
+    return (this->_keys.size() + this->_values.size() + this->_ranges.size()) * sizeof(float) + this->_quantized.size() * sizeof(unsigned short);
+}
+
+void SceneAnimation::decode(const Sampler& sampler, int key, float *out) const
+{
+    if (sampler.path == SCENEANIMATION_ROTATION)
+    {
+        anim_dequantize_rotation(out, &this->_quantized[sampler.firstValue + key * 3]);
+        return;
+    }
+
+    auto n = sampler.components;
+    auto q = &this->_quantized[sampler.firstValue + key * n];
+    auto offset = &this->_ranges[sampler.firstRange], scale = offset + n;
+    for (int k = 0; k < n; k++) out[k] = offset[k] + q[k] * scale[k];
+}
+
+void SceneAnimation::sample(const Sampler& sampler, int& cursor, float time, float *out) const
+{
+    auto keys = &this->_keys[sampler.firstKey];
+    auto values = sampler.quantized ? NULL : &this->_values[sampler.firstValue];
+    auto n = sampler.components;
+    auto rotation = sampler.path == SCENEANIMATION_ROTATION;
+    auto cubic = sampler.interpolation == SCENEANIMATION_CUBICSPLINE;
+    auto last = sampler.keyCount - 1;
+
+    // Values of a CUBICSPLINE key are in-tangent, value, out-tangent
+    if (last == 0 || time <= keys[0] || time >= keys[last])
+    {
+        auto key = last == 0 || time <= keys[0] ? 0 : last;
+        if (sampler.quantized)
+        {
+            decode(sampler, key, out);
+            return;
+        }
+        auto value = cubic ? &values[(key * 3 + 1) * n] : &values[key * n];
+        for (int k = 0; k < n; k++) out[k] = value[k];
+        return;
+    }
+
+    // Playing forward, the time is in the cached interval or one of the next few
+    if (cursor < 0 || cursor >= last || time < keys[cursor]) cursor = -1;
+    for (int step = 0; cursor >= 0 && step < 4 && time >= keys[cursor + 1]; step++) cursor++;
+    if (cursor < 0 || time >= keys[cursor + 1]) cursor = (int)(std::upper_bound(keys, keys + last + 1, time) - keys) - 1;
+
+    auto i = cursor;
+    float dt = keys[i + 1] - keys[i];
+    float t = (time - keys[i]) / dt;
+
+    if (sampler.interpolation == SCENEANIMATION_STEP)
+    {
+        if (sampler.quantized)
+            decode(sampler, i, out);
+        else
+            for (int k = 0; k < n; k++) out[k] = values[i * n + k];
+    }
+    else if (sampler.quantized && rotation)
+    {
+        float a[4], b[4];
+        decode(sampler, i, a);
+        decode(sampler, i + 1, b);
+        anim_slerp(out, a, b, t);
+    }
+    else if (sampler.quantized)
+    {
+        // Interpolating the integers is interpolating the values, the range is linear
+        auto a = &this->_quantized[sampler.firstValue + i * n], b = a + n;
+        auto offset = &this->_ranges[sampler.firstRange], scale = offset + n;
+        for (int k = 0; k < n; k++) out[k] = offset[k] + (a[k] + ((float)b[k] - a[k]) * t) * scale[k];
+    }
+    else if (!cubic)
+    {
+        auto a = &values[i * n], b = &values[(i + 1) * n];
+        if (rotation)
+            anim_slerp(out, a, b, t);
+        else
+            for (int k = 0; k < n; k++) out[k] = a[k] + (b[k] - a[k]) * t;
+    }
+    else
+    {
+        float t2 = t * t, t3 = t2 * t;
+        float h00 = 2.0f * t3 - 3.0f * t2 + 1.0f, h10 = t3 - 2.0f * t2 + t, h01 = -2.0f * t3 + 3.0f * t2, h11 = t3 - t2;
+        auto p0 = &values[(i * 3 + 1) * n], m0 = &values[(i * 3 + 2) * n];
+        auto p1 = &values[((i + 1) * 3 + 1) * n], m1 = &values[(i + 1) * 3 * n];
+        float length = 0.0f;
+        for (int k = 0; k < n; k++)
+        {
+            out[k] = h00 * p0[k] + h10 * dt * m0[k] + h01 * p1[k] + h11 * dt * m1[k];
+            length += out[k] * out[k];
+        }
+        if (rotation && length > 0.0f)
+        {
+            length = 1.0f / sqrtf(length);
+            for (int k = 0; k < 4; k++) out[k] *= length;
+        }
+    }
+}
+
+void SceneAnimation::Apply(int animation, float time, SceneGraph& graph)
+{
+    if (animation < 0 || animation >= (int)this->_clips.size()) return;
+
+    for (int g = 0; g < this->_clips[animation].groupCount; g++) ApplyGroup(animation, g, time, graph);
+}
+
+void SceneAnimation::ApplyGroup(int animation, int group, float time, SceneGraph& graph, bool optional)
+{
+    if (animation < 0 || animation >= (int)this->_clips.size() || group < 0 || group >= this->_clips[animation].groupCount) return;
+
+    auto& g = this->_groups[this->_clips[animation].firstGroup + group];
+    for (int c = g.firstChannel; c < g.firstChannel + g.channelCount; c++)
+    {
+        auto& channel = this->_channels[c];
+        if (channel.node >= graph.NodeCount() || (channel.optional && !optional)) continue;
+
+        auto& sampler = this->_samplers[channel.sampler];
+        if (channel.path == SCENEANIMATION_WEIGHTS)
+        {
+            if (graph.WeightCount(channel.node) != sampler.components) continue;
+
+            sample(sampler, channel.cursor, time, graph.Weights(channel.node));
+            graph.MarkWeightsDirty(channel.node);
+            continue;
+        }
+
+        float *target = NULL;
+        if (channel.path == SCENEANIMATION_TRANSLATION) target = graph.Translation(channel.node);
+        else if (channel.path == SCENEANIMATION_ROTATION) target = graph.Rotation(channel.node);
+        else target = graph.Scale(channel.node);
+
+        sample(sampler, channel.cursor, time, target);
+        graph.MarkDirty(channel.node);
+    }
+}
+
+// The value of a channel in the graph, NULL when it does not fit the sampler
+static float *scene_animation_target(SceneGraph& graph, int node, int path, int components)
+{
+    if (path == SCENEANIMATION_WEIGHTS) return graph.WeightCount(node) == components ? graph.Weights(node) : NULL;
+    if (path == SCENEANIMATION_TRANSLATION) return graph.Translation(node);
+    if (path == SCENEANIMATION_ROTATION) return graph.Rotation(node);
+    return graph.Scale(node);
+}
+
+void SceneAnimation::TargetGroup(int animation, int group, float time, SceneGraph& graph, bool optional)
+{
+    if (animation < 0 || animation >= (int)this->_clips.size() || group < 0 || group >= this->_clips[animation].groupCount) return;
+
+    auto& g = this->_groups[this->_clips[animation].firstGroup + group];
+    for (int c = g.firstChannel; c < g.firstChannel + g.channelCount; c++)
+    {
+        auto& channel = this->_channels[c];
+        if (channel.node >= graph.NodeCount() || (channel.optional && !optional)) continue;
+
+        auto& sampler = this->_samplers[channel.sampler];
+        auto target = scene_animation_target(graph, channel.node, channel.path, sampler.components);
+        if (target == NULL) continue;
+
+        auto pose = &this->_poses[channel.firstPose];
+        for (int k = 0; k < sampler.components; k++) pose[k] = target[k];
+        sample(sampler, channel.cursor, time, pose + sampler.components);
+    }
+}
+
+void SceneAnimation::BlendGroup(int animation, int group, float t, SceneGraph& graph, bool optional)
+{
+    if (animation < 0 || animation >= (int)this->_clips.size() || group < 0 || group >= this->_clips[animation].groupCount) return;
+
+    auto& g = this->_groups[this->_clips[animation].firstGroup + group];
+    for (int c = g.firstChannel; c < g.firstChannel + g.channelCount; c++)
+    {
+        auto& channel = this->_channels[c];
+        if (channel.node >= graph.NodeCount() || (channel.optional && !optional)) continue;
+
+        auto& sampler = this->_samplers[channel.sampler];
+        auto target = scene_animation_target(graph, channel.node, channel.path, sampler.components);
+        if (target == NULL) continue;
+
+        auto a = &this->_poses[channel.firstPose], b = a + sampler.components;
+        if (channel.path == SCENEANIMATION_ROTATION)
+            anim_slerp(target, a, b, t);
+        else
+            for (int k = 0; k < sampler.components; k++) target[k] = a[k] + (b[k] - a[k]) * t;
+
+        if (channel.path == SCENEANIMATION_WEIGHTS)
+            graph.MarkWeightsDirty(channel.node);
+        else
+            graph.MarkDirty(channel.node);
+    }
+}
+
+#endif // SCENEANIMATION_IMPLEMENTATION
@@ -0,0 +1,200 @@
+/* scenebvh - v0.1 - public domain bounding volume hierarchy for frustum culling
+
+    Do this:
+        #define SCENEBVH_IMPLEMENTATION
+    before you include this file in *one* C or C++ file to create the implementation.
+
+    The hierarchy is built once over a list of world-space boxes (float[6] per
+    item, see glmath.h) and only refit afterwards when the boxes move. Refitting
+    keeps the topology, so a tree that was built for one layout stays valid but
+    can get looser when items move far; call Build again in that case. Cull
+    returns the number of box tests it did and appends the visible item indices.
+    Items() lists the items in leaf order, neighbours in it are close in space.
+
+    Release notes:
+        v0.1    (2026-10-18)    initial version for frustum culling in gltfscene
+
+LICENSE
+
+This software is in the public domain. Where that dedication is not
+recognized, you are granted a perpetual, irrevocable license to copy,
+distribute, and modify this file as you see fit.
+
+*/
+#ifndef SCENEBVH_H
+#define SCENEBVH_H
+
+#include <vector>
+
+#include "glmath.h"
+
+class SceneBVH
+{
+    typedef struct {
+        float bounds[6];
+        int left;   // index of the first child, the second child follows it. -1 for leaves
+        int first;  // range in _items covered by this node
+        int count;
+    } Node;
+
+    std::vector<Node> _nodes;
+    std::vector<int> _items;
+
+    void build(int nodeIndex, const float *bounds, std::vector<float>& centroids, int first, int count);
+public:
+    SceneBVH();
+    virtual ~SceneBVH();
+
+    void Build(const float *bounds, int count);
+    void Refit(const float *bounds);
+    int Cull(const Frustum& frustum, const float *bounds, std::vector<int>& visible) const;
+    int ItemCount() const;
+    const std::vector<int>& Items() const;
+};
+
+#endif // SCENEBVH_H
+
+#ifdef SCENEBVH_IMPLEMENTATION
+
+#include <algorithm>
+
+#define SCENEBVH_LEAF_SIZE 4
+
+SceneBVH::SceneBVH() { }
+
+SceneBVH::~SceneBVH() { }
+
+void SceneBVH::build(int nodeIndex, const float *bounds, std::vector<float>& centroids, int first, int count)
+{
+    Node node;
+    node.left = -1;
+    node.first = first;
+    node.count = count;
+
+    float centroidBounds[6];
+    aabb_empty(node.bounds);
+    aabb_empty(centroidBounds);
+    for (int i = first; i < first + count; i++)
+    {
+        auto item = this->_items[i];
+        aabb_merge(node.bounds, &bounds[item * 6]);
+        float c[6] = { centroids[item * 3], centroids[item * 3 + 1], centroids[item * 3 + 2],
+                       centroids[item * 3], centroids[item * 3 + 1], centroids[item * 3 + 2] };
+        aabb_merge(centroidBounds, c);
+    }
+
+    if (count > SCENEBVH_LEAF_SIZE)
+    {
+        // Median split along the longest axis of the centroids
+        int axis = 0;
+        float extent = centroidBounds[3] - centroidBounds[0];
+        for (int a = 1; a < 3; a++)
+        {
+            if (centroidBounds[a + 3] - centroidBounds[a] > extent)
+            {
+                extent = centroidBounds[a + 3] - centroidBounds[a];
+                axis = a;
+            }
+        }
+
+        int half = count / 2;
+        std::nth_element(this->_items.begin() + first, this->_items.begin() + first + half, this->_items.begin() + first + count,
+                         [&centroids, axis] (int a, int b) { return centroids[a * 3 + axis] < centroids[b * 3 + axis]; });
+
+        node.left = (int)this->_nodes.size();
+        this->_nodes.resize(this->_nodes.size() + 2);
+        build(node.left, bounds, centroids, first, half);
+        build(node.left + 1, bounds, centroids, first + half, count - half);
+    }
+
+    this->_nodes[nodeIndex] = node;
+}
+
+void SceneBVH::Build(const float *bounds, int count)
+{
+    this->_nodes.clear();
+    this->_items.resize(count);
+    if (count == 0) return;
+
+    std::vector<float> centroids(count * 3);
+    for (int i = 0; i < count; i++)
+    {
+        this->_items[i] = i;
+        for (int a = 0; a < 3; a++) centroids[i * 3 + a] = (bounds[i * 6 + a] + bounds[i * 6 + a + 3]) * 0.5f;
+    }
+
+    this->_nodes.resize(1);
+    build(0, bounds, centroids, 0, count);
+}
+
+void SceneBVH::Refit(const float *bounds)
+{
+    // Children are always stored after their parent, so walking backwards is bottom-up
+    for (int i = (int)this->_nodes.size() - 1; i >= 0; i--)
+    {
+        auto& node = this->_nodes[i];
+        aabb_empty(node.bounds);
+        if (node.left < 0)
+        {
+            for (int k = node.first; k < node.first + node.count; k++) aabb_merge(node.bounds, &bounds[this->_items[k] * 6]);
+        }
+        else
+        {
+            aabb_merge(node.bounds, this->_nodes[node.left].bounds);
+            aabb_merge(node.bounds, this->_nodes[node.left + 1].bounds);
+        }
+    }
+}
+
+int SceneBVH::Cull(const Frustum& frustum, const float *bounds, std::vector<int>& visible) const
+{
+    if (this->_nodes.empty()) return 0;
+
+    int tested = 0;
+    int stack[64];
+    unsigned int masks[64];
+    int top = 0;
+    stack[top] = 0;
+    masks[top++] = 0x3f;
+
+    while (top > 0)
+    {
+        --top;
+        auto& node = this->_nodes[stack[top]];
+        auto mask = masks[top];
+
+        tested++;
+        auto result = frustum_test_aabb(frustum, node.bounds, &mask);
+        if (result == FRUSTUM_OUTSIDE) continue;
+
+        if (result == FRUSTUM_INSIDE)
+        {
+            visible.insert(visible.end(), this->_items.begin() + node.first, this->_items.begin() + node.first + node.count);
+            continue;
+        }
+
+        if (node.left < 0)
+        {
+            for (int k = node.first; k < node.first + node.count; k++)
+            {
+                auto itemMask = mask;
+                tested++;
+                if (frustum_test_aabb(frustum, &bounds[this->_items[k] * 6], &itemMask) != FRUSTUM_OUTSIDE) visible.push_back(this->_items[k]);
+            }
+            continue;
+        }
+
+        stack[top] = node.left + 1;
+        masks[top++] = mask;
+        stack[top] = node.left;
+        masks[top++] = mask;
+    }
+
+    return tested;
+}
+
+int SceneBVH::ItemCount() const { return (int)this->_items.size(); }
+
+const std::vector<int>& SceneBVH::Items() const { return this->_items; }
+
+#endif // SCENEBVH_IMPLEMENTATION
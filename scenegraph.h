@@ -0,0 +1,310 @@
+/* scenegraph - v0.3 - public domain gltf node hierarchy with cached world transforms
+
+    Do this:
+        #define SCENEGRAPH_IMPLEMENTATION
+    before you include this file in *one* C or C++ file to create the implementation.
+
+    Local transforms are kept as separate translation, rotation and scale arrays
+    (one entry per tinygltf node) so animation can write them directly. Setting a
+    local transform flags the node dirty, Update() then recomputes the world
+    matrices of the dirty nodes and everything below them.
+
+    Nodes with a mesh also hold the morph target weights of that mesh, taken
+    from the node or else the mesh. Weights have their own dirty flag, they
+    do not touch the world matrices.
+
+    Every root node of the scene heads a subtree, such as one character of a
+    crowd. Subtrees share no nodes, so UpdateSubtree() may run for different
+    subtrees on different threads at once, and so may the setters for nodes
+    of different subtrees. Subtrees without dirty nodes and without changes
+    from their last update need no update at all.
+
+    Release notes:
+        v0.1    (2026-10-18)    initial version for frustum culling in gltfscene
+        v0.2    (2026-10-18)    morph target weights per node
+        v0.3    (2026-10-18)    subtrees below each root, updated independently
+
+LICENSE
+
+This software is in the public domain. Where that dedication is not
+recognized, you are granted a perpetual, irrevocable license to copy,
+distribute, and modify this file as you see fit.
+
+*/
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+
+#include <vector>
+
+#include "tiny_gltf.h"
+
+class SceneGraph
+{
+    std::vector<int> _parents;              // per node, -1 for root nodes
+    std::vector<int> _order;                // reachable nodes, parents before children
+    std::vector<float> _translations;       // 3 per node
+    std::vector<float> _rotations;          // 4 per node, quaternion x, y, z, w
+    std::vector<float> _scales;             // 3 per node
+    std::vector<float> _matrices;           // 16 per node, used instead of TRS when set
+    std::vector<unsigned char> _hasMatrix;
+    std::vector<float> _worlds;             // 16 per node
+    std::vector<unsigned char> _dirty;      // local transform changed since last Update
+    std::vector<unsigned char> _changed;    // world transform changed in last Update
+    std::vector<int> _firstWeights;         // per node, in _weights
+    std::vector<int> _weightCounts;         // morph targets of the node's mesh
+    std::vector<float> _weights;
+    std::vector<unsigned char> _weightsDirty;
+    std::vector<unsigned char> _weightsChanged;
+    std::vector<int> _subtrees;             // per node, the root subtree it is in, -1 when unreachable
+    std::vector<int> _firstOrders;          // per subtree and one more, in _order
+    std::vector<unsigned char> _pending;    // per subtree, dirty or changed in its last update
+
+    void addNode(const tinygltf::Model& model, int index, int parent);
+public:
+    SceneGraph();
+    virtual ~SceneGraph();
+
+    void Build(const tinygltf::Model& model, int scene);
+    bool Update();
+
+    int SubtreeCount() const;
+    int Subtree(int node) const;
+    bool SubtreePending(int subtree) const;
+    bool UpdateSubtree(int subtree);  // true when a world matrix or weights changed
+
+    int NodeCount() const;
+    const std::vector<int>& Order() const;
+    int Parent(int node) const;
+    const float *World(int node) const;
+    bool Changed(int node) const;
+    bool WeightsChanged(int node) const;
+
+    void SetTranslation(int node, const float t[3]);
+    void SetRotation(int node, const float q[4]);
+    void SetScale(int node, const float s[3]);
+    float *Translation(int node);
+    float *Rotation(int node);
+    float *Scale(int node);
+    void MarkDirty(int node);
+
+    int WeightCount(int node) const;
+    void SetWeights(int node, const float *weights);
+    float *Weights(int node);  // NULL without morph targets
+    void MarkWeightsDirty(int node);
+};
+
+#endif // SCENEGRAPH_H
+
+#ifdef SCENEGRAPH_IMPLEMENTATION
+
+#include <algorithm>
+
+#include "glmath.h"
+
+SceneGraph::SceneGraph() { }
+
+SceneGraph::~SceneGraph() { }
+
+void SceneGraph::addNode(const tinygltf::Model& model, int index, int parent)
+{
+    // A node reached twice stays in the first subtree, subtrees never share nodes
+    if (index < 0 || index >= (int)model.nodes.size() || this->_subtrees[index] >= 0) return;
+
+    this->_parents[index] = parent;
+    this->_subtrees[index] = (int)this->_firstOrders.size() - 1;
+    this->_order.push_back(index);
+
+    for (auto child : model.nodes[index].children) addNode(model, child, index);
+}
+
+void SceneGraph::Build(const tinygltf::Model& model, int scene)
+{
+    auto count = model.nodes.size();
+
+    this->_parents.assign(count, -1);
+    this->_order.clear();
+    this->_translations.assign(count * 3, 0.0f);
+    this->_rotations.assign(count * 4, 0.0f);
+    this->_scales.assign(count * 3, 1.0f);
+    this->_matrices.assign(count * 16, 0.0f);
+    this->_hasMatrix.assign(count, 0);
+    this->_worlds.assign(count * 16, 0.0f);
+    this->_dirty.assign(count, 1);
+    this->_changed.assign(count, 0);
+    this->_firstWeights.assign(count, 0);
+    this->_weightCounts.assign(count, 0);
+    this->_weights.clear();
+    this->_weightsDirty.assign(count, 1);
+    this->_weightsChanged.assign(count, 0);
+    this->_subtrees.assign(count, -1);
+    this->_firstOrders.assign(1, 0);
+    this->_pending.clear();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        auto& node = model.nodes[i];
+        this->_rotations[i * 4 + 3] = 1.0f;
+        mat4_identity(&this->_worlds[i * 16]);
+
+        // Primitives of a mesh all have the same number of targets, weights of the node win over those of the mesh
+        if (node.mesh >= 0 && node.mesh < (int)model.meshes.size())
+        {
+            auto& mesh = model.meshes[node.mesh];
+            size_t targets = 0;
+            for (auto& primitive : mesh.primitives) targets = std::max(targets, primitive.targets.size());
+
+            auto& weights = node.weights.empty() ? mesh.weights : node.weights;
+            this->_firstWeights[i] = (int)this->_weights.size();
+            this->_weightCounts[i] = (int)targets;
+            for (size_t t = 0; t < targets; t++) this->_weights.push_back(t < weights.size() ? (float)weights[t] : 0.0f);
+        }
+
+        if (node.matrix.size() == 16)
+        {
+            this->_hasMatrix[i] = 1;
+            for (int k = 0; k < 16; k++) this->_matrices[i * 16 + k] = (float)node.matrix[k];
+            mat4_decompose(&this->_matrices[i * 16], &this->_translations[i * 3], &this->_rotations[i * 4], &this->_scales[i * 3]);
+            continue;
+        }
+
+        if (node.translation.size() == 3)
+        {
+            for (int k = 0; k < 3; k++) this->_translations[i * 3 + k] = (float)node.translation[k];
+        }
+
+        if (node.rotation.size() == 4)
+        {
+            for (int k = 0; k < 4; k++) this->_rotations[i * 4 + k] = (float)node.rotation[k];
+        }
+
+        if (node.scale.size() == 3)
+        {
+            for (int k = 0; k < 3; k++) this->_scales[i * 3 + k] = (float)node.scale[k];
+        }
+    }
+
+    if (scene < 0 || scene >= (int)model.scenes.size()) return;
+
+    for (auto node : model.scenes[scene].nodes)
+    {
+        addNode(model, node, -1);
+        this->_firstOrders.push_back((int)this->_order.size());
+    }
+    this->_pending.assign(this->_firstOrders.size() - 1, 1);
+}
+
+bool SceneGraph::Update()
+{
+    bool any = false;
+    for (int s = 0; s < SubtreeCount(); s++)
+    {
+        if (this->_pending[s]) any = UpdateSubtree(s) || any;
+    }
+    return any;
+}
+
+int SceneGraph::SubtreeCount() const { return (int)this->_pending.size(); }
+
+int SceneGraph::Subtree(int node) const { return this->_subtrees[node]; }
+
+bool SceneGraph::SubtreePending(int subtree) const { return this->_pending[subtree] != 0; }
+
+bool SceneGraph::UpdateSubtree(int subtree)
+{
+    bool any = false;
+    for (int i = this->_firstOrders[subtree]; i < this->_firstOrders[subtree + 1]; i++)
+    {
+        auto index = this->_order[i];
+        this->_weightsChanged[index] = this->_weightsDirty[index];
+        this->_weightsDirty[index] = 0;
+        any = any || this->_weightsChanged[index] != 0;
+
+        auto parent = this->_parents[index];
+        if (!this->_dirty[index] && (parent < 0 || !this->_changed[parent]))
+        {
+            this->_changed[index] = 0;
+            continue;
+        }
+
+        float local[16];
+        if (this->_hasMatrix[index])
+            mat4_copy(local, &this->_matrices[index * 16]);
+        else
+            mat4_from_trs(local, &this->_translations[index * 3], &this->_rotations[index * 4], &this->_scales[index * 3]);
+
+        if (parent >= 0)
+            mat4_mul(&this->_worlds[index * 16], &this->_worlds[parent * 16], local);
+        else
+            mat4_copy(&this->_worlds[index * 16], local);
+
+        this->_dirty[index] = 0;
+        this->_changed[index] = 1;
+        any = true;
+    }
+
+    // The changed flags set now are cleared by the next update
+    this->_pending[subtree] = any;
+    return any;
+}
+
+int SceneGraph::NodeCount() const { return (int)this->_parents.size(); }
+
+const std::vector<int>& SceneGraph::Order() const { return this->_order; }
+
+int SceneGraph::Parent(int node) const { return this->_parents[node]; }
+
+const float *SceneGraph::World(int node) const { return &this->_worlds[node * 16]; }
+
+bool SceneGraph::Changed(int node) const { return this->_changed[node] != 0; }
+
+bool SceneGraph::WeightsChanged(int node) const { return this->_weightsChanged[node] != 0; }
+
+void SceneGraph::SetTranslation(int node, const float t[3])
+{
+    for (int k = 0; k < 3; k++) this->_translations[node * 3 + k] = t[k];
+    MarkDirty(node);
+}
+
+void SceneGraph::SetRotation(int node, const float q[4])
+{
+    for (int k = 0; k < 4; k++) this->_rotations[node * 4 + k] = q[k];
+    MarkDirty(node);
+}
+
+void SceneGraph::SetScale(int node, const float s[3])
+{
+    for (int k = 0; k < 3; k++) this->_scales[node * 3 + k] = s[k];
+    MarkDirty(node);
+}
+
+float *SceneGraph::Translation(int node) { return &this->_translations[node * 3]; }
+
+float *SceneGraph::Rotation(int node) { return &this->_rotations[node * 4]; }
+
+float *SceneGraph::Scale(int node) { return &this->_scales[node * 3]; }
+
+void SceneGraph::MarkDirty(int node)
+{
+    // The matrix was decomposed into TRS at build time, from now on the TRS values are used
+    this->_hasMatrix[node] = 0;
+    this->_dirty[node] = 1;
+    if (this->_subtrees[node] >= 0) this->_pending[this->_subtrees[node]] = 1;
+}
+
+int SceneGraph::WeightCount(int node) const { return this->_weightCounts[node]; }
+
+void SceneGraph::SetWeights(int node, const float *weights)
+{
+    for (int k = 0; k < this->_weightCounts[node]; k++) this->_weights[this->_firstWeights[node] + k] = weights[k];
+    MarkWeightsDirty(node);
+}
+
+float *SceneGraph::Weights(int node) { return this->_weightCounts[node] > 0 ? &this->_weights[this->_firstWeights[node]] : NULL; }
+
+void SceneGraph::MarkWeightsDirty(int node)
+{
+    this->_weightsDirty[node] = 1;
+    if (this->_subtrees[node] >= 0) this->_pending[this->_subtrees[node]] = 1;
+}
+
+#endif // SCENEGRAPH_IMPLEMENTATION
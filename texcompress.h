@@ -0,0 +1,515 @@
+/* texcompress - v0.3 - public domain BC1, BC3 and BC5 block compression with a disk cache
+
+    Do this:
+        #define TEXCOMPRESS_IMPLEMENTATION
+    before you include this file in *one* C or C++ file to create the implementation.
+
+    Encodes 8 bit RGB or RGBA images into the S3TC block formats every desktop
+    gpu samples directly. Both work on blocks of 4x4 pixels:
+
+    BC1 (DXT1) stores two 565 colors and a 2 bit index per pixel, 8 bytes a
+    block, 6:1 against RGB8. Endpoints are the extremes along the principal
+    axis of the block colors, refined once with a least squares fit.
+
+    BC3 (DXT5) is a BC1 color block plus an alpha block with two 8 bit
+    endpoints and a 3 bit index per pixel, 16 bytes a block, 4:1 against RGBA8.
+
+    BC5 (RGTC2) is two of those alpha blocks, one for red and one for green,
+    16 bytes a block. It keeps the two channels of a normal map apart, the
+    shader rebuilds the third component.
+
+    tex_compress_block_row encodes one row of blocks, so callers can spread
+    the rows of a level over threads. Images that are not a multiple of 4
+    repeat their last row and column into the padding.
+
+    tex_decompress_block_row turns a row of blocks back into RGBA8, for
+    block compressed images on drivers without S3TC. BC5 decodes to red and
+    green with blue 0 and alpha 255, as OpenGL samples it.
+
+    Cache files hold the compressed levels of one image under a name made
+    from tex_compress_hash of its pixels. A file that does not match what
+    the caller expects is simply not used.
+
+    Release notes:
+        v0.1    (2026-10-18)    initial version for compressed textures in gltfscene
+        v0.2    (2026-10-18)    tex_decompress_block_row, with the three color mode of BC1
+        v0.3    (2026-10-18)    BC5 for two channel images such as normal maps
+
+LICENSE
+
+This software is in the public domain. Where that dedication is not
+recognized, you are granted a perpetual, irrevocable license to copy,
+distribute, and modify this file as you see fit.
+
+*/
+#ifndef TEXCOMPRESS_H
+#define TEXCOMPRESS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#define TEXCOMPRESS_BC1 1  // RGB, 8 bytes per block
+#define TEXCOMPRESS_BC3 3  // RGBA, 16 bytes per block
+#define TEXCOMPRESS_BC5 5  // RG, 16 bytes per block
+
+// Changes whenever the encoder output changes, so old cache files are not used
+#define TEXCOMPRESS_VERSION 1
+
+// Bytes of a whole level
+size_t tex_compress_size(int width, int height, int format);
+
+// Writes block row blockRow of a width by height level, destination is the start of the level
+void tex_compress_block_row(unsigned char *destination, const unsigned char *source, int width, int height, int components, int format, int blockRow);
+
+// Writes block row blockRow as RGBA8 into a width by height level. BC1 blocks with
+// color0 <= color1 use the three color mode, index 3 is transparent black.
+void tex_decompress_block_row(unsigned char *destination, const unsigned char *source, int width, int height, int format, int blockRow);
+
+// 64 bit FNV-1a, pass the result of the previous call to continue a hash
+unsigned long long tex_compress_hash(const void *data, size_t size, unsigned long long hash = 14695981039346656037ULL);
+
+bool tex_cache_read(const std::string& filename, int format, std::vector<std::vector<unsigned char> >& levels);
+bool tex_cache_write(const std::string& filename, int format, const std::vector<std::vector<unsigned char> >& levels);
+
+#endif // TEXCOMPRESS_H
+
+#ifdef TEXCOMPRESS_IMPLEMENTATION
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+static int tex_compress_block_size(int format)
+{
+    return format == TEXCOMPRESS_BC3 || format == TEXCOMPRESS_BC5 ? 16 : 8;
+}
+
+size_t tex_compress_size(int width, int height, int format)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * tex_compress_block_size(format);
+}
+
+static int tex_compress_pack565(const float color[3])
+{
+    int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+    int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+    int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+    r = r < 0 ? 0 : (r > 31 ? 31 : r);
+    g = g < 0 ? 0 : (g > 63 ? 63 : g);
+    b = b < 0 ? 0 : (b > 31 ? 31 : b);
+    return (r << 11) | (g << 5) | b;
+}
+
+static void tex_compress_unpack565(int packed, int color[3])
+{
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// Picks the nearest of the four palette colors for every pixel, returns the total squared error
+static int tex_compress_indices(const unsigned char *pixels, int c0, int c1, unsigned int *indices)
+{
+    int palette[4][3];
+    tex_compress_unpack565(c0, palette[0]);
+    tex_compress_unpack565(c1, palette[1]);
+    for (int k = 0; k < 3; k++)
+    {
+        palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+        palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+    }
+
+    int error = 0;
+    *indices = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int best = 0, bestError = 0x7fffffff;
+        for (int p = 0; p < (c0 == c1 ? 1 : 4); p++)
+        {
+            int e = 0;
+            for (int k = 0; k < 3; k++) e += (pixels[i * 4 + k] - palette[p][k]) * (pixels[i * 4 + k] - palette[p][k]);
+            if (e < bestError)
+            {
+                best = p;
+                bestError = e;
+            }
+        }
+        *indices |= (unsigned int)best << (i * 2);
+        error += bestError;
+    }
+    return error;
+}
+
+// Endpoints that fit the colors best for the given indices, false when all pixels use one endpoint
+static bool tex_compress_refine(const unsigned char *pixels, unsigned int indices, float high[3], float low[3])
+{
+    static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[3] = { 0.0f, 0.0f, 0.0f }, bx[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++)
+    {
+        float a = weights[(indices >> (i * 2)) & 3], b = 1.0f - a;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int k = 0; k < 3; k++)
+        {
+            ax[k] += a * pixels[i * 4 + k];
+            bx[k] += b * pixels[i * 4 + k];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (determinant < 1e-6f) return false;
+
+    for (int k = 0; k < 3; k++)
+    {
+        high[k] = (ax[k] * bb - bx[k] * ab) / determinant;
+        low[k] = (bx[k] * aa - ax[k] * ab) / determinant;
+    }
+    return true;
+}
+
+static void tex_compress_write_color(unsigned char *out, int c0, int c1, unsigned int indices)
+{
+    out[0] = (unsigned char)(c0 & 0xff);
+    out[1] = (unsigned char)(c0 >> 8);
+    out[2] = (unsigned char)(c1 & 0xff);
+    out[3] = (unsigned char)(c1 >> 8);
+    for (int b = 0; b < 4; b++) out[4 + b] = (unsigned char)(indices >> (b * 8));
+}
+
+// Orders the endpoints for the four color mode, swapping indices 0/1 and 2/3 with them
+static void tex_compress_order(int& c0, int& c1, unsigned int& indices)
+{
+    if (c0 >= c1) return;
+
+    int t = c0;
+    c0 = c1;
+    c1 = t;
+    indices ^= 0x55555555u;
+}
+
+static void tex_compress_color(unsigned char *out, const unsigned char *pixels)
+{
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++)
+    {
+        for (int k = 0; k < 3; k++) mean[k] += pixels[i * 4 + k] / 16.0f;
+    }
+
+    float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++)
+    {
+        float d[3] = { pixels[i * 4] - mean[0], pixels[i * 4 + 1] - mean[1], pixels[i * 4 + 2] - mean[2] };
+        covariance[0] += d[0] * d[0];
+        covariance[1] += d[0] * d[1];
+        covariance[2] += d[0] * d[2];
+        covariance[3] += d[1] * d[1];
+        covariance[4] += d[1] * d[2];
+        covariance[5] += d[2] * d[2];
+    }
+
+    // Principal axis by power iteration, starting from the channel that varies most
+    int channel = covariance[0] >= covariance[3] ? (covariance[0] >= covariance[5] ? 0 : 2) : (covariance[3] >= covariance[5] ? 1 : 2);
+    float axis[3] = { 0.0f, 0.0f, 0.0f };
+    axis[channel] = 1.0f;
+    for (int it = 0; it < 8; it++)
+    {
+        float next[3] = {
+            covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+            covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+            covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2],
+        };
+        float largest = next[0] > next[1] ? next[0] : next[1];
+        largest = largest > next[2] ? largest : next[2];
+        float smallest = next[0] < next[1] ? next[0] : next[1];
+        smallest = smallest < next[2] ? smallest : next[2];
+        if (-smallest > largest) largest = -smallest;
+        if (largest < 1e-6f) break;
+        for (int k = 0; k < 3; k++) axis[k] = next[k] / largest;
+    }
+    float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    for (int k = 0; k < 3; k++) axis[k] /= length;
+
+    float tMin = 1e30f, tMax = -1e30f;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+        for (int k = 0; k < 3; k++) t += (pixels[i * 4 + k] - mean[k]) * axis[k];
+        if (t < tMin) tMin = t;
+        if (t > tMax) tMax = t;
+    }
+
+    float high[3], low[3];
+    for (int k = 0; k < 3; k++)
+    {
+        high[k] = mean[k] + axis[k] * tMax;
+        low[k] = mean[k] + axis[k] * tMin;
+    }
+
+    int c0 = tex_compress_pack565(high), c1 = tex_compress_pack565(low);
+    unsigned int indices;
+    int error = tex_compress_indices(pixels, c0, c1, &indices);
+
+    if (c0 != c1 && tex_compress_refine(pixels, indices, high, low))
+    {
+        int r0 = tex_compress_pack565(high), r1 = tex_compress_pack565(low);
+        unsigned int refined;
+        if (r0 != r1 && tex_compress_indices(pixels, r0, r1, &refined) < error)
+        {
+            c0 = r0;
+            c1 = r1;
+            indices = refined;
+        }
+    }
+
+    tex_compress_order(c0, c1, indices);
+    if (c0 == c1) indices = 0;
+    tex_compress_write_color(out, c0, c1, indices);
+}
+
+// One 8 bit channel of the block, alpha for BC3 and red or green for BC5
+static void tex_compress_alpha(unsigned char *out, const unsigned char *pixels, int channel)
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        if (pixels[i * 4 + channel] > a0) a0 = pixels[i * 4 + channel];
+        if (pixels[i * 4 + channel] < a1) a1 = pixels[i * 4 + channel];
+    }
+
+    // a0 > a1 selects eight interpolated values, codes 2..7 run from a0 to a1
+    int palette[8] = { a0, a1 };
+    for (int p = 1; p < 7; p++) palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+
+    unsigned long long indices = 0;
+    if (a0 != a1)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestError = 256;
+            for (int p = 0; p < 8; p++)
+            {
+                int e = pixels[i * 4 + channel] > palette[p] ? pixels[i * 4 + channel] - palette[p] : palette[p] - pixels[i * 4 + channel];
+                if (e < bestError)
+                {
+                    best = p;
+                    bestError = e;
+                }
+            }
+            indices |= (unsigned long long)best << (i * 3);
+        }
+    }
+
+    out[0] = (unsigned char)a0;
+    out[1] = (unsigned char)a1;
+    for (int b = 0; b < 6; b++) out[2 + b] = (unsigned char)(indices >> (b * 8));
+}
+
+void tex_compress_block_row(unsigned char *destination, const unsigned char *source, int width, int height, int components, int format, int blockRow)
+{
+    auto blocks = (width + 3) / 4;
+    auto blockSize = tex_compress_block_size(format);
+    auto out = destination + (size_t)blockRow * blocks * blockSize;
+
+    unsigned char pixels[64];
+    for (int bx = 0; bx < blocks; bx++)
+    {
+        for (int y = 0; y < 4; y++)
+        {
+            auto sy = blockRow * 4 + y < height ? blockRow * 4 + y : height - 1;
+            for (int x = 0; x < 4; x++)
+            {
+                auto sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+                auto pixel = source + ((size_t)sy * width + sx) * components;
+                auto p = &pixels[(y * 4 + x) * 4];
+                p[0] = pixel[0];
+                p[1] = pixel[1];
+                p[2] = pixel[2];
+                p[3] = components == 4 ? pixel[3] : 255;
+            }
+        }
+
+        if (format == TEXCOMPRESS_BC3)
+        {
+            tex_compress_alpha(out, pixels, 3);
+            tex_compress_color(out + 8, pixels);
+        }
+        else if (format == TEXCOMPRESS_BC5)
+        {
+            tex_compress_alpha(out, pixels, 0);
+            tex_compress_alpha(out + 8, pixels, 1);
+        }
+        else
+        {
+            tex_compress_color(out, pixels);
+        }
+        out += blockSize;
+    }
+}
+
+static void tex_decompress_color(unsigned char *pixels, const unsigned char *block, bool fourColors)
+{
+    int c0 = block[0] | (block[1] << 8), c1 = block[2] | (block[3] << 8);
+    int palette[4][4];
+    tex_compress_unpack565(c0, palette[0]);
+    tex_compress_unpack565(c1, palette[1]);
+    bool threeColors = !fourColors && c0 <= c1;
+    for (int k = 0; k < 3; k++)
+    {
+        if (threeColors)
+        {
+            palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+            palette[3][k] = 0;
+        }
+        else
+        {
+            palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+            palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+        }
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = threeColors ? 0 : 255;
+
+    unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+    for (int i = 0; i < 16; i++)
+    {
+        auto color = palette[(indices >> (i * 2)) & 3];
+        for (int k = 0; k < 4; k++) pixels[i * 4 + k] = (unsigned char)color[k];
+    }
+}
+
+static void tex_decompress_alpha(unsigned char *pixels, const unsigned char *block, int channel)
+{
+    int a0 = block[0], a1 = block[1];
+    int palette[8] = { a0, a1 };
+    for (int p = 1; p < 7; p++)
+    {
+        if (a0 > a1) palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+        else if (p < 5) palette[p + 1] = ((5 - p) * a0 + p * a1) / 5;
+        else palette[p + 1] = p == 5 ? 0 : 255;
+    }
+
+    unsigned long long indices = 0;
+    for (int b = 0; b < 6; b++) indices |= (unsigned long long)block[2 + b] << (b * 8);
+    for (int i = 0; i < 16; i++) pixels[i * 4 + channel] = (unsigned char)palette[(indices >> (i * 3)) & 7];
+}
+
+void tex_decompress_block_row(unsigned char *destination, const unsigned char *source, int width, int height, int format, int blockRow)
+{
+    auto blocks = (width + 3) / 4;
+    auto blockSize = tex_compress_block_size(format);
+    auto block = source + (size_t)blockRow * blocks * blockSize;
+
+    unsigned char pixels[64];
+    for (int bx = 0; bx < blocks; bx++)
+    {
+        if (format == TEXCOMPRESS_BC3)
+        {
+            tex_decompress_color(pixels, block + 8, true);
+            tex_decompress_alpha(pixels, block, 3);
+        }
+        else if (format == TEXCOMPRESS_BC5)
+        {
+            for (int i = 0; i < 16; i++)
+            {
+                pixels[i * 4 + 2] = 0;
+                pixels[i * 4 + 3] = 255;
+            }
+            tex_decompress_alpha(pixels, block, 0);
+            tex_decompress_alpha(pixels, block + 8, 1);
+        }
+        else
+        {
+            tex_decompress_color(pixels, block, false);
+        }
+        block += blockSize;
+
+        for (int y = 0; y < 4 && blockRow * 4 + y < height; y++)
+        {
+            for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+            {
+                memcpy(destination + ((size_t)(blockRow * 4 + y) * width + bx * 4 + x) * 4, &pixels[(y * 4 + x) * 4], 4);
+            }
+        }
+    }
+}
+
+unsigned long long tex_compress_hash(const void *data, size_t size, unsigned long long hash)
+{
+    auto bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Layout: "BCN" and the encoder version, the format, the level count, then every
+// level as its size and its blocks. All integers are 32 bit little endian.
+static bool tex_cache_read_uint(FILE *file, unsigned int& value)
+{
+    unsigned char bytes[4];
+    if (fread(bytes, 1, 4, file) != 4) return false;
+
+    value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+    return true;
+}
+
+static bool tex_cache_write_uint(FILE *file, unsigned int value)
+{
+    unsigned char bytes[4] = { (unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24) };
+    return fwrite(bytes, 1, 4, file) == 4;
+}
+
+bool tex_cache_read(const std::string& filename, int format, std::vector<std::vector<unsigned char> >& levels)
+{
+    levels.clear();
+
+    auto file = fopen(filename.c_str(), "rb");
+    if (file == NULL) return false;
+
+    unsigned int magic = 0, fileFormat = 0, count = 0;
+    bool ok = tex_cache_read_uint(file, magic) && tex_cache_read_uint(file, fileFormat) && tex_cache_read_uint(file, count);
+    ok = ok && magic == (0x4e4342u | ((unsigned int)TEXCOMPRESS_VERSION << 24)) && (int)fileFormat == format && count <= 32;
+    for (unsigned int l = 0; ok && l < count; l++)
+    {
+        unsigned int size = 0;
+        ok = tex_cache_read_uint(file, size) && size <= (1u << 30);
+        if (!ok) break;
+
+        levels.push_back(std::vector<unsigned char>(size));
+        ok = size == 0 || fread(levels.back().data(), 1, size, file) == size;
+    }
+    fclose(file);
+
+    if (!ok) levels.clear();
+    return ok;
+}
+
+bool tex_cache_write(const std::string& filename, int format, const std::vector<std::vector<unsigned char> >& levels)
+{
+    // Written under another name first, so a reader never sees half a file
+    auto temporary = filename + ".tmp";
+    auto file = fopen(temporary.c_str(), "wb");
+    if (file == NULL) return false;
+
+    bool ok = tex_cache_write_uint(file, 0x4e4342u | ((unsigned int)TEXCOMPRESS_VERSION << 24)) &&
+        tex_cache_write_uint(file, (unsigned int)format) && tex_cache_write_uint(file, (unsigned int)levels.size());
+    for (size_t l = 0; ok && l < levels.size(); l++)
+    {
+        ok = tex_cache_write_uint(file, (unsigned int)levels[l].size()) &&
+            (levels[l].empty() || fwrite(levels[l].data(), 1, levels[l].size(), file) == levels[l].size());
+    }
+    ok = fclose(file) == 0 && ok;
+
+    if (ok) ok = rename(temporary.c_str(), filename.c_str()) == 0;
+    if (!ok) remove(temporary.c_str());
+    return ok;
+}
+
+#endif // TEXCOMPRESS_IMPLEMENTATION
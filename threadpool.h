@@ -0,0 +1,333 @@
+/* threadpool - v0.3 - public domain work-stealing task scheduler
+
+    Do this:
+        #define THREADPOOL_IMPLEMENTATION
+    before you include this file in *one* C or C++ file to create the implementation.
+
+    Submit(work, after) queues a task that runs once every task in after has
+    finished, the returned handle is what later tasks can run after. Every worker
+    has its own deque: it takes its newest task first and steals the oldest ones
+    of the others when it runs dry. Threads that are not workers share one more
+    deque. Wait(task) runs queued tasks until the task is done, so a task may
+    wait on tasks it submitted and nothing blocks a worker.
+
+    ParallelFor(count, body, grain) calls body(i) for every i in [0, count) in
+    tasks of grain iterations and returns when all calls are done, the calling
+    thread helps. It can be called from several threads and from inside a task.
+
+    SetHooks(begin, end, user) reports the name of every task and the thread
+    running it, 0 for threads that are not workers and 1 to ThreadCount() - 1
+    for the workers. Set them before any work is submitted.
+
+    Shared() is one pool for the whole process, so loading, the scene update and
+    tools do not each start their own threads.
+
+    Release notes:
+        v0.1    (2026-10-18)    initial version for mesh optimization in gltfscene
+        v0.2    (2026-10-18)    work-stealing deques, tasks with dependencies, helping Wait, grain, hooks and Shared()
+        v0.3    (2026-10-18)    ThreadPool(0) has no workers, the default is still one less than the hardware threads
+
+LICENSE
+
+This software is in the public domain. Where that dedication is not
+recognized, you are granted a perpetual, irrevocable license to copy,
+distribute, and modify this file as you see fit.
+
+*/
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef struct ThreadPoolJob {
+    std::function<void()> work;
+    const char *name;
+    std::atomic<int> pending;   // tasks it still runs after, plus one until it is submitted
+    std::atomic<bool> done;
+    std::mutex mutex;           // guards done against new continuations
+    std::vector<std::shared_ptr<ThreadPoolJob> > continuations;
+} ThreadPoolJob;
+
+typedef std::shared_ptr<ThreadPoolJob> ThreadPoolTask;
+
+typedef void (*ThreadPoolHook)(const char *name, int thread, void *user);
+
+class ThreadPool
+{
+    typedef struct {
+        std::mutex mutex;
+        std::deque<ThreadPoolTask> tasks;
+    } Queue;
+
+    std::vector<std::thread> _threads;
+    std::vector<Queue*> _queues;    // 0 for the threads that are not workers, then one per worker
+    std::mutex _mutex;
+    std::condition_variable _wake;      // idle workers
+    std::condition_variable _finished;  // threads inside Wait
+    std::atomic<int> _queued;
+    std::atomic<int> _sleeping;
+    std::atomic<int> _waiting;
+    ThreadPoolHook _begin;
+    ThreadPoolHook _end;
+    void *_hookUser;
+    bool _stop;
+
+    void worker(int thread);
+    int current() const;
+    void push(const ThreadPoolTask& task);
+    ThreadPoolTask take(int thread);
+    void execute(const ThreadPoolTask& task, int thread);
+    void release(const ThreadPoolTask& task);
+public:
+    // Negative uses one less than the number of hardware threads, 0 starts no workers
+    ThreadPool(int threads = -1);
+    virtual ~ThreadPool();
+
+    static ThreadPool& Shared();
+
+    // Without worker threads tasks run when a thread waits for them
+    ThreadPoolTask Submit(const std::function<void()>& work, const std::vector<ThreadPoolTask>& after = std::vector<ThreadPoolTask>(),
+                          const char *name = NULL);
+    void Wait(const ThreadPoolTask& task);
+    bool Done(const ThreadPoolTask& task) const;
+
+    void ParallelFor(int count, const std::function<void(int)>& body, int grain = 1, const char *name = NULL);
+    void SetHooks(ThreadPoolHook begin, ThreadPoolHook end, void *user);
+    int ThreadCount() const;
+};
+
+#endif // THREADPOOL_H
+
+#ifdef THREADPOOL_IMPLEMENTATION
+
+#include <algorithm>
+
+static thread_local ThreadPool *threadpool_owner = NULL;
+static thread_local int threadpool_thread = 0;
+
+ThreadPool::ThreadPool(int threads) : _queued(0), _sleeping(0), _waiting(0), _begin(NULL), _end(NULL), _hookUser(NULL), _stop(false)
+{
+    if (threads < 0) threads = (int)std::thread::hardware_concurrency() - 1;
+    if (threads < 0) threads = 0;
+
+    for (int i = 0; i <= threads; i++) this->_queues.push_back(new Queue());
+    for (int i = 0; i < threads; i++) this->_threads.push_back(std::thread(&ThreadPool::worker, this, i + 1));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        this->_stop = true;
+    }
+    this->_wake.notify_all();
+
+    for (auto& thread : this->_threads) thread.join();
+    for (auto queue : this->_queues) delete queue;
+}
+
+ThreadPool& ThreadPool::Shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+int ThreadPool::current() const
+{
+    return threadpool_owner == this ? threadpool_thread : 0;
+}
+
+void ThreadPool::push(const ThreadPoolTask& task)
+{
+    auto queue = this->_queues[current()];
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->tasks.push_back(task);
+    }
+    this->_queued++;
+
+    // Sleepers count themselves under _mutex before they check _queued, so taking
+    // it here means they either see the task or get the notification
+    if (this->_sleeping > 0 || this->_waiting > 0)
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+    }
+    if (this->_sleeping > 0) this->_wake.notify_one();
+    if (this->_waiting > 0) this->_finished.notify_all();
+}
+
+// The own deque from the back, then the others from the front
+ThreadPoolTask ThreadPool::take(int thread)
+{
+    if (this->_queued == 0) return ThreadPoolTask();
+
+    int count = (int)this->_queues.size();
+    for (int i = 0; i < count; i++)
+    {
+        auto queue = this->_queues[(thread + i) % count];
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (queue->tasks.empty()) continue;
+
+        ThreadPoolTask task;
+        if (i == 0)
+        {
+            task = queue->tasks.back();
+            queue->tasks.pop_back();
+        }
+        else
+        {
+            task = queue->tasks.front();
+            queue->tasks.pop_front();
+        }
+        this->_queued--;
+        return task;
+    }
+
+    return ThreadPoolTask();
+}
+
+void ThreadPool::execute(const ThreadPoolTask& task, int thread)
+{
+    if (this->_begin != NULL) this->_begin(task->name, thread, this->_hookUser);
+    task->work();
+    if (this->_end != NULL) this->_end(task->name, thread, this->_hookUser);
+    std::function<void()>().swap(task->work);
+
+    std::vector<ThreadPoolTask> ready;
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->done = true;
+        ready.swap(task->continuations);
+    }
+    for (auto& next : ready) release(next);
+
+    if (this->_waiting > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+        }
+        this->_finished.notify_all();
+    }
+}
+
+void ThreadPool::release(const ThreadPoolTask& task)
+{
+    if (--task->pending == 0) push(task);
+}
+
+void ThreadPool::worker(int thread)
+{
+    threadpool_owner = this;
+    threadpool_thread = thread;
+
+    for (;;)
+    {
+        auto task = take(thread);
+        if (task)
+        {
+            execute(task, thread);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(this->_mutex);
+        this->_sleeping++;
+        this->_wake.wait(lock, [this] { return this->_stop || this->_queued > 0; });
+        this->_sleeping--;
+        if (this->_stop) return;
+    }
+}
+
+ThreadPoolTask ThreadPool::Submit(const std::function<void()>& work, const std::vector<ThreadPoolTask>& after, const char *name)
+{
+    auto task = std::make_shared<ThreadPoolJob>();
+    task->work = work;
+    task->name = name;
+    task->pending = 1;
+    task->done = false;
+
+    for (auto& before : after)
+    {
+        if (!before) continue;
+
+        std::lock_guard<std::mutex> lock(before->mutex);
+        if (before->done) continue;
+        before->continuations.push_back(task);
+        task->pending++;
+    }
+    release(task);
+
+    return task;
+}
+
+void ThreadPool::Wait(const ThreadPoolTask& task)
+{
+    if (!task) return;
+
+    int thread = current();
+    while (!task->done)
+    {
+        auto other = take(thread);
+        if (other)
+        {
+            execute(other, thread);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(this->_mutex);
+        this->_waiting++;
+        this->_finished.wait(lock, [this, &task] { return task->done || this->_queued > 0; });
+        this->_waiting--;
+    }
+}
+
+bool ThreadPool::Done(const ThreadPoolTask& task) const
+{
+    return !task || task->done;
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& body, int grain, const char *name)
+{
+    if (count <= 0) return;
+    if (grain < 1) grain = 1;
+
+    int chunks = (count + grain - 1) / grain;
+    if (this->_threads.empty() || chunks == 1)
+    {
+        int thread = current();
+        if (this->_begin != NULL) this->_begin(name, thread, this->_hookUser);
+        for (int i = 0; i < count; i++) body(i);
+        if (this->_end != NULL) this->_end(name, thread, this->_hookUser);
+        return;
+    }
+
+    std::vector<ThreadPoolTask> tasks;
+    tasks.reserve(chunks);
+    for (int c = 0; c < chunks; c++)
+    {
+        tasks.push_back(Submit([&body, c, grain, count] ()
+        {
+            int end = std::min(count, (c + 1) * grain);
+            for (int i = c * grain; i < end; i++) body(i);
+        }, std::vector<ThreadPoolTask>(), name));
+    }
+
+    for (auto& task : tasks) Wait(task);
+}
+
+void ThreadPool::SetHooks(ThreadPoolHook begin, ThreadPoolHook end, void *user)
+{
+    this->_begin = begin;
+    this->_end = end;
+    this->_hookUser = user;
+}
+
+int ThreadPool::ThreadCount() const { return (int)this->_threads.size() + 1; }
+
+#endif // THREADPOOL_IMPLEMENTATION
@@ -353,7 +353,9 @@ struct Image {
   int pad0;
   std::vector<unsigned char> image;
   int bufferView;        // (required if no uri)
-  std::string mimeType;  // (required if no uri) ["image/jpeg", "image/png"]
+  std::string mimeType;  // (required if no uri) ["image/jpeg", "image/png",
+                         // "image/ktx2"]. KTX2 containers are kept as they
+                         // are in `image` with component 0.
   std::string uri;       // (reqiored if no mimeType)
   Value extras;
 
@@ -363,9 +365,10 @@ struct Image {
 struct Texture {
   int sampler;
   int source;  // Required (not specified in the spec ?)
+  int basisuSource;  // KHR_texture_basisu, KTX2 image to use instead of source
   Value extras;
 
-  Texture() : sampler(-1), source(-1) {}
+  Texture() : sampler(-1), source(-1), basisuSource(-1) {}
 };
 
 // Each extension should be stored in a ParameterMap.
@@ -386,20 +389,22 @@ struct BufferView {
   int buffer;         // Required
   size_t byteOffset;  // minimum 0, default 0
   size_t byteLength;  // required, minimum 1
-  size_t byteStride;  // minimum 4, maximum 252 (multiple of 4)
+  size_t byteStride;  // minimum 4, maximum 252 (multiple of 4), 0 means
+                      // tightly packed
   int target;         // ["ARRAY_BUFFER", "ELEMENT_ARRAY_BUFFER"]
   int pad0;
   Value extras;
 
-  BufferView() : byteOffset(0), byteStride(4) {}
+  BufferView() : byteOffset(0), byteStride(0) {}
 };
 
 struct Accessor {
-  int bufferView;  // optional in spec but required here since sparse accessor
-                   // are not supported
+  int bufferView;  // optional, -1 when all elements are zero before the
+                   // sparse substitution
   std::string name;
   size_t byteOffset;
   int componentType;  // (required) One of TINYGLTF_COMPONENT_TYPE_***
+  bool normalized;    // integer components map to [0, 1] or [-1, 1]
   size_t count;       // required
   int type;           // (required) One of TINYGLTF_TYPE_***   ..
   Value extras;
@@ -407,7 +412,31 @@ struct Accessor {
   std::vector<double> minValues;  // required
   std::vector<double> maxValues;  // required
 
-  Accessor() { bufferView = -1; }
+  // Elements whose values are replaced, `count' indices into the accessor
+  // followed by as many elements of `componentType' and `type'
+  struct {
+    int count;
+    bool isSparse;
+    struct {
+      int bufferView;
+      size_t byteOffset;
+      int componentType;  // UNSIGNED_BYTE, UNSIGNED_SHORT or UNSIGNED_INT
+    } indices;
+    struct {
+      int bufferView;
+      size_t byteOffset;
+    } values;
+  } sparse;
+
+  Accessor() : bufferView(-1), normalized(false) {
+    sparse.count = 0;
+    sparse.isSparse = false;
+    sparse.indices.bufferView = -1;
+    sparse.indices.byteOffset = 0;
+    sparse.indices.componentType = 0;
+    sparse.values.bufferView = -1;
+    sparse.values.byteOffset = 0;
+  }
 };
 
 class Camera {
@@ -482,6 +511,10 @@ class Node {
   std::vector<double> matrix;       // length must be 0 or 16
   std::vector<double> weights;  // The weights of the instantiated Morph Target
 
+  // EXT_mesh_gpu_instancing: accessor index for each per-instance attribute
+  // ("TRANSLATION", "ROTATION", "SCALE"). Empty when the node is not instanced.
+  std::map<std::string, int> instanceAttributes;
+
   Value extras;
 };
 
@@ -548,13 +581,34 @@ enum SectionCheck {
   REQUIRE_ALL = 0x3f
 };
 
+///
+/// Calls body(i, data) for every i in [0, count) and returns when all calls
+/// are done. The calls may run on several threads at once.
+///
+typedef void (*ParallelForFunction)(int count, void (*body)(int, void *),
+                                    void *data, void *user_data);
+
 class TinyGLTF {
  public:
-  TinyGLTF() : bin_data_(NULL), bin_size_(0), is_binary_(false) {
+  TinyGLTF()
+      : bin_data_(NULL),
+        bin_size_(0),
+        parallel_for_(NULL),
+        parallel_for_user_data_(NULL),
+        is_binary_(false) {
     pad[0] = pad[1] = pad[2] = pad[3] = pad[4] = pad[5] = pad[6] = 0;
   }
   ~TinyGLTF() {}
 
+  ///
+  /// Images are read and decoded through `parallel_for` when it is set,
+  /// one after the other otherwise.
+  ///
+  void SetParallelFor(ParallelForFunction parallel_for, void *user_data) {
+    parallel_for_ = parallel_for;
+    parallel_for_user_data_ = user_data;
+  }
+
   ///
   /// Loads glTF ASCII asset from a file.
   /// Returns false and set error string to `err` if there's an error.
@@ -612,6 +666,8 @@ class TinyGLTF {
 
   const unsigned char *bin_data_;
   size_t bin_size_;
+  ParallelForFunction parallel_for_;
+  void *parallel_for_user_data_;
   bool is_binary_;
   char pad[7];
 };
@@ -950,6 +1006,21 @@ static bool LoadExternalFile(std::vector<unsigned char> *out, std::string *err,
 static bool LoadImageData(Image *image, std::string *err, int req_width,
                           int req_height, const unsigned char *bytes,
                           int size) {
+  // KTX2 is not decoded here, the container goes to the renderer as it is
+  static const unsigned char ktx2Identifier[12] = {0xAB, 0x4B, 0x54, 0x58,
+                                                   0x20, 0x32, 0x30, 0xBB,
+                                                   0x0D, 0x0A, 0x1A, 0x0A};
+  if (size >= 28 && memcmp(bytes, ktx2Identifier, 12) == 0) {
+    image->width = static_cast<int>(bytes[20] | (bytes[21] << 8) |
+                                    (bytes[22] << 16) | (bytes[23] << 24));
+    image->height = static_cast<int>(bytes[24] | (bytes[25] << 8) |
+                                     (bytes[26] << 16) | (bytes[27] << 24));
+    image->component = 0;
+    image->mimeType = "image/ktx2";
+    image->image.assign(bytes, bytes + size);
+    return true;
+  }
+
   int w, h, comp;
   // if image cannot be decoded, ignore parsing and keep it by its path
   // don't break in this case
@@ -1460,6 +1531,54 @@ static bool ParseImage(Image *image, std::string *err,
                        static_cast<int>(img.size()));
 }
 
+typedef struct {
+  const picojson::array *root;
+  const Model *model;
+  const std::string *base_dir;
+  bool is_binary;
+  const unsigned char *bin_data;
+  size_t bin_size;
+  std::vector<Image> images;
+  std::vector<std::string> errs;
+  std::vector<char> loaded;
+} ImageJobs;
+
+// Parses images[i] and loads its data, only touches the i-th results
+static void LoadImageJob(int i, void *data) {
+  ImageJobs *jobs = static_cast<ImageJobs *>(data);
+  Image &image = jobs->images[size_t(i)];
+  std::string *err = &jobs->errs[size_t(i)];
+
+  const picojson::object &o = (*jobs->root)[size_t(i)].get<picojson::object>();
+  if (!ParseImage(&image, err, o, *jobs->base_dir, jobs->is_binary,
+                  jobs->bin_data, jobs->bin_size)) {
+    return;
+  }
+
+  if (image.bufferView != -1) {
+    // Load image from the buffer view.
+    if (size_t(image.bufferView) >= jobs->model->bufferViews.size()) {
+      std::stringstream ss;
+      ss << "bufferView \"" << image.bufferView
+         << "\" not found in the scene." << std::endl;
+      (*err) += ss.str();
+      return;
+    }
+
+    const BufferView &bufferView =
+        jobs->model->bufferViews[size_t(image.bufferView)];
+    const Buffer &buffer = jobs->model->buffers[size_t(bufferView.buffer)];
+
+    if (!LoadImageData(&image, err, image.width, image.height,
+                       &buffer.data[bufferView.byteOffset],
+                       static_cast<int>(bufferView.byteLength))) {
+      return;
+    }
+  }
+
+  jobs->loaded[size_t(i)] = 1;
+}
+
 static bool ParseTexture(Texture *texture, std::string *err,
                          const picojson::object &o,
                          const std::string &basedir) {
@@ -1473,6 +1592,25 @@ static bool ParseTexture(Texture *texture, std::string *err,
   texture->sampler = static_cast<int>(sampler);
   texture->source = static_cast<int>(source);
 
+  // KHR_texture_basisu names a KTX2 image, source is then an optional fallback
+  texture->basisuSource = -1;
+  picojson::object::const_iterator extensionsObject = o.find("extensions");
+  if ((extensionsObject != o.end()) &&
+      (extensionsObject->second).is<picojson::object>()) {
+    const picojson::object &extensions =
+        (extensionsObject->second).get<picojson::object>();
+    picojson::object::const_iterator basisuObject =
+        extensions.find("KHR_texture_basisu");
+    if ((basisuObject != extensions.end()) &&
+        (basisuObject->second).is<picojson::object>()) {
+      double basisuSource = -1.0;
+      ParseNumberProperty(&basisuSource, err,
+                          (basisuObject->second).get<picojson::object>(),
+                          "source", true, "KHR_texture_basisu");
+      texture->basisuSource = static_cast<int>(basisuSource);
+    }
+  }
+
   return true;
 }
 
@@ -1577,7 +1715,7 @@ static bool ParseBufferView(BufferView *bufferView, std::string *err,
     return false;
   }
 
-  double byteStride = 4.0;
+  double byteStride = 0.0;
   ParseNumberProperty(&byteStride, err, o, "byteStride", false);
 
   double target = 0.0;
@@ -1601,13 +1739,75 @@ static bool ParseBufferView(BufferView *bufferView, std::string *err,
   return true;
 }
 
+static bool ParseSparseAccessor(Accessor *accessor, std::string *err,
+                                const picojson::object &o) {
+  double count = 0.0;
+  if (!ParseNumberProperty(&count, err, o, "count", true, "SparseAccessor")) {
+    return false;
+  }
+
+  picojson::object::const_iterator indicesIt = o.find("indices");
+  picojson::object::const_iterator valuesIt = o.find("values");
+  if ((indicesIt == o.end()) || !(indicesIt->second).is<picojson::object>() ||
+      (valuesIt == o.end()) || !(valuesIt->second).is<picojson::object>()) {
+    if (err) {
+      (*err) += "Sparse accessor needs `indices` and `values` objects.\n";
+    }
+    return false;
+  }
+
+  const picojson::object &indices =
+      (indicesIt->second).get<picojson::object>();
+  double indicesBufferView = -1.0;
+  double indicesByteOffset = 0.0;
+  double componentType = 0.0;
+  if (!ParseNumberProperty(&indicesBufferView, err, indices, "bufferView",
+                           true, "SparseAccessor") ||
+      !ParseNumberProperty(&componentType, err, indices, "componentType", true,
+                           "SparseAccessor")) {
+    return false;
+  }
+  ParseNumberProperty(&indicesByteOffset, err, indices, "byteOffset", false);
+
+  int comp = static_cast<int>(componentType);
+  if (comp != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE &&
+      comp != TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT &&
+      comp != TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) {
+    std::stringstream ss;
+    ss << "Invalid `componentType` in sparse accessor indices. Got " << comp
+       << "\n";
+    if (err) {
+      (*err) += ss.str();
+    }
+    return false;
+  }
+
+  const picojson::object &values = (valuesIt->second).get<picojson::object>();
+  double valuesBufferView = -1.0;
+  double valuesByteOffset = 0.0;
+  if (!ParseNumberProperty(&valuesBufferView, err, values, "bufferView", true,
+                           "SparseAccessor")) {
+    return false;
+  }
+  ParseNumberProperty(&valuesByteOffset, err, values, "byteOffset", false);
+
+  accessor->sparse.count = static_cast<int>(count);
+  accessor->sparse.isSparse = true;
+  accessor->sparse.indices.bufferView = static_cast<int>(indicesBufferView);
+  accessor->sparse.indices.byteOffset =
+      static_cast<size_t>(indicesByteOffset);
+  accessor->sparse.indices.componentType = comp;
+  accessor->sparse.values.bufferView = static_cast<int>(valuesBufferView);
+  accessor->sparse.values.byteOffset = static_cast<size_t>(valuesByteOffset);
+
+  return true;
+}
+
 static bool ParseAccessor(Accessor *accessor, std::string *err,
                           const picojson::object &o) {
+  // Only sparse accessors may leave out the bufferView, they start from zeros
   double bufferView = -1.0;
-  if (!ParseNumberProperty(&bufferView, err, o, "bufferView", true,
-                           "Accessor")) {
-    return false;
-  }
+  ParseNumberProperty(&bufferView, err, o, "bufferView", false, "Accessor");
 
   double byteOffset = 0.0;
   ParseNumberProperty(&byteOffset, err, o, "byteOffset", false, "Accessor");
@@ -1653,6 +1853,9 @@ static bool ParseAccessor(Accessor *accessor, std::string *err,
 
   ParseStringProperty(&accessor->name, err, o, "name", false);
 
+  accessor->normalized = false;
+  ParseBooleanProperty(&accessor->normalized, err, o, "normalized", false);
+
   accessor->minValues.clear();
   accessor->maxValues.clear();
   if (!ParseNumberArrayProperty(&accessor->minValues, err, o, "min", true,
@@ -1669,6 +1872,22 @@ static bool ParseAccessor(Accessor *accessor, std::string *err,
   accessor->bufferView = static_cast<int>(bufferView);
   accessor->byteOffset = static_cast<size_t>(byteOffset);
 
+  accessor->sparse.isSparse = false;
+  picojson::object::const_iterator sparseIt = o.find("sparse");
+  if ((sparseIt != o.end()) && (sparseIt->second).is<picojson::object>()) {
+    if (!ParseSparseAccessor(accessor, err,
+                             (sparseIt->second).get<picojson::object>())) {
+      return false;
+    }
+  }
+
+  if (accessor->bufferView < 0 && !accessor->sparse.isSparse) {
+    if (err) {
+      (*err) += "Accessor needs a `bufferView` or `sparse` values.\n";
+    }
+    return false;
+  }
+
   {
     int comp = static_cast<int>(componentType);
     if (comp >= TINYGLTF_COMPONENT_TYPE_BYTE &&
@@ -1805,6 +2024,8 @@ static bool ParseNode(Node *node, std::string *err, const picojson::object &o) {
   ParseNumberProperty(&mesh, err, o, "mesh", false);
   node->mesh = int(mesh);
 
+  ParseNumberArrayProperty(&node->weights, err, o, "weights", false);
+
   node->children.clear();
   picojson::object::const_iterator childrenObject = o.find("children");
   if ((childrenObject != o.end()) &&
@@ -1824,6 +2045,27 @@ static bool ParseNode(Node *node, std::string *err, const picojson::object &o) {
     }
   }
 
+  // EXT_mesh_gpu_instancing only stores accessor indices here, the instance
+  // data itself stays in the binary buffers.
+  node->instanceAttributes.clear();
+  picojson::object::const_iterator extensionsObject = o.find("extensions");
+  if ((extensionsObject != o.end()) &&
+      (extensionsObject->second).is<picojson::object>()) {
+    const picojson::object &extensions =
+        (extensionsObject->second).get<picojson::object>();
+    picojson::object::const_iterator instancingObject =
+        extensions.find("EXT_mesh_gpu_instancing");
+    if ((instancingObject != extensions.end()) &&
+        (instancingObject->second).is<picojson::object>()) {
+      if (!ParseStringIntProperty(
+              &node->instanceAttributes, err,
+              (instancingObject->second).get<picojson::object>(), "attributes",
+              true)) {
+        return false;
+      }
+    }
+  }
+
   ParseExtrasProperty(&(node->extras), o);
 
   return true;
@@ -2004,13 +2246,9 @@ static bool ParseAnimation(Animation *animation, std::string *err,
           }
           return false;
         }
-        if (!ParseStringProperty(&sampler.interpolation, err, s,
-                                 "interpolation", true)) {
-          if (err) {
-            (*err) += "`interpolation` field is missing in animation.sampler\n";
-          }
-          return false;
-        }
+        // Optional, stays "LINEAR" when missing
+        ParseStringProperty(&sampler.interpolation, err, s, "interpolation",
+                            false);
         if (!ParseNumberProperty(&outputIndex, err, s, "output", true)) {
           if (err) {
             (*err) += "`output` field is missing in animation.sampler\n";
@@ -2035,8 +2273,9 @@ static bool ParseSampler(Sampler *sampler, std::string *err,
                          const picojson::object &o) {
   ParseStringProperty(&sampler->name, err, o, "name", false);
 
+  // glTF 2.0 leaves the filter to the implementation when it is missing
   double minFilter =
-      static_cast<double>(TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_LINEAR);
+      static_cast<double>(TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_LINEAR);
   double magFilter = static_cast<double>(TINYGLTF_TEXTURE_FILTER_LINEAR);
   double wrapS = static_cast<double>(TINYGLTF_TEXTURE_WRAP_RPEAT);
   double wrapT = static_cast<double>(TINYGLTF_TEXTURE_WRAP_RPEAT);
@@ -2316,40 +2555,35 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, const char *str,
   if (v.contains("images") && v.get("images").is<picojson::array>()) {
     const picojson::array &root = v.get("images").get<picojson::array>();
 
-    picojson::array::const_iterator it(root.begin());
-    picojson::array::const_iterator itEnd(root.end());
-    for (; it != itEnd; it++) {
-      Image image;
-      if (!ParseImage(&image, err, it->get<picojson::object>(), base_dir,
-                      is_binary_, bin_data_, bin_size_)) {
-        return false;
+    // Images do not depend on each other, errors are reported in their order
+    ImageJobs jobs;
+    jobs.root = &root;
+    jobs.model = model;
+    jobs.base_dir = &base_dir;
+    jobs.is_binary = is_binary_;
+    jobs.bin_data = bin_data_;
+    jobs.bin_size = bin_size_;
+    jobs.images.resize(root.size());
+    jobs.errs.resize(root.size());
+    jobs.loaded.resize(root.size(), 0);
+
+    int count = static_cast<int>(root.size());
+    if (parallel_for_ && count > 1) {
+      parallel_for_(count, LoadImageJob, &jobs, parallel_for_user_data_);
+    } else {
+      for (int i = 0; i < count; i++) {
+        LoadImageJob(i, &jobs);
       }
+    }
 
-      if (image.bufferView != -1) {
-        // Load image from the buffer view.
-        if (size_t(image.bufferView) >= model->bufferViews.size()) {
-          if (err) {
-            std::stringstream ss;
-            ss << "bufferView \"" << image.bufferView
-               << "\" not found in the scene." << std::endl;
-            (*err) += ss.str();
-          }
-          return false;
-        }
-
-        const BufferView &bufferView =
-            model->bufferViews[size_t(image.bufferView)];
-        const Buffer &buffer = model->buffers[size_t(bufferView.buffer)];
-
-        bool ret = LoadImageData(&image, err, image.width, image.height,
-                                 &buffer.data[bufferView.byteOffset],
-                                 static_cast<int>(bufferView.byteLength));
-        if (!ret) {
-          return false;
-        }
+    for (size_t i = 0; i < root.size(); i++) {
+      if (err) {
+        (*err) += jobs.errs[i];
       }
-
-      model->images.push_back(image);
+      if (!jobs.loaded[i]) {
+        return false;
+      }
+      model->images.push_back(jobs.images[i]);
     }
   }
 
@@ -2672,12 +2906,15 @@ static void SerializeParameterMap(ParameterMap &param, picojson::object &o) {
 }
 
 static void SerializeGltfAccessor(Accessor &accessor, picojson::object &o) {
-  SerializeNumberProperty<int>("bufferView", accessor.bufferView, o);
+  if (accessor.bufferView >= 0)
+    SerializeNumberProperty<int>("bufferView", accessor.bufferView, o);
 
   if (accessor.byteOffset != 0.0)
     SerializeNumberProperty<int>("byteOffset", int(accessor.byteOffset), o);
 
   SerializeNumberProperty<int>("componentType", accessor.componentType, o);
+  if (accessor.normalized)
+    o.insert(json_object_pair("normalized", picojson::value(true)));
   SerializeNumberProperty<size_t>("count", accessor.count, o);
   SerializeNumberArrayProperty<double>("min", accessor.minValues, o);
   SerializeNumberArrayProperty<double>("max", accessor.maxValues, o);
@@ -2707,6 +2944,31 @@ static void SerializeGltfAccessor(Accessor &accessor, picojson::object &o) {
   }
 
   SerializeStringProperty("type", type, o);
+
+  if (accessor.sparse.isSparse) {
+    picojson::object indices;
+    SerializeNumberProperty<int>("bufferView",
+                                 accessor.sparse.indices.bufferView, indices);
+    if (accessor.sparse.indices.byteOffset != 0)
+      SerializeNumberProperty<size_t>(
+          "byteOffset", accessor.sparse.indices.byteOffset, indices);
+    SerializeNumberProperty<int>("componentType",
+                                 accessor.sparse.indices.componentType,
+                                 indices);
+
+    picojson::object values;
+    SerializeNumberProperty<int>("bufferView",
+                                 accessor.sparse.values.bufferView, values);
+    if (accessor.sparse.values.byteOffset != 0)
+      SerializeNumberProperty<size_t>("byteOffset",
+                                      accessor.sparse.values.byteOffset, values);
+
+    picojson::object sparse;
+    SerializeNumberProperty<int>("count", accessor.sparse.count, sparse);
+    sparse.insert(json_object_pair("indices", picojson::value(indices)));
+    sparse.insert(json_object_pair("values", picojson::value(values)));
+    o.insert(json_object_pair("sparse", picojson::value(sparse)));
+  }
 }
 
 static void SerializeGltfAnimationChannel(AnimationChannel &channel,
@@ -2887,6 +3149,26 @@ static void SerializeGltfNode(Node &node, picojson::object &o) {
     SerializeNumberProperty<int>("skin", node.skin, o);
   }
 
+  if (node.weights.size() > 0) {
+    SerializeNumberArrayProperty<double>("weights", node.weights, o);
+  }
+
+  if (node.instanceAttributes.size()) {
+    picojson::object attributes;
+    for (std::map<std::string, int>::const_iterator attrIt =
+             node.instanceAttributes.begin();
+         attrIt != node.instanceAttributes.end(); ++attrIt) {
+      SerializeNumberProperty<int>(attrIt->first, attrIt->second, attributes);
+    }
+    picojson::object instancing;
+    instancing.insert(
+        json_object_pair("attributes", picojson::value(attributes)));
+    picojson::object extensions;
+    extensions.insert(json_object_pair("EXT_mesh_gpu_instancing",
+                                       picojson::value(instancing)));
+    o.insert(json_object_pair("extensions", picojson::value(extensions)));
+  }
+
   SerializeStringProperty("name", node.name, o);
   SerializeNumberArrayProperty<int>("children", node.children, o);
 }
@@ -2919,7 +3201,18 @@ static void SerializeGltfSkin(Skin &skin, picojson::object &o) {
 
 static void SerializeGltfTexture(Texture &texture, picojson::object &o) {
   SerializeNumberProperty("sampler", texture.sampler, o);
-  SerializeNumberProperty("source", texture.source, o);
+  if (texture.source != -1) {
+    SerializeNumberProperty("source", texture.source, o);
+  }
+
+  if (texture.basisuSource != -1) {
+    picojson::object basisu;
+    SerializeNumberProperty("source", texture.basisuSource, basisu);
+    picojson::object extensions;
+    extensions.insert(
+        json_object_pair("KHR_texture_basisu", picojson::value(basisu)));
+    o.insert(json_object_pair("extensions", picojson::value(extensions)));
+  }
 
   if (texture.extras.Size()) {
     picojson::object extras;